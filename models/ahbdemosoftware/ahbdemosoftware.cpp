@@ -14,6 +14,7 @@
 ///
 
 #include "models/ahbdemosoftware/ahbdemosoftware.h"
+#include "models/processprofiler/processprofiler.h"
 
 /// Constructor
 AHBDemoSoftware::AHBDemoSoftware(ModuleName name,     // The SystemC name of the component
@@ -21,19 +22,26 @@ AHBDemoSoftware::AHBDemoSoftware(ModuleName name,     // The SystemC name of the
   bool pow_mon,                                // Enable power monitoring
   uint32_t frameWidth,
   uint32_t frameHeight,
-  AbstractionLayer ambaLayer) :            // TLM abstraction layer
-    AHBMaster<>(name,                            // SystemC name
+  AbstractionLayer ambaLayer,              // TLM abstraction layer
+  uint32_t zoomerAddr,                     // APB address of an AHBZoomer
+  uint32_t statisticsAddr) :               // APB address of an AHBStatistics
+    AHBVideoMaster<>(name,                       // SystemC name
       hindex,                                    // Bus master index
       0x04,                                      // Vender ID (4 = ESA)
       0x00,                                      // Device ID (undefined)
       0,                                         // Version
       0,                                         // IRQ of device
       ambaLayer),                                // AmbaLayer
+    frameOut("frameOut"),
+    frameIn(&AHBDemoSoftware::frame_in, "frameIn"),
     m_frameWidth(frameWidth),
     m_frameHeight(frameHeight),
     m_master_id(hindex),                         // Initialize bus index
     m_pow_mon(pow_mon),                          // Initialize pow_mon
-    m_abstractionLayer(ambaLayer) {              // Initialize abstraction layer
+    m_abstractionLayer(ambaLayer),               // Initialize abstraction layer
+    m_zoomeraddr(zoomerAddr),                    // Initialize zoom offload
+    m_statisticsaddr(statisticsAddr),            // Initialize histogram offload
+    m_statisticsblock(0xA0000000 + frameWidth * frameHeight * 2) { // Result block behind the frame
   // Register frame_trigger thread
   SC_THREAD(software);
 
@@ -53,80 +61,111 @@ void AHBDemoSoftware::dorst() {
 }
 
 void AHBDemoSoftware::readKeyboard() {
+  PROFILE_PROCESS();
   m_key = keyboardIn.read();
 }
 
 void AHBDemoSoftware::frameTrigger() {
+  PROFILE_PROCESS();
+  if (!m_inbox.linked()) {
+    frameTriggerEvent.notify();
+  }
+}
+
+void AHBDemoSoftware::frame_in(const FrameDescriptor &frame, const sc_time &delay) {
+  m_inbox.put(frame);
   frameTriggerEvent.notify();
 }
 
+void AHBDemoSoftware::end_of_simulation() {
+  if (m_inbox.linked()) {
+    m_inbox.report(this->name());
+  }
+}
+
+void AHBDemoSoftware::write_reg(uint32_t addr, uint32_t value) {
+  uint32_t data = ((value & 0xFF) << 24) | ((value & 0xFF00) << 8) | ((value >> 8) & 0xFF00) | (value >> 24); // Endianess!
+  ahbsync();  // registers are written at the decoupled local time
+  ahbwrite(addr, reinterpret_cast<uint8_t *>(&data), 4);
+}
+
+uint32_t AHBDemoSoftware::read_reg(uint32_t addr) {
+  uint32_t data;
+  ahbsync();
+  ahbread(addr, reinterpret_cast<uint8_t *>(&data), 4);
+  return ((data & 0xFF) << 24) | ((data & 0xFF00) << 8) | ((data >> 8) & 0xFF00) | (data >> 24); // Endianess!
+}
+
+void AHBDemoSoftware::read_statistics(uint32_t *histogramdata) {
+  uint8_t block[0x20 + 64 * 4];
+  ahbsync();
+  ahbread(m_statisticsblock, block, sizeof(block));
+  for (int i = 0; i < 64; i++) {
+    uint8_t *word = &block[0x20 + i * 4];
+    histogramdata[i] = (word[0] << 24) | (word[1] << 16) | (word[2] << 8) | word[3];
+  }
+}
+
 void AHBDemoSoftware::zoom(uint32_t mem, uint32_t in_x, uint32_t in_y, uint32_t out_x, uint32_t out_y, uint32_t video_width, uint32_t frame_width, uint32_t frame_height) {
-    int i, j;
+    uint32_t i, j;
     uint8_t factor = frame_width / video_width;
-    uint8_t inbuffer[video_width];
-    uint8_t outbuffer[video_width*2];
-    for(i=0;i<frame_height/(factor*2);i++){
-          ahbread(
-              mem + (in_y*video_width*2*factor) + in_x * 2 + (i * video_width * 2 * factor ),
-              inbuffer, 
-              video_width
-          );
+    uint32_t rows = frame_height/(factor*2);
+    uint32_t stride = video_width * 2 * factor;
+    std::vector<uint8_t> inbuffer(video_width * rows);
+    std::vector<uint8_t> outbuffer(video_width * 2 * rows);
+    ahbread2d(mem + in_y * stride + in_x * 2, &inbuffer[0], video_width, rows, stride);
+    for(i=0;i<rows;i++){
+          uint8_t *in = &inbuffer[i * video_width];
+          uint8_t *out = &outbuffer[i * video_width * 2];
           // double pixels within one line
           for(j=0;j<video_width;j+=4) { // only take y1 and y2 values?
-            outbuffer[   j *2] = inbuffer[j];
-            outbuffer[1+ j *2] = inbuffer[j+1];
-            outbuffer[2+ j *2] = inbuffer[j+2];
-            outbuffer[3+ j *2] = inbuffer[j+1];
-            outbuffer[4+ j *2] = inbuffer[j];
-            outbuffer[5+ j *2] = inbuffer[j+3];
-            outbuffer[6+ j *2] = inbuffer[j+2];
-            outbuffer[7+ j *2] = inbuffer[j+3];
+            out[   j *2] = in[j];
+            out[1+ j *2] = in[j+1];
+            out[2+ j *2] = in[j+2];
+            out[3+ j *2] = in[j+1];
+            out[4+ j *2] = in[j];
+            out[5+ j *2] = in[j+3];
+            out[6+ j *2] = in[j+2];
+            out[7+ j *2] = in[j+3];
           }
-          // write line 2 times
-          ahbwrite(
-              mem + (out_y*video_width*2*factor) + out_x * 2 + (i * video_width * 4*factor ), 
-              outbuffer, 
-              video_width*2
-          );
-          ahbwrite(
-              mem + ((out_y+1)*video_width*2*factor) + out_x * 2 + (i * video_width * 4*factor ), 
-              outbuffer, 
-              video_width*2
-          );
     }
+    // write every line 2 times
+    ahbwrite2d(mem + out_y * stride + out_x * 2, &outbuffer[0], video_width * 2, rows, stride, 2);
 }
 
 void AHBDemoSoftware::histogram(uint32_t mem, uint32_t in_x, uint32_t in_y, uint32_t out_x, uint32_t out_y, uint32_t video_width, uint32_t frame_width, uint32_t frame_height) {
-    int i, j, tmp;
-    uint8_t inbuffer[video_width];
-    uint8_t outbuffer[64*4];
-    int histogramdata[64];
-    uint8_t histheight;
+    uint32_t i, j;
+    uint8_t histheight = 192;
     uint8_t factor = frame_width / video_width;
+    uint32_t rows = frame_height/(2*factor);
+    uint32_t stride = video_width * 2 * factor;
+    std::vector<uint8_t> inbuffer(video_width * rows);
+    std::vector<uint8_t> outbuffer(64 * 4 * histheight);
+    uint32_t histogramdata[64];
     memset(histogramdata,0,64*4);
+    if (m_statisticsaddr) {
+      // bins of the previous frame, the statistics device streams the current one meanwhile
+      read_statistics(histogramdata);
+    } else {
     // read data for histogram line by line and store in 64 buckets, max height should be 192, actual max height would be 19200
-    for(i=0;i<frame_height/(2*factor);i++){
-          ahbread(
-              mem+(in_y*video_width*2*factor) + in_x * 2 + (i * video_width * 2*factor ),
-              inbuffer, 
-              video_width
-          );
+    ahbread2d(mem + in_y * stride + in_x * 2, &inbuffer[0], video_width, rows, stride);
+    for(i=0;i<rows;i++){
+          uint8_t *in = &inbuffer[i * video_width];
           // go through line and count greyvalues
           for(j=0;j<video_width;j+=4){
-            histogramdata[(inbuffer[j+1])/4]++;
-            histogramdata[(inbuffer[j+3])/4]++;
+            histogramdata[(in[j+1])/4]++;
+            histogramdata[(in[j+3])/4]++;
           }
     }
+    }
     // create histogram in full frame
     /*for(i=0;i<64;i++) {
-      tmp = histogramdata[i];
-      printf("%d,",tmp);
+      printf("%u,", histogramdata[i]);
     }
     printf("\n");*/
 
     
-    // draw histogram from full frame one line at a time
-    histheight = 192;
+    // draw histogram from full frame, all lines in one transfer
     // max in histdata / histheigt = scalefactor
     uint32_t histmax = histogramdata[0];
     for (i=0;i<64;i++) {
@@ -135,41 +174,63 @@ void AHBDemoSoftware::histogram(uint32_t mem, uint32_t in_x, uint32_t in_y, uint
         }
     }
     uint8_t histscalefactor = histmax/histheight;
+    if (!histscalefactor) {
+      histscalefactor = 1;
+    }
     for(i=0;i<histheight;i++){
+        uint8_t *out = &outbuffer[i * 64 * 4];
         for(j=0;j<64*4;j+=4) {
           if ((histogramdata[j/4]/histscalefactor) >= ((histheight)-i)) {  
-            outbuffer[j+1] = 0;
-            outbuffer[j+3] = 0;
-            outbuffer[j+0] = 128;
-            outbuffer[j+2] = 128;
+            out[j+1] = 0;
+            out[j+3] = 0;
+            out[j+0] = 128;
+            out[j+2] = 128;
           }
           else {
-            outbuffer[j+1] = 255;
-            outbuffer[j+3] = 255;
-            outbuffer[j+0] = 128;
-            outbuffer[j+2] = 128;
+            out[j+1] = 255;
+            out[j+3] = 255;
+            out[j+0] = 128;
+            out[j+2] = 128;
           }
         }
-          ahbwrite(
-              mem+(out_y*video_width*2*factor) + out_x * 2 + (i * video_width * 2*factor ), 
-              outbuffer, 
-              64*4 
-          );
     }
+    ahbwrite2d(mem + out_y * stride + out_x * 2, &outbuffer[0], 64 * 4, histheight, stride);
 }
 
 // Generates a thread of frame_length
 void AHBDemoSoftware::software() {
+  PROFILE_PROCESS();
   // Locals
-  uint32_t i, inPosX = 0, inPosY = 0, outPosX = 0, outPosY = 240;
+  uint32_t inPosX = 0, inPosY = 0, outPosX = 0, outPosY = 240;
   uint32_t windowWidth = 160, windowHeight = 120;
-  uint8_t *buffer = new uint8_t[windowWidth*2];
   uint32_t videoaddr = 0xA0000000;
   bool frameToggle = false;
+  uint32_t sequence = 0;
+  FrameDescriptor frame;
   // Wait for system becoming ready
-  wait(1, SC_MS);
+  ProcessProfiler::wait(1, SC_MS);
+  if (m_zoomeraddr) {
+    // zoom window geometry is static, only its source position follows the keys
+    write_reg(m_zoomeraddr + 0x04, videoaddr);
+    write_reg(m_zoomeraddr + 0x0C, (windowWidth << 16) | windowHeight);
+    write_reg(m_zoomeraddr + 0x10, (outPosX << 16) | outPosY);
+    write_reg(m_zoomeraddr + 0x14, 2);
+    write_reg(m_zoomeraddr + 0x18, m_frameWidth * 2);
+  }
+  if (m_statisticsaddr) {
+    // same window the software histogram counts, result block is placed behind the frame
+    write_reg(m_statisticsaddr + 0x04, videoaddr);
+    write_reg(m_statisticsaddr + 0x0C, (windowWidth << 16) | windowHeight);
+    write_reg(m_statisticsaddr + 0x10, m_frameWidth * 2);
+    write_reg(m_statisticsaddr + 0x14, m_statisticsblock);
+  }
   while(1) {
-    wait(frameTriggerEvent);
+    ProcessProfiler::wait(frameTriggerEvent);
+    bool forwarded = m_inbox.take(frame);
+    if (!forwarded) {
+      frame.sequence = ++sequence;
+      frame.timestamp = sc_time_stamp();
+    }
     switch(m_key){
       case 'r':
         if (inPosX<160){
@@ -193,8 +254,35 @@ void AHBDemoSoftware::software() {
       default:
         break;
     }
-    zoom(videoaddr, 320+inPosX, inPosY, 0, 240, 320, m_frameWidth, m_frameHeight);
+    uint32_t zoomToggle = 0;
+    if (m_zoomeraddr) {
+      write_reg(m_zoomeraddr + 0x08, ((320 + inPosX) << 16) | inPosY);
+      zoomToggle = read_reg(m_zoomeraddr + 0x00) & 0x2;
+      write_reg(m_zoomeraddr + 0x00, 0x3);
+    } else {
+      zoom(videoaddr, 320+inPosX, inPosY, outPosX, outPosY, 320, m_frameWidth, m_frameHeight);
+    }
+    if (m_statisticsaddr) {
+      write_reg(m_statisticsaddr + 0x08, ((320 + inPosX) << 16) | inPosY);
+      write_reg(m_statisticsaddr + 0x00, 0xB);
+    }
     histogram(videoaddr, 320+inPosX, inPosY, 320, 240, 320, m_frameWidth, m_frameHeight);
+    if (m_zoomeraddr) {
+      // the zoom window is only complete once the frame bit of the zoomer toggled
+      while ((read_reg(m_zoomeraddr + 0x00) & 0x2) == zoomToggle) {
+        ProcessProfiler::wait(100 * clock_cycle);
+      }
+    }
+    ahbsync();
+    frame.addr = videoaddr + outPosX * 2 + outPosY * m_frameWidth * 2;
+    frame.width = windowWidth * 2;
+    frame.height = windowHeight * 2;
+    frame.stride = m_frameWidth * 2;
+    frame.format = FRAME_YUV422;
+    if (forwarded) {
+      m_inbox.done(frame);
+    }
+    frameOut.write(frame);
     frameToggle = !frameToggle;
     triggerOut.write(frameToggle);
   }
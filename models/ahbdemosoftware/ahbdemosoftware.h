@@ -21,9 +21,12 @@
 
 // Provides methods for generating random data
 #include <math.h>
+#include <vector>
 
 // AHB TLM master socket and protocol implementation
-#include "core/common/ahbmaster.h"
+#include "models/ahbvideomaster/ahbvideomaster.h"
+// Frame descriptors exchanged with the video models
+#include "models/ahbvideomaster/framedescriptor.h"
 // Timing interface (specify clock period)
 #include "core/common/clkdevice.h"
 
@@ -31,7 +34,7 @@
 #include "core/common/verbose.h"
 
 /// Definition of class AHBDemoSoftware
-class AHBDemoSoftware : public AHBMaster<>, public CLKDevice {
+class AHBDemoSoftware : public AHBVideoMaster<>, public CLKDevice {
   public:
     SC_HAS_PROCESS(AHBDemoSoftware);
     SR_HAS_SIGNALS(AHBDemoSoftware);
@@ -40,19 +43,32 @@ class AHBDemoSoftware : public AHBMaster<>, public CLKDevice {
     sc_in<bool> triggerIn;
     sc_out<bool> triggerOut;
 
+    /// Descriptor of the zoom window after every processed frame
+    signal<FrameDescriptor>::out frameOut;
+
+    /// Descriptors of the producing stage, replace triggerIn once connected
+    signal<FrameDescriptor>::in frameIn;
+
     /// Constructor
     AHBDemoSoftware(ModuleName name,  // The SystemC name of the component
     unsigned int hindex,                    // The master index for registering with the AHB
     bool pow_mon,                               // Enable power monitoring
     uint32_t frameWidth,
     uint32_t frameHeight,
-    AbstractionLayer ambaLayer);            // TLM abstraction layer
+    AbstractionLayer ambaLayer,             // TLM abstraction layer
+    uint32_t zoomerAddr = 0,                // APB address of an AHBZoomer, 0 zooms in software
+    uint32_t statisticsAddr = 0);           // APB address of an AHBStatistics, 0 counts in software
 
     /// Thread for reading keyboard events
     void readKeyboard();
 
     void frameTrigger();
 
+    void frame_in(const FrameDescriptor &frame, const sc_time &delay);
+
+    /// Report received and dropped frames
+    void end_of_simulation();
+
     /// Thread for generating the data frame
     void software();
 
@@ -71,6 +87,7 @@ class AHBDemoSoftware : public AHBMaster<>, public CLKDevice {
     
     char m_key;
     sc_event frameTriggerEvent;
+    FrameInbox m_inbox;
   private:
     // data members
     // ------------
@@ -84,6 +101,24 @@ class AHBDemoSoftware : public AHBMaster<>, public CLKDevice {
     /// amba abstraction layer
     AbstractionLayer m_abstractionLayer;
 
+    /// APB base address of the AHBZoomer used to offload zoom (0 = software zoom)
+    uint32_t m_zoomeraddr;
+
+    /// APB base address of the AHBStatistics used to offload the histogram (0 = software)
+    uint32_t m_statisticsaddr;
+
+    /// Memory address the AHBStatistics result block is written to
+    uint32_t m_statisticsblock;
+
+    /// Fetch the 64 histogram bins of the last AHBStatistics result block
+    void read_statistics(uint32_t *histogramdata);
+
+    /// Write a device register in bus byte order
+    void write_reg(uint32_t addr, uint32_t value);
+
+    /// Read a device register in bus byte order
+    uint32_t read_reg(uint32_t addr);
+
     void zoom(uint32_t mem, uint32_t in_x, uint32_t in_y, uint32_t out_x, uint32_t out_y, uint32_t video_width, uint32_t frame_width, uint32_t frame_height);
     void histogram(uint32_t mem, uint32_t in_x, uint32_t in_y, uint32_t out_x, uint32_t out_y, uint32_t video_width, uint32_t frame_width, uint32_t frame_height);
 };
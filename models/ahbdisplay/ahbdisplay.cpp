@@ -12,6 +12,8 @@
 /// @author Rolf Meyer
 ///
 #include "models/ahbdisplay/ahbdisplay.h"
+#include "models/apbbuffermanager/apbbuffermanager.h"
+#include "models/processprofiler/processprofiler.h"
 #include "core/common/verbose.h"
 #include "core/common/sr_report.h"
 #include "core/common/sr_registry.h"
@@ -24,7 +26,7 @@ AHBDisplay::AHBDisplay(ModuleName name,
   uint32_t frame_width,
   uint32_t frame_height,
   AbstractionLayer ambaLayer) :
-  AHBMaster<APBSlave>(name,
+  AHBVideoMaster<APBSlave>(name,
     hindex,
     0x03,
     0x003,
@@ -32,12 +34,18 @@ AHBDisplay::AHBDisplay(ModuleName name,
     0,
     ambaLayer/*,
     BAR(), BAR(), BAR(), BAR()*/),
+  frameOut("frameOut"),
+  frameIn(&AHBDisplay::frame_in, "frameIn"),
   m_screen(NULL),
   m_videoaddr(0xA0000000),
   m_width(frame_width),
   m_height(frame_height),
-  m_rowDuration(ROW_DURATION_IN_NS, SC_NS) {
-  m_xferData = new uint8_t[m_width * 4];
+  m_rowDuration(ROW_DURATION_IN_NS, SC_NS),
+  m_frameToggle(false),
+  m_sequence(0),
+  m_buffers(NULL),
+  m_shown(0) {
+  m_xferData = new uint8_t[m_width * m_height * 2];
   init_apb(pindex, 0x03, 0x003, 0, 0, APBIO, pmask, 0, 0, paddr);
 
   init_registers();
@@ -77,6 +85,12 @@ void AHBDisplay::end_of_elaboration() {
 
 void AHBDisplay::end_of_simulation() {
   m_screen->quit();
+  if (m_inbox.linked()) {
+    m_inbox.report(name());
+    if (!m_latency_csv.empty()) {
+      m_inbox.latency().write_csv(m_latency_csv);
+    }
+  }
 }
 
 void AHBDisplay::ctrl_read() {
@@ -99,6 +113,14 @@ void AHBDisplay::ctrl_write() {
 }
 
 void AHBDisplay::frameTrigger(){
+  PROFILE_PROCESS();
+  if (!m_inbox.linked()) {
+    frameTriggerEvent.notify();
+  }
+}
+
+void AHBDisplay::frame_in(const FrameDescriptor &frame, const sc_time &delay) {
+  m_inbox.put(frame);
   frameTriggerEvent.notify();
 }
 
@@ -106,6 +128,8 @@ bool AHBDisplay::init_yuv_viewer() {
   m_videoaddr = r[0x4];
   m_width = r[0x8];
   m_height = r[0xC];
+  delete[] m_xferData;
+  m_xferData = new uint8_t[m_width * m_height * 2];
   v::info << name() << "Open Screen with width " << m_width << " and height " << m_height << v::endl;
   m_screen = new SDLYuvViewer(m_width, m_height);
  
@@ -123,17 +147,53 @@ bool AHBDisplay::init_yuv_viewer() {
 //const uint32_t memoffset = 0x40000000;
 
 void AHBDisplay::yf_painter() {
+  PROFILE_PROCESS();
   char key;
   while (true) {
-    wait(frameTriggerEvent);
+    ProcessProfiler::wait(frameTriggerEvent);
     //v::info << name() << "Paint screen" << v::endl;
 
-    for (uint32_t i = 0; i < m_height; i++) {
-        ahbread(m_videoaddr + (i * m_width * 2), m_xferData, m_width * 2);
-        m_screen->drawYUVVector(m_xferData, 0, i);
+    FrameDescriptor frame;
+    bool forwarded = m_inbox.take(frame);
+    uint32_t addr = m_videoaddr;
+    uint32_t stride = m_width * 2;
+    if (m_buffers) {
+      uint32_t full = m_buffers->dequeue_full();
+      if (full) {
+        if (m_shown) {
+          m_buffers->release(m_shown);
+        }
+        m_shown = full;
+      }
+      if (m_shown) {
+        addr = m_shown;
+      }
+    } else if (forwarded && frame.width == m_width && frame.height == m_height) {
+      addr = frame.addr;
+      stride = frame.stride;
+    }
+    if (!forwarded) {
+      frame.sequence = ++m_sequence;
+      frame.timestamp = sc_time_stamp();
+    }
 
-        wait(1 * clock_cycle);
+    ahbread2d(addr, m_xferData, m_width * 2, m_height, stride);
+    for (uint32_t i = 0; i < m_height; i++) {
+        m_screen->drawYUVVector(m_xferData + i * m_width * 2, 0, i);
+    }
+    consume(m_height * clock_cycle);
+    ahbsync();
+    frame.addr = addr;
+    frame.width = m_width;
+    frame.height = m_height;
+    frame.stride = stride;
+    frame.format = FRAME_YUV422;
+    if (forwarded) {
+      m_inbox.done(frame);
     }
+    frameOut.write(frame);
+    m_frameToggle = !m_frameToggle;
+    triggerOut.write(m_frameToggle);
     key = m_screen->check_for_input();
     if (key) {
       keyboardOut.write(key);
@@ -30,18 +30,25 @@
 
 #include "models/ahbdisplay/yuv_viewer.h"
 
-#include "core/common/ahbmaster.h"
+#include "models/ahbvideomaster/ahbvideomaster.h"
 #include "core/common/apbdevice.h"
 #include "core/common/apbslave.h"
 #include "core/common/clkdevice.h"
 
 #include "core/common/sr_signal.h"
+#include "models/ahbvideomaster/framedescriptor.h"
+
+class APBBufferManager;
 
 /**
  * Open a YUV-Viewer window, receive YUVFrames from
  * a connected ship_channel, and paint them onto the screen.
+ *
+ * With a buffer manager set, every frame paints the oldest full buffer of
+ * its pool and releases the one painted before. Without a new full buffer
+ * the last one is painted again.
  */
-class AHBDisplay : public AHBMaster<APBSlave>, public CLKDevice {
+class AHBDisplay : public AHBVideoMaster<APBSlave>, public CLKDevice {
   public:
     SC_HAS_PROCESS(AHBDisplay);
     SR_HAS_SIGNALS(AHBDisplay);
@@ -50,9 +57,17 @@ class AHBDisplay : public AHBMaster<APBSlave>, public CLKDevice {
     uint32_t yuvcount;
 
     sc_in<bool> triggerIn;
+    sc_out<bool> triggerOut;
     sc_out<char> keyboardOut;
     signal<std::pair<uint32_t, bool> >::out irq;
 
+    /// Descriptor of every painted frame
+    signal<FrameDescriptor>::out frameOut;
+
+    /// Descriptors of the producing stage, replace triggerIn once connected.
+    /// A descriptor of a whole frame is painted from its own buffer.
+    signal<FrameDescriptor>::in frameIn;
+
     AHBDisplay(ModuleName name, 
     uint32_t hindex, 
     uint32_t pindex, 
@@ -68,9 +83,16 @@ class AHBDisplay : public AHBMaster<APBSlave>, public CLKDevice {
     void end_of_elaboration();
     void end_of_simulation();
 
+    /// Write the latency of every painted frame to a CSV file at the end
+    void latency_csv(const std::string &file) { m_latency_csv = file; }
+
+    /// Take the frames from the full queue of a pool of buffers
+    void set_buffers(APBBufferManager *buffers) { m_buffers = buffers; }
+
     sc_event frameDone;
     sc_event frameTriggerEvent;
     void frameTrigger();
+    void frame_in(const FrameDescriptor &frame, const sc_time &delay);
 
     sc_core::sc_time get_clock() {return clock_cycle; }
     uint8_t *memory;
@@ -95,6 +117,14 @@ class AHBDisplay : public AHBMaster<APBSlave>, public CLKDevice {
 
     sc_time m_rowDuration;
     uint8_t *m_xferData;
+    bool m_frameToggle;
+
+    FrameInbox m_inbox;
+    uint32_t m_sequence;
+    std::string m_latency_csv;
+    APBBufferManager *m_buffers;
+    /// Buffer of the pool on the screen, 0 before the first one
+    uint32_t m_shown;
     sc_time *delay;
 };
 
@@ -0,0 +1,222 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbdma
+/// @{
+/// @file ahbdma.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/ahbdma/ahbdma.h"
+#include "models/processprofiler/processprofiler.h"
+#include "core/common/verbose.h"
+
+const uint32_t AHBDMA::BUFFER_SIZE;
+
+AHBDMA::AHBDMA(sc_module_name name,
+  uint32_t hindex,
+  uint32_t pindex,
+  uint32_t paddr,
+  uint32_t pmask,
+  uint32_t pirq,
+  AbstractionLayer ambaLayer) :
+  AHBVideoMaster<APBSlave>(
+    name,
+    hindex,
+    0x03,
+    0x00F,
+    0,
+    0,
+    ambaLayer,
+    BAR(), BAR(), BAR(), BAR()),
+  irq("irq"),
+  m_pirq(pirq),
+  m_status(0),
+  m_chain(0),
+  m_descriptors(0),
+  m_bytes(0),
+  m_busy(false),
+  m_irq(false),
+  m_buffer(BUFFER_SIZE) {
+  init_apb(pindex, 0x03, 0x00F, 0, pirq, APBIO, pmask, 0, 0, paddr);
+
+  init_registers();
+  SC_THREAD(run);
+}
+
+void AHBDMA::init_registers() {
+  r.create_register("CTRL", "DMA Control Register",
+    0x00,        // offset
+    0x00,
+    0x03)
+  .callback(SR_PRE_READ, this, &AHBDMA::ctrl_read)
+  .callback(SR_POST_WRITE, this, &AHBDMA::ctrl_write);
+  r.create_register("DESC", "DMA First Descriptor Register",
+    0x04,  // offset
+    0x00000000,
+    0xFFFFFFFC);
+  r.create_register("STATUS", "DMA Status Register",
+    0x08,       // offset
+    0x00000000,
+    0x00000003)
+  .callback(SR_PRE_READ, this, &AHBDMA::status_read)
+  .callback(SR_POST_WRITE, this, &AHBDMA::status_write);
+  r.create_register("CURRENT", "DMA Current Descriptor Register",
+    0x0C,       // offset
+    0x00000000,
+    0x00000000);
+}
+
+AHBDMA::~AHBDMA() {
+  GC_UNREGISTER_CALLBACKS();
+}
+
+void AHBDMA::end_of_simulation() {
+  v::info << name() << "Descriptors: " << m_descriptors << ", bytes moved: " << m_bytes << v::endl;
+}
+
+void AHBDMA::ctrl_read() {
+  r[0x0] = (r[0x0] & 0x3) | (m_busy << 2);
+}
+
+void AHBDMA::ctrl_write() {
+  if ((r[0x0] & 0x1) && !m_busy) {
+    // busy from now on, the processor may poll before the engine runs
+    m_busy = true;
+    m_start.notify();
+  }
+  update_irq();
+}
+
+void AHBDMA::status_read() {
+  uint32_t chain = m_chain > 0xFFFF ? 0xFFFF : m_chain;
+  r[0x8] = (chain << 16) | m_status;
+}
+
+void AHBDMA::status_write() {
+  m_status &= ~(r[0x8] & 0x3);
+  update_irq();
+}
+
+void AHBDMA::run() {
+  PROFILE_PROCESS();
+  while (true) {
+    ProcessProfiler::wait(m_start);
+    m_chain = 0;
+    m_status = 0;
+    update_irq();
+
+    uint32_t desc = r[0x4];
+    while (desc && (r[0x0] & 0x1)) {
+      r[0xC] = desc;
+      if (!execute(desc, &desc)) {
+        m_status |= 0x2;
+        break;
+      }
+    }
+
+    // The data is in memory before software hears of it
+    ahbsync();
+    r[0x0] = r[0x0] & ~0x1;
+    m_busy = false;
+    if (!(m_status & 0x2)) {
+      m_status |= 0x1;
+    }
+    update_irq();
+  }
+}
+
+bool AHBDMA::execute(uint32_t desc, uint32_t *next) {
+  uint8_t raw[32];
+  uint32_t word[8];
+  ahbread2d(desc, raw, sizeof(raw), 1, sizeof(raw));
+  for (uint32_t i = 0; i < 8; i++) {
+    word[i] = (raw[4 * i] << 24) | (raw[4 * i + 1] << 16) | (raw[4 * i + 2] << 8) | raw[4 * i + 3];
+  }
+  uint32_t ctrl = word[1];
+  uint32_t width = word[4];
+  uint32_t height = word[5];
+
+  switch (ctrl & 0x3) {
+    case DMA_COPY:
+      height = 1;
+      copy(word[2], word[3], width, 1, width, width);
+      break;
+    case DMA_COPY2D:
+      copy(word[2], word[3], width, height, word[6], word[7]);
+      break;
+    case DMA_FILL:
+      fill(word[2], word[3], width, height, word[7]);
+      break;
+    default:
+      v::warn << name() << "Descriptor at " << v::uint32 << desc << " has no valid type" << v::endl;
+      return false;
+  }
+
+  // Mark the descriptor done for software walking the chain
+  ctrl |= 0x80000000;
+  raw[4] = ctrl >> 24;
+  raw[5] = ctrl >> 16;
+  raw[6] = ctrl >> 8;
+  raw[7] = ctrl;
+  ahbwrite2d(desc + 4, &raw[4], 4, 1, 4);
+
+  m_chain++;
+  m_descriptors++;
+  m_bytes += static_cast<uint64_t>(width) * height;
+  if (ctrl & 0x4) {
+    ahbsync();
+    m_status |= 0x1;
+    update_irq();
+  }
+  *next = word[0] & ~0x3;
+  return true;
+}
+
+void AHBDMA::copy(uint32_t src, uint32_t dst, uint32_t width, uint32_t height, uint32_t src_stride, uint32_t dst_stride) {
+  if (!width) {
+    return;
+  }
+  if (width <= BUFFER_SIZE) {
+    // as many rows as fit into the buffer per transfer
+    uint32_t rows = BUFFER_SIZE / width;
+    for (uint32_t y = 0; y < height; y += rows) {
+      uint32_t count = std::min(rows, height - y);
+      ahbread2d(src + y * src_stride, &m_buffer[0], width, count, src_stride);
+      ahbwrite2d(dst + y * dst_stride, &m_buffer[0], width, count, dst_stride);
+    }
+    return;
+  }
+  for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t done = 0; done < width; done += BUFFER_SIZE) {
+      uint32_t length = std::min(width - done, BUFFER_SIZE);
+      ahbread2d(src + y * src_stride + done, &m_buffer[0], length, 1, length);
+      ahbwrite2d(dst + y * dst_stride + done, &m_buffer[0], length, 1, length);
+    }
+  }
+}
+
+void AHBDMA::fill(uint32_t pattern, uint32_t dst, uint32_t width, uint32_t height, uint32_t dst_stride) {
+  uint32_t length = std::min(width, BUFFER_SIZE);
+  for (uint32_t i = 0; i < length; i++) {
+    m_buffer[i] = pattern >> (24 - 8 * (i & 0x3));
+  }
+  // the buffer holds whole patterns, so every piece of a row starts in phase
+  for (uint32_t done = 0; done < width; done += BUFFER_SIZE) {
+    ahbwrite2d(dst + done, &m_buffer[0], std::min(width - done, BUFFER_SIZE), 1, dst_stride, height);
+  }
+}
+
+void AHBDMA::update_irq() {
+  bool level = (r[0x0] & 0x2) && m_status;
+  if (level != m_irq) {
+    m_irq = level;
+    irq.write(std::make_pair(1 << m_pirq, level));
+  }
+}
+
+/// @}
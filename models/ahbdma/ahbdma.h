@@ -0,0 +1,124 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbdma
+/// @{
+/// @file ahbdma.h
+/// DMA engine working through linked lists of descriptors.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBDMA_AHBDMA_H_
+#define MODELS_AHBDMA_AHBDMA_H_
+
+#include <amba.h>
+#include <vector>
+
+#include "core/common/base.h"
+#include "models/ahbvideomaster/ahbvideomaster.h"
+#include "core/common/apbdevice.h"
+#include "core/common/apbslave.h"
+#include "core/common/clkdevice.h"
+
+#include "core/common/sr_signal.h"
+
+/// Copies and fills memory on the AHB in place of the processor.
+///
+/// Software builds a chain of descriptors in memory, writes the address of
+/// the first one to DESC and starts the engine. Each descriptor is eight
+/// big endian words:
+/// - 0x00 NEXT       next descriptor, 0 ends the chain
+/// - 0x04 CTRL       bits 1..0: 0 copy, 1 2D copy, 2 fill,
+///                   bit 2: IRQ after this descriptor,
+///                   bit 31: set by the engine when done
+/// - 0x08 SRC        source address, the 32 bit pattern for a fill
+/// - 0x0C DST        destination address
+/// - 0x10 WIDTH      bytes to copy, bytes per row for 2D copy and fill
+/// - 0x14 HEIGHT     rows for 2D copy and fill
+/// - 0x18 SRC_STRIDE bytes from one source row to the next
+/// - 0x1C DST_STRIDE bytes from one destination row to the next
+///
+/// Registers:
+/// - 0x00 CTRL    bit 0: start (cleared when the chain ends, writing 0
+///                stops after the current descriptor), bit 1: IRQ enable,
+///                bit 2: busy (read)
+/// - 0x04 DESC    address of the first descriptor
+/// - 0x08 STATUS  bit 0: done, bit 1: error, bits 31..16: descriptors done
+///                since the start. Writing 1 clears bit 0 or 1.
+/// - 0x0C CURRENT descriptor in progress or the last one
+///
+/// Done is set at the end of the chain and after descriptors asking for
+/// an IRQ. The IRQ is high while done or error is set and IRQs are enabled.
+/// Data moves through the transfers of AHBVideoMaster, so a copy costs bus
+/// time only and takes DMI shortcuts where the fidelity allows. Source and
+/// destination of a copy must not overlap.
+class AHBDMA : public AHBVideoMaster<APBSlave>, public CLKDevice {
+  public:
+    SC_HAS_PROCESS(AHBDMA);
+    SR_HAS_SIGNALS(AHBDMA);
+    GC_HAS_CALLBACKS();
+
+    /// Level of the completion interrupt
+    signal<std::pair<uint32_t, bool> >::out irq;
+
+    AHBDMA(sc_module_name name,
+      uint32_t hindex,
+      uint32_t pindex,
+      uint32_t paddr,
+      uint32_t pmask,
+      uint32_t pirq,
+      AbstractionLayer ambaLayer = amba::amba_LT);
+
+    /// Destructor
+    ~AHBDMA();
+
+    void init_registers();
+
+    sc_core::sc_time get_clock() {return clock_cycle; }
+
+    /// Descriptor types
+    enum DescriptorType {
+      DMA_COPY = 0,
+      DMA_COPY2D = 1,
+      DMA_FILL = 2
+    };
+
+    /// Bytes moved through the buffer of the engine at a time
+    static const uint32_t BUFFER_SIZE = 0x10000;
+
+  protected:
+    /// Works through the chains
+    void run();
+
+    void ctrl_read();
+    void ctrl_write();
+    void status_read();
+    void status_write();
+
+    /// Execute one descriptor, false on an invalid one
+    bool execute(uint32_t desc, uint32_t *next);
+    void copy(uint32_t src, uint32_t dst, uint32_t width, uint32_t height, uint32_t src_stride, uint32_t dst_stride);
+    void fill(uint32_t pattern, uint32_t dst, uint32_t width, uint32_t height, uint32_t dst_stride);
+
+    /// Drive the interrupt after the status changed
+    void update_irq();
+
+    void end_of_simulation();
+
+    uint32_t m_pirq;
+    uint32_t m_status;
+    uint32_t m_chain;
+    uint64_t m_descriptors;
+    uint64_t m_bytes;
+    bool m_busy;
+    bool m_irq;
+
+    sc_event m_start;
+    std::vector<uint8_t> m_buffer;
+};
+
+#endif  // MODELS_AHBDMA_AHBDMA_H_
+/// @}
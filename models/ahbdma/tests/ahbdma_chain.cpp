@@ -0,0 +1,236 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbdma
+/// @{
+/// @file ahbdma_chain.cpp
+/// Descriptor chain of a copy, a 2D copy and a fill, and an invalid one.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include <amba.h>
+#include <tlm.h>
+#include <string.h>
+#include <vector>
+
+#include "core/common/systemc.h"
+#include "core/common/verbose.h"
+#include "core/common/sr_signal.h"
+#include "models/ahbdma/ahbdma.h"
+
+/// 64 kB of memory at address 0 without DMI
+class TestMemory : public sc_core::sc_module {
+  public:
+    amba::amba_slave_socket<32> ahb;
+
+    static const uint32_t SIZE = 0x10000;
+
+    explicit TestMemory(sc_core::sc_module_name name) :
+      sc_core::sc_module(name),
+      ahb("ahb", amba::amba_AHB, amba::amba_LT, false),
+      m_data(SIZE, 0) {
+      ahb.register_b_transport(this, &TestMemory::b_transport);
+      ahb.register_transport_dbg(this, &TestMemory::transport_dbg);
+      ahb.register_get_direct_mem_ptr(this, &TestMemory::get_direct_mem_ptr);
+    }
+
+    uint8_t &operator[](uint32_t addr) { return m_data[addr]; }
+
+    /// Store a big endian word
+    void word(uint32_t addr, uint32_t value) {
+      for (uint32_t i = 0; i < 4; i++) {
+        m_data[addr + i] = value >> (24 - 8 * i);
+      }
+    }
+
+    uint32_t word(uint32_t addr) const {
+      return (m_data[addr] << 24) | (m_data[addr + 1] << 16) | (m_data[addr + 2] << 8) | m_data[addr + 3];
+    }
+
+  private:
+    void b_transport(tlm::tlm_generic_payload &trans, sc_core::sc_time &delay) {
+      transport_dbg(trans);
+      delay += sc_core::sc_time(10, sc_core::SC_NS) * ((trans.get_data_length() + 3) / 4);
+    }
+
+    unsigned int transport_dbg(tlm::tlm_generic_payload &trans) {
+      uint32_t addr = trans.get_address();
+      uint32_t length = trans.get_data_length();
+      if (addr + length > SIZE) {
+        trans.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
+        return 0;
+      }
+      if (trans.is_write()) {
+        memcpy(&m_data[addr], trans.get_data_ptr(), length);
+      } else {
+        memcpy(trans.get_data_ptr(), &m_data[addr], length);
+      }
+      trans.set_response_status(tlm::TLM_OK_RESPONSE);
+      return length;
+    }
+
+    bool get_direct_mem_ptr(tlm::tlm_generic_payload &trans, tlm::tlm_dmi &dmi) {
+      return false;
+    }
+
+    std::vector<uint8_t> m_data;
+};
+
+/// Register access without an APB bus
+class TestDMA : public AHBDMA {
+  public:
+    explicit TestDMA(sc_core::sc_module_name name) :
+      AHBDMA(name, 1, 0, 0, 0xFFF, 5) {}
+
+    void write(uint32_t offset, uint32_t value) {
+      r[offset] = value;
+      if (offset == 0x0) {
+        ctrl_write();
+      } else if (offset == 0x8) {
+        status_write();
+      }
+    }
+
+    uint32_t read(uint32_t offset) {
+      if (offset == 0x0) {
+        ctrl_read();
+      } else if (offset == 0x8) {
+        status_read();
+      }
+      return r[offset];
+    }
+};
+
+/// Builds the chains, runs them and checks memory, status and IRQ
+class Testbench : public sc_core::sc_module {
+  public:
+    SC_HAS_PROCESS(Testbench);
+    SR_HAS_SIGNALS(Testbench);
+
+    signal<std::pair<uint32_t, bool> >::in irq;
+    amba::amba_master_socket<32> apb;
+
+    Testbench(sc_core::sc_module_name name, TestDMA &dma, TestMemory &mem) :
+      sc_core::sc_module(name),
+      irq(&Testbench::irq_in, "irq"),
+      apb("apb", amba::amba_APB, amba::amba_LT, false),
+      m_failures(0),
+      m_irq(false),
+      m_dma(dma),
+      m_mem(mem) {
+      SC_THREAD(run);
+    }
+
+    uint32_t failures() const { return m_failures; }
+
+  private:
+    void irq_in(const std::pair<uint32_t, bool> &value, const sc_core::sc_time &delay) {
+      check(value.first == (1u << 5), "IRQ line");
+      m_irq = value.second;
+    }
+
+    void check(bool ok, const char *what) {
+      if (!ok) {
+        v::error << name() << "Failed: " << what << v::endl;
+        m_failures++;
+      }
+    }
+
+    void descriptor(uint32_t addr, uint32_t next, uint32_t ctrl, uint32_t src, uint32_t dst,
+                    uint32_t width, uint32_t height, uint32_t src_stride, uint32_t dst_stride) {
+      m_mem.word(addr + 0x00, next);
+      m_mem.word(addr + 0x04, ctrl);
+      m_mem.word(addr + 0x08, src);
+      m_mem.word(addr + 0x0C, dst);
+      m_mem.word(addr + 0x10, width);
+      m_mem.word(addr + 0x14, height);
+      m_mem.word(addr + 0x18, src_stride);
+      m_mem.word(addr + 0x1C, dst_stride);
+    }
+
+    /// Start the chain at desc with IRQs enabled and wait for its end
+    void start(uint32_t desc) {
+      m_dma.write(0x4, desc);
+      m_dma.write(0x0, 0x3);
+      for (uint32_t i = 0; i < 1000 && (m_dma.read(0x0) & 0x4); i++) {
+        wait(1, sc_core::SC_US);
+      }
+      check(!(m_dma.read(0x0) & 0x5), "chain ends and clears start");
+    }
+
+    void run() {
+      for (uint32_t i = 0; i < 64; i++) {
+        m_mem[0x1000 + i] = i + 1;
+        m_mem[0x1100 + i] = 0x80 + i;
+      }
+      descriptor(0x100, 0x120, AHBDMA::DMA_COPY, 0x1000, 0x2000, 10, 0, 0, 0);
+      descriptor(0x120, 0x140, AHBDMA::DMA_COPY2D, 0x1100, 0x2100, 4, 3, 8, 16);
+      descriptor(0x140, 0, AHBDMA::DMA_FILL | 0x4, 0xDEADBEEF, 0x3000, 6, 3, 0, 16);
+      start(0x100);
+
+      for (uint32_t i = 0; i < 10; i++) {
+        check(m_mem[0x2000 + i] == i + 1, "copy data");
+      }
+      check(m_mem[0x2000 + 10] == 0, "copy length");
+      for (uint32_t y = 0; y < 3; y++) {
+        for (uint32_t x = 0; x < 4; x++) {
+          check(m_mem[0x2100 + y * 16 + x] == m_mem[0x1100 + y * 8 + x], "2D copy data");
+        }
+        check(m_mem[0x2100 + y * 16 + 4] == 0, "2D copy width");
+      }
+      // every row starts with the first byte of the pattern
+      const uint8_t pattern[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+      for (uint32_t y = 0; y < 3; y++) {
+        for (uint32_t x = 0; x < 6; x++) {
+          check(m_mem[0x3000 + y * 16 + x] == pattern[x & 0x3], "fill phase");
+        }
+        check(m_mem[0x3000 + y * 16 + 6] == 0, "fill width");
+      }
+      check(m_mem[0x3000 + 3 * 16] == 0, "fill height");
+      check(m_mem.word(0x104) == (0x80000000 | AHBDMA::DMA_COPY), "copy descriptor done");
+      check(m_mem.word(0x124) == (0x80000000 | AHBDMA::DMA_COPY2D), "2D copy descriptor done");
+      check(m_mem.word(0x144) == (0x80000000 | AHBDMA::DMA_FILL | 0x4), "fill descriptor done");
+      check(m_dma.read(0x8) == ((3 << 16) | 0x1), "status after the chain");
+      check(m_dma.read(0xC) == 0x140, "current descriptor");
+      check(m_irq, "IRQ raised at the end of the chain");
+
+      m_dma.write(0x8, 0x1);
+      wait(sc_core::SC_ZERO_TIME);
+      check(!m_irq, "IRQ cleared with done");
+
+      // a descriptor of type 3 stops the chain with an error
+      descriptor(0x160, 0x100, 0x3, 0, 0, 4, 1, 0, 0);
+      start(0x160);
+      check(m_dma.read(0x8) == 0x2, "status after an invalid descriptor");
+      check(m_mem.word(0x164) == 0x3, "invalid descriptor not marked");
+      check(m_irq, "IRQ raised on error");
+      sc_core::sc_stop();
+    }
+
+    uint32_t m_failures;
+    bool m_irq;
+    TestDMA &m_dma;
+    TestMemory &m_mem;
+};
+
+int sc_main(int argc, char *argv[]) {
+  TestMemory mem("mem");
+  TestDMA dma("dma");
+  Testbench tb("tb", dma, mem);
+  dma.ahb(mem.ahb);
+  tb.apb(dma.apb);
+  sr_signal::connect(dma.irq, tb.irq);
+  dma.set_clk(10, sc_core::SC_NS);
+
+  sc_core::sc_start();
+
+  if (tb.failures()) {
+    v::error << "ahbdma_chain" << tb.failures() << " checks failed" << v::endl;
+    return 1;
+  }
+  return 0;
+}
+/// @}
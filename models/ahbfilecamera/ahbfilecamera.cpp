@@ -0,0 +1,181 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbfilecamera
+/// @{
+/// @file ahbfilecamera.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/ahbfilecamera/ahbfilecamera.h"
+#include "models/apbbuffermanager/apbbuffermanager.h"
+#include "models/processprofiler/processprofiler.h"
+#include "core/common/verbose.h"
+#include <string.h>
+
+// Plug and play identifies the model as the camera it stands in for
+AHBFileCamera::AHBFileCamera(sc_module_name name,
+  uint32_t hindex,
+  uint32_t pindex,
+  uint32_t paddr,
+  uint32_t pmask,
+  uint32_t frame_width,
+  uint32_t frame_height,
+  const char *video,
+  AbstractionLayer ambaLayer,
+  bool loop,
+  uint32_t decimate,
+  uint32_t source_width,
+  uint32_t source_height,
+  uint32_t prefetch) :
+  AHBVideoMaster<APBSlave>(
+    name,
+    hindex,
+    0x03,
+    0x004,
+    0,
+    0,
+    ambaLayer,
+    BAR(), BAR(), BAR(), BAR()),
+  m_loop(loop),
+  m_decimate(decimate ? decimate : 1),
+  m_next(0),
+  m_frames(0),
+  m_skipped(0),
+  m_buffers(NULL),
+  m_frameToggle(false) {
+  init_apb(pindex, 0x03, 0x004, 0, 0, APBIO, pmask, 0, 0, paddr);
+  init_registers();
+  r[0x0C] = (frame_width << 16) | frame_height;
+
+  if (!m_file.open(video, source_width, source_height, prefetch)) {
+    v::error << this->name() << "No frames to capture" << v::endl;
+  }
+  m_row.resize(m_file.width() * 2);
+
+  SC_THREAD(capture);
+}
+
+AHBFileCamera::~AHBFileCamera() {
+  GC_UNREGISTER_CALLBACKS();
+}
+
+void AHBFileCamera::init_registers() {
+  r.create_register("CTRL", "Camera Control Register",
+    0x00,        // offset
+    0x00,
+    0xFFFF0003)
+  .callback(SR_POST_WRITE, this, &AHBFileCamera::ctrl_write);
+  r.create_register("ADDR", "Camera Video Address Register",
+    0x04,  // offset
+    0xA0000000,
+    0xFFFFF000);
+  r.create_register("POS", "Camera Position Register",
+    0x08,       // offset
+    0x00,
+    0xFFFFFFFF);
+  r.create_register("SIZE", "Camera Frame Size Register",
+    0x0C,     // offset
+    0x00,
+    0xFFFFFFFF);
+}
+
+void AHBFileCamera::end_of_simulation() {
+  v::info << name() << "Frames captured: " << m_frames << v::endl;
+  if (m_buffers) {
+    v::info << name() << "Frames skipped without a free buffer: " << m_skipped << v::endl;
+  }
+}
+
+void AHBFileCamera::ctrl_write() {
+  if ((r[0x0] & 0x3) == 0x3) {
+    m_captureEvent.notify();
+  }
+}
+
+void AHBFileCamera::resize(uint32_t frame, uint32_t width, uint32_t height) {
+  uint32_t src_width = m_file.width();
+  uint32_t src_height = m_file.height();
+  uint32_t last = src_height;
+  for (uint32_t y = 0; y < height; y++) {
+    uint32_t sy = static_cast<uint64_t>(y) * src_height / height;
+    if (sy != last) {
+      m_file.row(frame, sy, &m_row[0]);
+      last = sy;
+    }
+    uint8_t *out = &m_buffer[y * width * 2];
+    if (src_width == width) {
+      memcpy(out, &m_row[0], width * 2);
+      continue;
+    }
+    // U Y V Y groups are taken whole, so chroma stays with its luma
+    for (uint32_t x = 0; x < width / 2; x++) {
+      uint32_t sx = static_cast<uint64_t>(x) * src_width / width;
+      memcpy(out + x * 4, &m_row[sx * 4], 4);
+    }
+  }
+}
+
+// Waits for a capture request, then writes the next frame of the file
+// into the video memory or a free buffer of the pool and signals it on
+// triggerOut.
+void AHBFileCamera::capture() {
+  PROFILE_PROCESS();
+  while (true) {
+    ProcessProfiler::wait(m_captureEvent);
+    if (!m_file.is_open()) {
+      continue;
+    }
+    if (m_next >= m_file.frames()) {
+      if (!m_loop) {
+        v::info << name() << "End of video after " << m_frames << " frames" << v::endl;
+        m_file.close();
+        continue;
+      }
+      m_next %= m_file.frames();
+    }
+
+    uint32_t frame_width = (r[0x0C] >> 16) & 0xFFFF;
+    uint32_t frame_height = r[0x0C] & 0xFFFF;
+    uint32_t width = ((r[0x00] >> 16) & 0xFFFF) & ~1u;
+    uint32_t x = (r[0x08] >> 16) & 0xFFFF;
+    uint32_t y = r[0x08] & 0xFFFF;
+    if (!width || !frame_width || width > frame_width) {
+      v::warn << name() << "Video width " << width << " does not fit the frame" << v::endl;
+      continue;
+    }
+    uint32_t height = static_cast<uint64_t>(frame_height) * width / frame_width;
+    uint32_t stride = frame_width * 2;
+
+    uint32_t addr = r[0x04];
+    if (m_buffers) {
+      addr = m_buffers->dequeue_free();
+      if (!addr) {
+        m_skipped++;
+        m_next += m_decimate;
+        m_file.prefetch(m_next);
+        continue;
+      }
+    }
+
+    m_buffer.resize(width * 2 * height);
+    resize(m_next, width, height);
+    ahbwrite2d(addr + x * 2 + y * stride, &m_buffer[0], width * 2, height, stride);
+    ahbsync();
+    if (m_buffers) {
+      m_buffers->enqueue_full(addr);
+    }
+
+    m_next += m_decimate;
+    m_file.prefetch(m_next);
+    m_frames++;
+    m_frameToggle = !m_frameToggle;
+    triggerOut.write(m_frameToggle);
+  }
+}
+
+/// @}
@@ -0,0 +1,106 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbfilecamera
+/// @{
+/// @file ahbfilecamera.h
+/// Camera streaming raw YUV or Y4M frames from a file into video memory.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBFILECAMERA_AHBFILECAMERA_H_
+#define MODELS_AHBFILECAMERA_AHBFILECAMERA_H_
+
+#include <string>
+#include <vector>
+
+#include "core/common/base.h"
+#include "models/ahbvideomaster/ahbvideomaster.h"
+#include "models/ahbfilecamera/framefile.h"
+#include "core/common/apbdevice.h"
+#include "core/common/apbslave.h"
+#include "core/common/clkdevice.h"
+
+#include "core/common/sr_signal.h"
+
+class APBBufferManager;
+
+/// Drop-in replacement of AHBCamera without libav: every capture request
+/// copies the next frame of a memory-mapped raw YUV 4:2:2 (U Y V Y) or Y4M
+/// file into the video memory and toggles triggerOut.
+///
+/// Registers (as camera_regs of the demo software):
+/// - 0x00 CTRL  bits 31..16: video width in pixels, bit 0: enable,
+///              bit 1: capture a frame (written with bit 0)
+/// - 0x04 ADDR  video memory
+/// - 0x08 POS   x << 16 | y of the video in the frame
+/// - 0x0C SIZE  frame width << 16 | frame height in pixels
+///
+/// The video is as high as the frame scaled to the video width. Frames of
+/// another size are resized (nearest neighbour). Every decimate-th frame of
+/// the file is used, after the last one the file starts over if loop is
+/// set, otherwise the camera stops.
+///
+/// With a buffer manager set, every frame goes into a buffer of its free
+/// queue instead of ADDR and is put on its full queue afterwards. ADDR is
+/// not used then, a frame without a free buffer is skipped.
+class AHBFileCamera : public AHBVideoMaster<APBSlave>, public CLKDevice {
+  public:
+    SC_HAS_PROCESS(AHBFileCamera);
+    GC_HAS_CALLBACKS();
+
+    sc_out<bool> triggerOut;
+
+    /// source_width and source_height give the geometry of raw files,
+    /// Y4M files carry their own. prefetch frames are kept resident ahead.
+    AHBFileCamera(sc_module_name name,
+    uint32_t hindex,
+    uint32_t pindex,
+    uint32_t paddr,
+    uint32_t pmask,
+    uint32_t frame_width,
+    uint32_t frame_height,
+    const char *video,
+    AbstractionLayer ambaLayer = amba::amba_LT,
+    bool loop = true,
+    uint32_t decimate = 1,
+    uint32_t source_width = 320,
+    uint32_t source_height = 240,
+    uint32_t prefetch = 4);
+
+    ~AHBFileCamera();
+
+    void init_registers();
+    void end_of_simulation();
+
+    sc_core::sc_time get_clock() {return clock_cycle; }
+
+    /// Hand the frames to a consumer through the pool of buffers
+    void set_buffers(APBBufferManager *buffers) { m_buffers = buffers; }
+
+  protected:
+    void capture();
+    void ctrl_write();
+
+    /// Scale the source frame into m_buffer
+    void resize(uint32_t frame, uint32_t width, uint32_t height);
+
+    FrameFile m_file;
+    bool m_loop;
+    uint32_t m_decimate;
+    uint32_t m_next;
+    uint32_t m_frames;
+    uint32_t m_skipped;
+    APBBufferManager *m_buffers;
+
+    std::vector<uint8_t> m_buffer;
+    std::vector<uint8_t> m_row;
+    bool m_frameToggle;
+    sc_event m_captureEvent;
+};
+
+#endif  // MODELS_AHBFILECAMERA_AHBFILECAMERA_H_
+/// @}
@@ -0,0 +1,214 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbfilecamera
+/// @{
+/// @file framefile.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/ahbfilecamera/framefile.h"
+#include "core/common/verbose.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+FrameFile::FrameFile() :
+  m_data(NULL),
+  m_size(0),
+  m_width(0),
+  m_height(0),
+  m_planar(false),
+  m_depth(0),
+  m_next(0),
+  m_requested(false),
+  m_stop(false) {
+}
+
+FrameFile::~FrameFile() {
+  close();
+}
+
+bool FrameFile::open(const std::string &file, uint32_t width, uint32_t height, uint32_t prefetch) {
+  close();
+  int fd = ::open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    v::error << "FrameFile" << "Cannot open video file " << file << v::endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) || !st.st_size) {
+    v::error << "FrameFile" << "Video file " << file << " is empty" << v::endl;
+    ::close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping keeps the file open
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    v::error << "FrameFile" << "Cannot map video file " << file << v::endl;
+    return false;
+  }
+  m_data = static_cast<const uint8_t *>(data);
+  m_size = st.st_size;
+  // frames are streamed front to back
+  madvise(data, m_size, MADV_SEQUENTIAL);
+
+  if (m_size >= 9 && !memcmp(m_data, "YUV4MPEG2", 9)) {
+    if (!index_y4m(file)) {
+      close();
+      return false;
+    }
+  } else {
+    m_width = width;
+    m_height = height;
+    m_planar = false;
+    size_t frame = static_cast<size_t>(width) * height * 2;
+    for (size_t offset = 0; frame && offset + frame <= m_size; offset += frame) {
+      m_frames.push_back(offset);
+    }
+  }
+  if (m_frames.empty() || m_width & 1) {
+    v::error << "FrameFile" << "No " << m_width << "x" << m_height << " YUV 4:2:2 frames in " << file << v::endl;
+    close();
+    return false;
+  }
+  v::info << "FrameFile" << "Mapped " << m_frames.size() << " frames of " << m_width << "x" << m_height
+          << " from " << file << v::endl;
+
+  m_depth = prefetch;
+  if (m_depth) {
+    m_stop = false;
+    m_thread = boost::thread(&FrameFile::prefetcher, this);
+    this->prefetch(0);
+  }
+  return true;
+}
+
+void FrameFile::close() {
+  if (m_thread.joinable()) {
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      m_stop = true;
+      m_cond.notify_all();
+    }
+    m_thread.join();
+  }
+  if (m_data) {
+    munmap(const_cast<uint8_t *>(m_data), m_size);
+    m_data = NULL;
+  }
+  m_frames.clear();
+  m_requested = false;
+}
+
+// The stream header is followed by frames of "FRAME[ params]\n" and the
+// Y, U and V planes: YUV4MPEG2 W<w> H<h> [F I A X params] C<colorspace>
+bool FrameFile::index_y4m(const std::string &file) {
+  const uint8_t *end = static_cast<const uint8_t *>(memchr(m_data, '\n', m_size));
+  if (!end) {
+    v::error << "FrameFile" << "Truncated Y4M header in " << file << v::endl;
+    return false;
+  }
+  std::string header(reinterpret_cast<const char *>(m_data), end - m_data);
+  std::string colorspace = "420jpeg";
+  m_width = m_height = 0;
+  for (size_t pos = header.find(' '); pos != std::string::npos; pos = header.find(' ', pos + 1)) {
+    switch (header[pos + 1]) {
+      case 'W':
+        m_width = strtoul(header.c_str() + pos + 2, NULL, 10);
+        break;
+      case 'H':
+        m_height = strtoul(header.c_str() + pos + 2, NULL, 10);
+        break;
+      case 'C':
+        colorspace = header.substr(pos + 2, header.find(' ', pos + 1) - pos - 2);
+        break;
+      default:
+        break;
+    }
+  }
+  if (colorspace != "422") {
+    v::error << "FrameFile" << "Y4M colorspace " << colorspace << " of " << file << " is not 4:2:2" << v::endl;
+    return false;
+  }
+  m_planar = true;
+  size_t frame = static_cast<size_t>(m_width) * m_height * 2;
+  size_t offset = end - m_data + 1;
+  while (offset + 5 < m_size && !memcmp(m_data + offset, "FRAME", 5)) {
+    end = static_cast<const uint8_t *>(memchr(m_data + offset, '\n', m_size - offset));
+    if (!end || end - m_data + 1 + frame > m_size) {
+      break;
+    }
+    offset = end - m_data + 1;
+    m_frames.push_back(offset);
+    offset += frame;
+  }
+  return true;
+}
+
+void FrameFile::row(uint32_t frame, uint32_t y, uint8_t *row) const {
+  const uint8_t *data = m_data + m_frames[frame];
+  if (!m_planar) {
+    memcpy(row, data + static_cast<size_t>(y) * m_width * 2, m_width * 2);
+    return;
+  }
+  size_t plane = static_cast<size_t>(m_width) * m_height;
+  const uint8_t *luma = data + y * m_width;
+  const uint8_t *u = data + plane + y * (m_width / 2);
+  const uint8_t *v = data + plane + plane / 2 + y * (m_width / 2);
+  for (uint32_t x = 0; x < m_width / 2; x++) {
+    row[x * 4 + 0] = u[x];
+    row[x * 4 + 1] = luma[x * 2];
+    row[x * 4 + 2] = v[x];
+    row[x * 4 + 3] = luma[x * 2 + 1];
+  }
+}
+
+void FrameFile::prefetch(uint32_t first) {
+  if (!m_depth) {
+    return;
+  }
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  m_next = first;
+  m_requested = true;
+  m_cond.notify_all();
+}
+
+// Reads one byte per page of the frames ahead, the simulation thread then
+// finds them resident. Frames wrap around since the camera may loop.
+void FrameFile::prefetcher() {
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t frame = static_cast<size_t>(m_width) * m_height * 2;
+  volatile uint8_t sink = 0;
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  while (true) {
+    while (!m_requested && !m_stop) {
+      m_cond.wait(lock);
+    }
+    if (m_stop) {
+      break;
+    }
+    uint32_t first = m_next;
+    m_requested = false;
+    lock.unlock();
+    for (uint32_t i = 0; i < m_depth && i < m_frames.size(); i++) {
+      size_t start = m_frames[(first + i) % m_frames.size()];
+      size_t aligned = start & ~(page - 1);
+      madvise(const_cast<uint8_t *>(m_data) + aligned, start + frame - aligned, MADV_WILLNEED);
+      for (size_t offset = start; offset < start + frame; offset += page) {
+        sink += m_data[offset];
+      }
+    }
+    lock.lock();
+  }
+}
+
+/// @}
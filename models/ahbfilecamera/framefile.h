@@ -0,0 +1,79 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbfilecamera
+/// @{
+/// @file framefile.h
+/// Memory-mapped raw YUV 4:2:2 and Y4M video files.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBFILECAMERA_FRAMEFILE_H_
+#define MODELS_AHBFILECAMERA_FRAMEFILE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <boost/thread.hpp>
+
+/// Maps a video file into memory and returns its rows in the byte order of
+/// the video memory (U Y V Y).
+///
+/// Files starting with "YUV4MPEG2" are read as Y4M, which must be 4:2:2
+/// (planar, converted per row). Everything else is raw packed UYVY of the
+/// geometry given to open(). A background thread touches the pages of the
+/// frames ahead of the one requested last, so the simulation does not stall
+/// on page faults.
+class FrameFile {
+  public:
+    FrameFile();
+
+    /// Stops the prefetch thread and unmaps the file
+    ~FrameFile();
+
+    /// Map a file, width and height are used for raw files only.
+    /// Keeps prefetch frames resident ahead of the current one.
+    bool open(const std::string &file, uint32_t width, uint32_t height, uint32_t prefetch);
+
+    void close();
+
+    bool is_open() const { return m_data != NULL; }
+    uint32_t frames() const { return m_frames.size(); }
+    uint32_t width() const { return m_width; }
+    uint32_t height() const { return m_height; }
+
+    /// Copy row y of a frame into row (width * 2 bytes) as U Y V Y
+    void row(uint32_t frame, uint32_t y, uint8_t *row) const;
+
+    /// Ask the prefetch thread to keep the frames from first on resident
+    void prefetch(uint32_t first);
+
+  private:
+    /// Parse the Y4M stream header and index the frames, false on errors
+    bool index_y4m(const std::string &file);
+
+    void prefetcher();
+
+    const uint8_t *m_data;
+    size_t m_size;
+    uint32_t m_width;
+    uint32_t m_height;
+    bool m_planar;
+    /// Offset of the pixel data of every frame
+    std::vector<size_t> m_frames;
+
+    uint32_t m_depth;
+    uint32_t m_next;
+    bool m_requested;
+    bool m_stop;
+    boost::mutex m_mutex;
+    boost::condition_variable m_cond;
+    boost::thread m_thread;
+};
+
+#endif  // MODELS_AHBFILECAMERA_FRAMEFILE_H_
+/// @}
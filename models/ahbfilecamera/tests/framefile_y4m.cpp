@@ -0,0 +1,113 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbfilecamera
+/// @{
+/// @file framefile_y4m.cpp
+/// Y4M header parsing, frame indexing and row conversion of FrameFile.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+
+#include "core/common/systemc.h"
+#include "core/common/verbose.h"
+#include "models/ahbfilecamera/framefile.h"
+
+static uint32_t failures = 0;
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    v::error << "framefile_y4m" << "Failed: " << what << v::endl;
+    failures++;
+  }
+}
+
+/// Write data to a new temporary file and return its name
+static std::string temp_file(const std::string &data) {
+  char name[] = "/tmp/framefile_y4mXXXXXX";
+  int fd = mkstemp(name);
+  if (fd < 0 || write(fd, data.data(), data.size()) != static_cast<ssize_t>(data.size())) {
+    v::error << "framefile_y4m" << "Cannot write " << name << v::endl;
+    exit(1);
+  }
+  close(fd);
+  return name;
+}
+
+/// Planes of a 4x2 4:2:2 frame: 8 Y, 4 U and 4 V bytes
+static std::string planes(uint8_t frame) {
+  std::string data;
+  for (uint8_t i = 0; i < 16; i++) {
+    data += static_cast<char>(frame * 0x20 + i);
+  }
+  return data;
+}
+
+static bool opens(const std::string &data, uint32_t width = 0, uint32_t height = 0) {
+  std::string name = temp_file(data);
+  FrameFile file;
+  bool ok = file.open(name, width, height, 0);
+  unlink(name.c_str());
+  return ok;
+}
+
+int sc_main(int argc, char *argv[]) {
+  // two frames, one with frame parameters, and a truncated third one
+  std::string y4m = "YUV4MPEG2 W4 H2 F25:1 Ip A1:1 C422 XYSCSS=422\n";
+  y4m += "FRAME\n" + planes(0);
+  y4m += "FRAME Ip\n" + planes(1);
+  y4m += "FRAME\n" + planes(2).substr(0, 5);
+  std::string name = temp_file(y4m);
+  {
+    FrameFile file;
+    check(file.open(name, 640, 480, 2), "open Y4M");
+    check(file.width() == 4 && file.height() == 2, "geometry from the header");
+    check(file.frames() == 2, "complete frames only");
+    // frame 1, row 1: Y 0x24..0x27, U 0x2A 0x2B, V 0x2E 0x2F
+    uint8_t row[8];
+    file.row(1, 1, row);
+    const uint8_t expected[8] = {0x2A, 0x24, 0x2E, 0x25, 0x2B, 0x26, 0x2F, 0x27};
+    for (uint32_t i = 0; i < 8; i++) {
+      check(row[i] == expected[i], "U Y V Y row of a planar frame");
+    }
+    file.row(0, 0, row);
+    check(row[0] == 0x08 && row[1] == 0x00 && row[2] == 0x0C && row[3] == 0x01, "first row");
+    file.prefetch(1);
+    file.close();
+    check(!file.is_open(), "closed");
+  }
+  unlink(name.c_str());
+
+  check(!opens("YUV4MPEG2 W4 H2 C420jpeg\nFRAME\n" + planes(0)), "4:2:0 refused");
+  check(!opens("YUV4MPEG2 W4 H2\nFRAME\n" + planes(0)), "missing colorspace means 4:2:0");
+  check(!opens("YUV4MPEG2 W3 H2 C422\nFRAME\n" + planes(0)), "odd width refused");
+  check(!opens("YUV4MPEG2 W4 H2 C422"), "header without newline");
+  check(!opens("YUV4MPEG2 W4 H2 C422\n"), "no frames");
+
+  // raw UYVY takes the geometry given to open
+  std::string raw = planes(0) + planes(1).substr(0, 4);
+  name = temp_file(raw);
+  {
+    FrameFile file;
+    check(file.open(name, 2, 2, 0), "open raw");
+    check(file.frames() == 2, "raw frames of 8 bytes, the partial one dropped");
+    uint8_t row[4];
+    file.row(1, 1, row);
+    check(row[0] == 0x0C && row[3] == 0x0F, "raw rows are copied");
+  }
+  unlink(name.c_str());
+
+  if (failures) {
+    v::error << "framefile_y4m" << failures << " checks failed" << v::endl;
+    return 1;
+  }
+  return 0;
+}
+/// @}
@@ -0,0 +1,102 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbframebuffer
+/// @{
+/// @file ahbframebuffer.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/ahbframebuffer/ahbframebuffer.h"
+#include "core/common/verbose.h"
+#include <string.h>
+#include <sys/mman.h>
+
+AHBFrameBuffer::AHBFrameBuffer(ModuleName name,
+  uint16_t haddr,
+  uint16_t hmask,
+  AbstractionLayer ambaLayer,
+  uint32_t hindex,
+  bool cacheable,
+  uint32_t wait_states,
+  bool hugepages) :
+  AHBSlave<>(name,
+    hindex,
+    0x03,
+    0x009,
+    0,
+    0,
+    ambaLayer,
+    BAR(AHBMEM, hmask, cacheable, 0, haddr)),
+  m_base(static_cast<uint32_t>(haddr & hmask) << 20),
+  m_size(((~hmask & 0xFFF) + 1) << 20),
+  m_wait_states(wait_states),
+  m_data(NULL) {
+  void *data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (hugepages) {
+    data = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (data == MAP_FAILED) {
+    data = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+#ifdef MADV_HUGEPAGE
+    if (hugepages && data != MAP_FAILED) {
+      madvise(data, m_size, MADV_HUGEPAGE);
+    }
+#endif
+  }
+  if (data == MAP_FAILED) {
+    v::error << this->name() << "Cannot map " << (m_size >> 20) << " MB of frame buffer" << v::endl;
+    return;
+  }
+  m_data = static_cast<uint8_t *>(data);
+  v::info << this->name() << "Frame buffer of " << (m_size >> 20) << " MB at " << v::uint32 << m_base << v::endl;
+}
+
+AHBFrameBuffer::~AHBFrameBuffer() {
+  if (m_data) {
+    munmap(m_data, m_size);
+  }
+}
+
+uint32_t AHBFrameBuffer::exec_func(tlm::tlm_generic_payload &trans, sc_core::sc_time &delay, bool debug) {
+  uint32_t offset = trans.get_address() - m_base;
+  uint32_t length = trans.get_data_length();
+  if (!m_data || offset >= m_size || length > m_size - offset) {
+    v::error << name() << "Access to " << v::uint32 << trans.get_address() << " outside the frame buffer" << v::endl;
+    trans.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
+    return 0;
+  }
+  if (trans.is_write()) {
+    memcpy(m_data + offset, trans.get_data_ptr(), length);
+  } else {
+    memcpy(trans.get_data_ptr(), m_data + offset, length);
+  }
+  if (!debug) {
+    delay += clock_cycle * (((length + 3) / 4) * (1 + m_wait_states));
+  }
+  trans.set_dmi_allowed(true);
+  trans.set_response_status(tlm::TLM_OK_RESPONSE);
+  return length;
+}
+
+bool AHBFrameBuffer::get_direct_mem_ptr(tlm::tlm_generic_payload &trans, tlm::tlm_dmi &dmi_data) {
+  if (!m_data) {
+    return false;
+  }
+  dmi_data.set_dmi_ptr(m_data);
+  dmi_data.set_start_address(m_base);
+  dmi_data.set_end_address(m_base + m_size - 1);
+  dmi_data.allow_read_write();
+  // per word, as in exec_func
+  dmi_data.set_read_latency(clock_cycle * (1 + m_wait_states));
+  dmi_data.set_write_latency(clock_cycle * (1 + m_wait_states));
+  return true;
+}
+
+/// @}
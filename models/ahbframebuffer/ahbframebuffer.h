@@ -0,0 +1,65 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbframebuffer
+/// @{
+/// @file ahbframebuffer.h
+/// AHB memory for video frames, backed by one contiguous host allocation.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBFRAMEBUFFER_AHBFRAMEBUFFER_H_
+#define MODELS_AHBFRAMEBUFFER_AHBFRAMEBUFFER_H_
+
+#include <amba.h>
+
+#include "core/common/base.h"
+#include "core/common/ahbslave.h"
+#include "core/common/clkdevice.h"
+
+/// RAM for frame buffers on the AHB. Unlike the MapStorage of the MCtrl
+/// memories, the whole area is one mmap'ed block of host memory, so an
+/// access is a memcpy and masters get a DMI pointer to all of it.
+///
+/// Every word of an access takes one clock plus the wait states. Debug
+/// transfers take no time. The block is mapped lazily, pages not touched by
+/// the simulation cost no host memory. With hugepages the block is mapped
+/// from the huge page pool if one is configured and marked for transparent
+/// huge pages otherwise.
+class AHBFrameBuffer : public AHBSlave<>, public CLKDevice {
+  public:
+    /// haddr and hmask give the area in MB as for AHBMem
+    AHBFrameBuffer(ModuleName name,
+      uint16_t haddr,
+      uint16_t hmask,
+      AbstractionLayer ambaLayer,
+      uint32_t hindex,
+      bool cacheable,
+      uint32_t wait_states,
+      bool hugepages = false);
+
+    ~AHBFrameBuffer();
+
+    /// Read or write the block, called by the AHB socket
+    uint32_t exec_func(tlm::tlm_generic_payload &trans, sc_core::sc_time &delay, bool debug = false);
+
+    /// Grant the whole block
+    bool get_direct_mem_ptr(tlm::tlm_generic_payload &trans, tlm::tlm_dmi &dmi_data);
+
+    sc_core::sc_time get_clock() { return clock_cycle; }
+
+    uint32_t base() const { return m_base; }
+    uint32_t size() const { return m_size; }
+
+  private:
+    uint32_t m_base;
+    uint32_t m_size;
+    uint32_t m_wait_states;
+    uint8_t *m_data;
+};
+
+#endif  // MODELS_AHBFRAMEBUFFER_AHBFRAMEBUFFER_H_
+/// @}
@@ -14,13 +14,19 @@
 ///
 
 #include "models/ahbframetrigger/ahbframetrigger.h"
+#include "models/processprofiler/processprofiler.h"
+#include <stdlib.h>
+#include <sys/time.h>
+#include <fstream>
+#include <sstream>
 
 /// Constructor
 AHBFrameTrigger::AHBFrameTrigger(ModuleName name,     // The SystemC name of the component
   unsigned int hindex,                         // The master index for registering with the AHB
   sc_core::sc_time interval,                   // The interval between data frames
   bool pow_mon,                                // Enable power monitoring
-  AbstractionLayer ambaLayer) :            // TLM abstraction layer
+  AbstractionLayer ambaLayer,              // TLM abstraction layer
+  std::string stimulus) :                  // Stimulus file
     AHBMaster<>(name,                            // SystemC name
       hindex,                                    // Bus master index
       0x04,                                      // Vender ID (4 = ESA)
@@ -28,22 +34,33 @@ AHBFrameTrigger::AHBFrameTrigger(ModuleName name,     // The SystemC name of the
       0,                                         // Version
       0,                                         // IRQ of device
       ambaLayer),                                // AmbaLayer
+    frameOut("frameOut"),                        // Frame stamp port
     m_interval(interval),                        // Initialize frame interval
     m_master_id(hindex),                         // Initialize bus index
+    m_stimulus(stimulus),                        // Initialize stimulus file
+    m_loop(0),
+    m_kicks(0),
+    m_frames_in_flight(0),
+    m_timeout(1, SC_SEC),
+    m_frames_done(0),
+    m_frames_lost(0),
+    m_host_first_kick(0.0),
+    m_host_last_done(0.0),
     m_pow_mon(pow_mon),                          // Initialize pow_mon
     m_abstractionLayer(ambaLayer) {              // Initialize abstraction layer
-  // Register frame_trigger thread
-  SC_THREAD(frame_trigger);
-
-  // Register thread for generating the actual data frame
+  // Register thread replaying the stimulus
   SC_THREAD(gen_frame);
-  sensitive << new_frame;
+
+  SC_METHOD(stage_monitor);
+  sensitive << watchIn;
+  dont_initialize();
 
   // Module Configuration Report
   v::info << this->name() << " ************************************************** " << v::endl;
   v::info << this->name() << " * Created AHBFrameTrigger in following configuration: " << v::endl;
   v::info << this->name() << " * --------------------------------------------- " << v::endl;
   v::info << this->name() << " * abstraction Layer (LT = 8 / AT = 4): " << m_abstractionLayer << v::endl;
+  v::info << this->name() << " * stimulus: " << (m_stimulus.empty() ? "built-in" : m_stimulus) << v::endl;
   v::info << this->name() << " ************************************************** " << v::endl;
 }
 
@@ -52,39 +69,266 @@ void AHBFrameTrigger::dorst() {
   // Nothing to do
 }
 
-// This thread generates a "new_frame" event at intervals "m_interval"
-void AHBFrameTrigger::frame_trigger() {
-  while (1) {
-    // Wait for m_interval SystemC time
-    wait(m_interval);
+void AHBFrameTrigger::watch(const std::string &name, sc_signal_in_if<bool> &signal) {
+  m_watch_names.push_back(name);
+  watchIn(signal);
+}
+
+void AHBFrameTrigger::closed_loop(uint32_t frames_in_flight, const std::string &stages, sc_core::sc_time timeout) {
+  m_frames_in_flight = frames_in_flight;
+  m_stage_names = stages;
+  m_timeout = timeout;
+}
+
+void AHBFrameTrigger::end_of_elaboration() {
+  if (m_stimulus.empty()) {
+    default_stimulus();
+  } else if (!load_stimulus(m_stimulus)) {
+    // The built-in program drives another pipeline, replaying it would stall quietly
+    SC_REPORT_ERROR(this->name(), ("Cannot load stimulus " + m_stimulus).c_str());
+    return;
+  }
+  v::info << this->name() << "Stimulus program with " << m_program.size() << " writes, loop at " << m_loop << v::endl;
+
+  if (!m_frames_in_flight) {
+    return;
+  }
+  std::istringstream names(m_stage_names);
+  std::string stage;
+  while (std::getline(names, stage, ',')) {
+    for (size_t i = 0; i < m_watch_names.size(); i++) {
+      if (m_watch_names[i] == stage) {
+        m_stages.push_back(i);
+      }
+    }
+    if (m_stages.size() != m_stage_busy.size() + 1) {
+      v::error << this->name() << "Unknown closed-loop stage " << stage << v::endl;
+      m_stages.resize(m_stage_busy.size());
+      continue;
+    }
+    m_stage_busy.push_back(SC_ZERO_TIME);
+  }
+  m_stage_in.assign(m_stages.size(), 0);
+  m_stage_out.assign(m_stages.size(), 0);
+  if (m_stages.empty() || m_loop >= m_program.size()) {
+    v::error << this->name() << "Closed loop needs stages and a loop entry, replaying open-loop" << v::endl;
+    m_frames_in_flight = 0;
+    return;
+  }
+  v::info << this->name() << "Closed loop with " << m_frames_in_flight << " frames in flight through " << m_stage_names << v::endl;
+}
+
+// Display and grayframer are enabled once, then the camera is kicked every interval
+void AHBFrameTrigger::default_stimulus() {
+  StimulusEntry entry = { sc_core::sc_time(1, SC_MS), 0, 0x00000003, -1 };
+  m_program.clear();
+  entry.addr = 0x80050000; // ahbdisplay
+  m_program.push_back(entry);
+  entry.addr = 0x80050200; // ahbgrayframer
+  m_program.push_back(entry);
+  entry.addr = 0x80050100; // ahbcamera
+  entry.value = 0x01400003;
+  m_program.push_back(entry);
+  entry.delay = m_interval;
+  m_program.push_back(entry);
+  m_loop = 3;
+}
 
-    // Activate "new_frame" event
-    new_frame.notify();
+// Stimulus files hold one write per line:
+//   <delay> <unit> <address> <value> [<signal>]
+// The delay is relative to the previous write, unit is one of s, ms, us,
+// ns, ps. After the write the player waits for the next toggle of the named
+// signal, if one is given. A line containing "loop" marks the entry the
+// program restarts at after its last line; without it the player stops.
+// Everything behind a '#' is a comment.
+bool AHBFrameTrigger::load_stimulus(const std::string &file) {
+  std::ifstream in(file.c_str());
+  if (!in) {
+    v::error << this->name() << "Cannot open stimulus file " << file << v::endl;
+    return false;
   }
+  std::vector<StimulusEntry> program;
+  size_t loop = std::string::npos;
+  std::string line;
+  for (uint32_t lineno = 1; std::getline(in, line); lineno++) {
+    size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+    std::istringstream fields(line);
+    std::string delay, unit, addr, value, signal;
+    if (!(fields >> delay)) {
+      continue;
+    }
+    if (delay == "loop") {
+      loop = program.size();
+      continue;
+    }
+    if (!(fields >> unit >> addr >> value)) {
+      v::error << this->name() << file << ":" << lineno << ": expected <delay> <unit> <address> <value> [<signal>]" << v::endl;
+      return false;
+    }
+    StimulusEntry entry;
+    sc_core::sc_time_unit tu;
+    if (unit == "s") {
+      tu = SC_SEC;
+    } else if (unit == "ms") {
+      tu = SC_MS;
+    } else if (unit == "us") {
+      tu = SC_US;
+    } else if (unit == "ns") {
+      tu = SC_NS;
+    } else if (unit == "ps") {
+      tu = SC_PS;
+    } else {
+      v::error << this->name() << file << ":" << lineno << ": unknown time unit " << unit << v::endl;
+      return false;
+    }
+    entry.delay = sc_core::sc_time(strtod(delay.c_str(), NULL), tu);
+    entry.addr = strtoul(addr.c_str(), NULL, 0);
+    entry.value = strtoul(value.c_str(), NULL, 0);
+    entry.signal = -1;
+    if (fields >> signal) {
+      for (size_t i = 0; i < m_watch_names.size(); i++) {
+        if (m_watch_names[i] == signal) {
+          entry.signal = i;
+        }
+      }
+      if (entry.signal < 0) {
+        v::error << this->name() << file << ":" << lineno << ": unknown signal " << signal << v::endl;
+        return false;
+      }
+    }
+    program.push_back(entry);
+  }
+  m_program.swap(program);
+  m_loop = (loop == std::string::npos) ? m_program.size() : loop;
+  return true;
+}
+
+static double host_seconds() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
 }
 
-// Generates a thread of frame_length
+void AHBFrameTrigger::write_entry(const StimulusEntry &entry) {
+  uint8_t data[4];
+  // Endianess! registers are big endian on the bus
+  data[0] = entry.value >> 24;
+  data[1] = entry.value >> 16;
+  data[2] = entry.value >> 8;
+  data[3] = entry.value;
+  ahbwrite(entry.addr, data, 4);
+}
+
+void AHBFrameTrigger::kick_frame(const StimulusEntry &entry) {
+  FrameDescriptor frame = { entry.addr, 0, 0, 0, FRAME_YUV422, ++m_kicks, sc_time_stamp() };
+  write_entry(entry);
+  frameOut.write(frame);
+}
+
+// Replays the stimulus program
 void AHBFrameTrigger::gen_frame() {
-  // Locals
-  uint32_t data;
-  // uint32_t debug;
-  // sc_core::sc_time delay = SC_ZERO_TIME;
-
-  // Wait for system becoming ready
-  wait(1, SC_MS);
-
-  data = 0x03000000; // Endianess! 
-  ahbwrite(0x80050000,(uint8_t*)&data,4); // ahbdisplay
-  wait(1, SC_MS);
-  data = 0x03000000; // Endianess! 
-  ahbwrite(0x80050200,(uint8_t*)&data,4); // ahbgrayframer
-  wait(1, SC_MS);
-  while (1) {
-    data = 0x03004001; // Endianess! 
-    ahbwrite(0x80050100,(uint8_t*)&data,4); // ahbcamera
-    wait(40, SC_MS);
+  PROFILE_PROCESS();
+  size_t pc = 0;
+  while (pc < m_program.size()) {
+    const StimulusEntry &entry = m_program[pc];
+    if (m_frames_in_flight && pc == m_loop) {
+      run_closed_loop(entry);
+    }
+    if (entry.delay != SC_ZERO_TIME) {
+      ProcessProfiler::wait(entry.delay);
+    }
+    if (pc == m_loop) {
+      kick_frame(entry);
+    } else {
+      write_entry(entry);
+    }
+    if (entry.signal >= 0) {
+      ProcessProfiler::wait(watchIn[entry.signal]->value_changed_event());
+    }
+    if (++pc == m_program.size() && m_loop < m_program.size()) {
+      pc = m_loop;
+    }
+  }
+  v::info << this->name() << "Stimulus program finished" << v::endl;
+}
+
+void AHBFrameTrigger::account_busy() {
+  sc_core::sc_time now = sc_time_stamp();
+  for (size_t k = 0; k < m_stages.size(); k++) {
+    if (m_stage_in[k] > m_stage_out[k]) {
+      m_stage_busy[k] += now - m_last_account;
+    }
+  }
+  m_last_account = now;
+}
+
+// The kick entry is written as soon as a frame slot is free, its delay and
+// signal are ignored. Never returns.
+void AHBFrameTrigger::run_closed_loop(const StimulusEntry &kick) {
+  m_first_kick = m_last_account = sc_time_stamp();
+  m_host_first_kick = host_seconds();
+  while (true) {
+    while (m_stage_in[0] - m_frames_done - m_frames_lost < m_frames_in_flight) {
+      account_busy();
+      m_stage_in[0]++;
+      kick_frame(kick);
+    }
+    uint32_t done = m_frames_done;
+    ProcessProfiler::wait(m_timeout, m_frame_done);
+    if (done == m_frames_done) {
+      uint32_t lost = m_stage_in[0] - m_frames_done - m_frames_lost;
+      v::warn << this->name() << lost << " frames did not complete within " << m_timeout << v::endl;
+      account_busy();
+      m_frames_lost += lost;
+      // drop the lost frames from all stages, late toggles are ignored
+      m_stage_out[0] = m_stage_in[0];
+      for (size_t k = 1; k < m_stages.size(); k++) {
+        m_stage_in[k] = m_stage_out[k];
+      }
+    }
+  }
+}
+
+void AHBFrameTrigger::stage_monitor() {
+  PROFILE_PROCESS();
+  if (m_stages.empty()) {
+    return;
+  }
+  account_busy();
+  for (size_t k = 0; k < m_stages.size(); k++) {
+    // toggles without a frame in the stage do not belong to the closed loop
+    if (!watchIn[m_stages[k]]->event() || m_stage_in[k] == m_stage_out[k]) {
+      continue;
+    }
+    m_stage_out[k]++;
+    if (k + 1 < m_stages.size()) {
+      m_stage_in[k + 1]++;
+    } else {
+      m_frames_done++;
+      m_last_done = sc_time_stamp();
+      m_host_last_done = host_seconds();
+      m_frame_done.notify();
+    }
+  }
+}
+
+void AHBFrameTrigger::end_of_simulation() {
+  if (!m_frames_in_flight || !m_frames_done) {
+    return;
+  }
+  sc_core::sc_time span = m_last_done - m_first_kick;
+  v::info << this->name() << "Closed loop: " << m_frames_done << " frames, " << m_frames_lost << " lost, "
+          << m_frames_in_flight << " in flight" << v::endl;
+  v::info << this->name() << "Sustained frame rate: " << m_frames_done / span.to_seconds() << " fps simulated" << v::endl;
+  for (size_t k = 0; k < m_stages.size(); k++) {
+    v::info << this->name() << "Stage " << m_watch_names[m_stages[k]] << " busy: "
+            << 100.0 * (m_stage_busy[k] / span) << "%" << v::endl;
   }
-  sc_stop();
+  v::info << this->name() << "Host wall time per frame: "
+          << 1000.0 * (m_host_last_done - m_host_first_kick) / m_frames_done << " ms" << v::endl;
 }
 
 // Helper for setting clock cycle latency using a value-time_unit pair
@@ -21,11 +21,15 @@
 
 // Provides methods for generating random data
 #include <math.h>
+#include <string>
+#include <vector>
 
 // AHB TLM master socket and protocol implementation
 #include "core/common/ahbmaster.h"
 // Timing interface (specify clock period)
 #include "core/common/clkdevice.h"
+// Frame stamps for the latency tracking
+#include "models/ahbvideomaster/framedescriptor.h"
 
 // Verbosity kit - for output formatting and filtering
 #include "core/common/verbose.h"
@@ -36,19 +40,47 @@ class AHBFrameTrigger : public AHBMaster<>, public CLKDevice {
     SC_HAS_PROCESS(AHBFrameTrigger);
     SR_HAS_SIGNALS(AHBFrameTrigger);
 
+    /// Frame signals a stimulus entry can wait for, bound through watch()
+    sc_port<sc_signal_in_if<bool>, 0, SC_ZERO_OR_MORE_BOUND> watchIn;
+
+    /// Sequence number and creation time of every frame kicked by the loop
+    /// entry of the stimulus, for the first stage of the pipeline
+    signal<FrameDescriptor>::out frameOut;
+
     /// Constructor
     AHBFrameTrigger(ModuleName name,  // The SystemC name of the component
     unsigned int hindex,                    // The master index for registering with the AHB
     sc_core::sc_time interval,                  // The interval between data frames
     bool pow_mon,                               // Enable power monitoring
-    AbstractionLayer ambaLayer);            // TLM abstraction layer
+    AbstractionLayer ambaLayer,             // TLM abstraction layer
+    std::string stimulus = "");             // Stimulus file, empty replays the built-in program
+
+    /// Make a frame signal available to the stimulus under the given name
+    void watch(const std::string &name, sc_signal_in_if<bool> &signal);
+
+    /// Switch to closed-loop triggering: the first write behind the loop
+    /// marker kicks a new frame whenever fewer than frames_in_flight frames
+    /// are on their way through stages (comma separated watch() names in
+    /// pipeline order, the last one completes a frame). Frames that do not
+    /// complete within timeout are counted as lost.
+    void closed_loop(uint32_t frames_in_flight, const std::string &stages,
+      sc_core::sc_time timeout = sc_core::sc_time(1, SC_SEC));
 
-    /// Thread for triggering gen_frame (generates new_frame event)
-    void frame_trigger();
+    /// Load the stimulus program once all signals are known
+    void end_of_elaboration();
 
-    /// Thread for generating the data frame
+    /// Report throughput and stage utilisation of the closed loop
+    void end_of_simulation();
+
+    /// Frames completed by the last closed-loop stage
+    uint32_t frames() const { return m_frames_done; }
+
+    /// Thread replaying the stimulus program as AHB writes
     void gen_frame();
 
+    /// Method counting the toggles of the watched signals
+    void stage_monitor();
+
     /// Reset function
     void dorst();
 
@@ -61,14 +93,71 @@ class AHBFrameTrigger : public AHBMaster<>, public CLKDevice {
     // data members
     // ------------
 
+    /// One line of the stimulus: wait delay, write value to addr,
+    /// then wait for the next toggle of watchIn[signal] (if >= 0)
+    struct StimulusEntry {
+      sc_core::sc_time delay;
+      uint32_t addr;
+      uint32_t value;
+      int signal;
+    };
+
+    /// Parse a stimulus file into m_program, false on any error
+    bool load_stimulus(const std::string &file);
+
+    /// Program equivalent to the former hard-coded trigger loop
+    void default_stimulus();
+
+    /// Issue one stimulus write in bus byte order
+    void write_entry(const StimulusEntry &entry);
+
+    /// Write the loop entry and stamp the frame it starts
+    void kick_frame(const StimulusEntry &entry);
+
+    /// Add the time since the last call to every stage holding a frame
+    void account_busy();
+
+    /// Kick frames until frames_in_flight are on their way
+    void run_closed_loop(const StimulusEntry &kick);
+
     /// Time interval for creating data frame
     const sc_core::sc_time m_interval;
 
     /// ID of the AHB master
     const uint32_t m_master_id;
 
-    /// Event for activating the gen_frame Thread
-    sc_event new_frame;
+    /// Stimulus file name
+    std::string m_stimulus;
+
+    /// Names of the signals bound to watchIn, in binding order
+    std::vector<std::string> m_watch_names;
+
+    /// The stimulus program and the entry the program restarts at after its end
+    std::vector<StimulusEntry> m_program;
+    size_t m_loop;
+
+    /// Frames kicked so far
+    uint32_t m_kicks;
+
+    /// Closed-loop configuration, m_frames_in_flight == 0 replays the program open-loop
+    uint32_t m_frames_in_flight;
+    std::string m_stage_names;
+    sc_core::sc_time m_timeout;
+
+    /// watchIn index per stage and frames entered and left per stage
+    std::vector<int> m_stages;
+    std::vector<uint32_t> m_stage_in;
+    std::vector<uint32_t> m_stage_out;
+    std::vector<sc_core::sc_time> m_stage_busy;
+    sc_core::sc_time m_last_account;
+
+    uint32_t m_frames_done;
+    uint32_t m_frames_lost;
+    sc_core::sc_time m_first_kick;
+    sc_core::sc_time m_last_done;
+    double m_host_first_kick;
+    double m_host_last_done;
+    sc_event m_frame_done;
 
     /// Power monitoring enabled/disable
     bool m_pow_mon;
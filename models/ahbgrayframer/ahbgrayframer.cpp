@@ -12,6 +12,7 @@
 /// @author Bastian Farkas
 ///
 #include "models/ahbgrayframer/ahbgrayframer.h"
+#include "models/processprofiler/processprofiler.h"
 #include "core/common/verbose.h"
 
 AHBGrayframer::AHBGrayframer(sc_module_name name,
@@ -27,8 +28,9 @@ AHBGrayframer::AHBGrayframer(sc_module_name name,
   uint32_t video_width,
   uint32_t frame_width,
   uint32_t frame_height,
-  AbstractionLayer ambaLayer) :
-  AHBMaster<APBSlave>(
+  AbstractionLayer ambaLayer,
+  uint32_t stripe_rows) :
+  AHBVideoMaster<APBSlave>(
     name,
     hindex,
     0x03,
@@ -37,15 +39,27 @@ AHBGrayframer::AHBGrayframer(sc_module_name name,
     0,
     ambaLayer,
     BAR(), BAR(), BAR(), BAR()),
+  frameOut("frameOut"),
+  frameIn(&AHBGrayframer::frame_in, "frameIn"),
+  stampIn(&AHBGrayframer::stamp_in, "stampIn"),
   m_videoaddr(0xA0000000),
   m_video_width(video_width),
   m_frame_width(frame_width), m_frame_height(frame_height),
   m_in_x(in_x), m_in_y(in_y),
   m_out_x(out_x), m_out_y(out_y),
   m_factor(2), 
-  m_buffer(NULL), m_frameToggle(true),
+  m_stripe_rows(stripe_rows), m_rows_done(0),
+  m_stamped(false),
+  m_sequence(0),
+  m_buffer(NULL),
+  m_lut_channel(0), m_lut_index(0),
+  m_frameToggle(true),
   m_channel(channel),
   m_grayframer_initialised(false) {
+  for (uint32_t i = 0; i < 256; i++) {
+    m_lut[0][i] = m_lut[1][i] = m_lut[2][i] = i;
+  }
+  memset(m_lut_histogram, 0, sizeof(m_lut_histogram));
   init_apb(pindex, 0x03, 0x005, 0, 0, APBIO, pmask, 0, 0, paddr);
 
   init_registers();
@@ -78,6 +92,21 @@ void AHBGrayframer::init_registers() {
     0x10,     // offset
     (m_frame_width << 16) | m_frame_height,
     0xFFFFFFFF);
+  r.create_register("LUT_CTRL", "Grayframer Lookup Table Control Register",
+    0x14,     // offset
+    0x00,
+    0x03);
+  r.create_register("LUT_INDEX", "Grayframer Lookup Table Index Register",
+    0x18,     // offset
+    0x00,
+    0x3FF)
+  .callback(SR_POST_WRITE, this, &AHBGrayframer::lut_index_write);
+  r.create_register("LUT_DATA", "Grayframer Lookup Table Data Register",
+    0x1C,     // offset
+    0x00,
+    0xFFFFFFFF)
+  .callback(SR_PRE_READ, this, &AHBGrayframer::lut_data_read)
+  .callback(SR_POST_WRITE, this, &AHBGrayframer::lut_data_write);
 }
 
 AHBGrayframer::~AHBGrayframer() {
@@ -87,6 +116,12 @@ AHBGrayframer::~AHBGrayframer() {
 void AHBGrayframer::end_of_elaboration() {
 }
 
+void AHBGrayframer::end_of_simulation() {
+  if (m_inbox.linked()) {
+    m_inbox.report(name());
+  }
+}
+
 void AHBGrayframer::ctrl_read() {
   uint32_t reg = 0;
   reg |= (m_buffer) ? 1 : 0 << 0;
@@ -108,6 +143,62 @@ void AHBGrayframer::ctrl_write() {
   }
 }
 
+void AHBGrayframer::lut_index_write() {
+  m_lut_channel = ((r[0x18] >> 8) & 0x3) % 3;
+  m_lut_index = r[0x18] & 0xFC;
+}
+
+// LUT_DATA transfers four consecutive entries, the first one in the MSB.
+void AHBGrayframer::lut_data_read() {
+  uint8_t *lut = m_lut[m_lut_channel];
+  r[0x1C] = (lut[m_lut_index] << 24) | (lut[m_lut_index + 1] << 16) |
+            (lut[m_lut_index + 2] << 8) | lut[m_lut_index + 3];
+  m_lut_index = (m_lut_index + 4) & 0xFF;
+}
+
+void AHBGrayframer::lut_data_write() {
+  uint8_t *lut = m_lut[m_lut_channel];
+  uint32_t data = r[0x1C];
+  lut[m_lut_index + 0] = data >> 24;
+  lut[m_lut_index + 1] = data >> 16;
+  lut[m_lut_index + 2] = data >> 8;
+  lut[m_lut_index + 3] = data;
+  m_lut_index = (m_lut_index + 4) & 0xFF;
+}
+
+void AHBGrayframer::apply_lut(uint8_t *row, uint32_t length) {
+  const uint8_t *ylut = m_lut[0];
+  const uint8_t *ulut = m_lut[1];
+  const uint8_t *vlut = m_lut[2];
+  for (uint32_t x = 0; x < length; x += 4) {
+    m_lut_histogram[row[x+1]]++;
+    m_lut_histogram[row[x+3]]++;
+    row[x+0] = ulut[row[x+0]];
+    row[x+1] = ylut[row[x+1]];
+    row[x+2] = vlut[row[x+2]];
+    row[x+3] = ylut[row[x+3]];
+  }
+}
+
+void AHBGrayframer::equalize_lut() {
+  uint32_t total = 0, cdf_min = 0;
+  for (uint32_t i = 0; i < 256; i++) {
+    total += m_lut_histogram[i];
+    if (!cdf_min) {
+      cdf_min = m_lut_histogram[i];
+    }
+  }
+  if (total > cdf_min) {
+    uint32_t cdf = 0;
+    for (uint32_t i = 0; i < 256; i++) {
+      cdf += m_lut_histogram[i];
+      m_lut[0][i] = (cdf < cdf_min) ? 0 :
+        static_cast<uint8_t>((static_cast<uint64_t>(cdf - cdf_min) * 255 + (total - cdf_min) / 2) / (total - cdf_min));
+    }
+  }
+  memset(m_lut_histogram, 0, sizeof(m_lut_histogram));
+}
+
 void AHBGrayframer::init_grayframer() {
   m_videoaddr = r[0x4];
   //m_video_width = ((r[0x10] >> 16) & 0xFFFF)/2; //320 //TODO: need new register vor video size!!!
@@ -118,7 +209,7 @@ void AHBGrayframer::init_grayframer() {
   m_out_x = (r[0xC] >> 16) & 0xFFFF; //320
   m_out_y = (r[0xC] >>  0) & 0xFFFF; //0
   m_factor = m_frame_width / m_video_width;
-  m_buffer = new uint8_t[m_video_width * 2];
+  m_buffer = new uint8_t[m_video_width * 2 * (m_frame_height / m_factor)];
   m_grayframer_initialised = true;
 
   v::info << name() << "CTRL    r[0x00]: " << v::uint32 << (uint32_t)r[0x0] << v::endl;
@@ -128,55 +219,157 @@ void AHBGrayframer::init_grayframer() {
   v::info << name() << "SIZE    r[0x10]: " << v::uint32 << (uint32_t)r[0x10] << v::endl;
 }
 
+// Every upstream frame takes the oldest stamp, also while the thread is
+// busy and the trigger coalesces, so a skipped frame drops its stamp.
 void AHBGrayframer::frameTrigger(){
+  PROFILE_PROCESS();
+  if (!m_stamps.empty()) {
+    m_stamp = m_stamps.front();
+    m_stamps.pop_front();
+    m_stamped = true;
+  }
+  if (!m_inbox.linked()) {
+    frameTriggerEvent.notify();
+  }
+}
+
+void AHBGrayframer::frame_in(const FrameDescriptor &frame, const sc_time &delay) {
+  m_inbox.put(frame);
   frameTriggerEvent.notify();
 }
 
+void AHBGrayframer::stamp_in(const FrameDescriptor &frame, const sc_time &delay) {
+  m_stamps.push_back(frame);
+  // frames that never arrive must not hold back the stamps of later ones
+  if (m_stamps.size() > 16) {
+    m_stamps.pop_front();
+  }
+}
+
+void AHBGrayframer::wait_rows(uint32_t rows) {
+  // the counters run over all frames, the difference is wrap safe
+  while (rowsIn->read() - m_rows_done < rows) {
+    ProcessProfiler::wait(rowsIn->value_changed_event());
+  }
+}
+
 // this thread reads a row every 18 us so it take 13.824 ms to read a whole picture
 // together with the porches and blanking its 14.508 ms which equals about 69 Hz frame rate
 // (which is in fact what we have in reality...)
+//
+// With a stripe size the frame is processed and handed on stripe by stripe, so
+// a downstream stage bound to rowsOut works on rows 0..k while this one is
+// still on the next stripe. Chained stages need the same number of rows.
 void AHBGrayframer::paint_it_gray() {
+  PROFILE_PROCESS();
   m_frameToggle = false;
   uint32_t i,x;
   while (true) {
-    wait(frameTriggerEvent);
-    
-    for (i = 0; i < m_frame_height/m_factor; i++) {
-          ahbread(m_videoaddr + m_in_x * 2+ m_in_y * m_video_width * 2 * m_factor + i * m_video_width * 2 * m_factor,
-            m_buffer,
-            m_video_width*2);
+    if (rowsIn.size()) {
+      // the frame starts with the first stripe upstream, frames finished
+      // before the initialisation are skipped below
+      while (!m_grayframer_initialised || rowsIn->read() == m_rows_done) {
+        ProcessProfiler::wait(rowsIn->value_changed_event());
+      }
+    } else {
+      ProcessProfiler::wait(frameTriggerEvent);
+      if (!m_grayframer_initialised) {
+        // no buffer until software enables the stage
+        continue;
+      }
+    }
+
+    uint32_t rows = m_frame_height/m_factor;
+    uint32_t stride = m_video_width * 2 * m_factor;
+    uint32_t stripe = m_stripe_rows ? m_stripe_rows : rows;
+    // a descriptor from upstream names the input buffer and the frame
+    uint32_t inaddr = m_videoaddr + m_in_x * 2 + m_in_y * stride;
+    uint32_t instride = stride;
+    FrameDescriptor frame;
+    bool forwarded = !rowsIn.size() && m_inbox.take(frame);
+    if (forwarded) {
+      inaddr = frame.addr;
+      instride = frame.stride;
+    } else if (m_stamped) {
+      frame = m_stamp;
+      m_stamped = false;
+    } else {
+      frame.sequence = ++m_sequence;
+      frame.timestamp = sc_time_stamp();
+    }
+    if (rowsIn.size() && rowsIn->read() - m_rows_done > rows) {
+      // fell behind, continue with the frame upstream is working on
+      m_rows_done += (rowsIn->read() - m_rows_done - 1) / rows * rows;
+    }
+
+    for (uint32_t first = 0; first < rows; first += stripe) {
+      uint32_t count = std::min(stripe, rows - first);
+      if (rowsIn.size()) {
+        wait_rows(first + count);
+      }
+      uint8_t *buffer = m_buffer + first * m_video_width * 2;
+      ahbread2d(inaddr + first * instride,
+        buffer,
+        m_video_width*2, count, instride);
+
+      for (i = 0; i < count; i++) {
+          uint8_t *row = buffer + i * m_video_width * 2;
+          if (r[0x14] & 0x3) {
+            apply_lut(row, m_video_width*2);
+          }
 
           switch(m_channel){
             case 'Y':
               for (x = 0; x < m_video_width*2; x+=4) {
-                m_buffer[x+0] = 128;
-                m_buffer[x+2] = 128;
+                row[x+0] = 128;
+                row[x+2] = 128;
               }
               break;
             case 'U':
               for (x = 0; x < m_video_width*2; x+=4) {
-                m_buffer[x+1] = 128;
-                m_buffer[x+2] = 128;
-                m_buffer[x+3] = 128;
+                row[x+1] = 128;
+                row[x+2] = 128;
+                row[x+3] = 128;
               }
               break;
             case 'V':
               for (x = 0; x < m_video_width*2; x+=4) {
-                m_buffer[x+0] = 128;
-                m_buffer[x+1] = 128;
-                m_buffer[x+3] = 128;
+                row[x+0] = 128;
+                row[x+1] = 128;
+                row[x+3] = 128;
               }
               break;
             default:
               break;
           } 
+      }
 
-          ahbwrite(m_videoaddr + m_out_x * 2 + m_out_y * m_video_width * 2 * m_factor + i * m_video_width * 2 * m_factor,
-            m_buffer,
-            m_video_width*2);
-          //wait(20 * clock_cycle);
+      ahbwrite2d(m_videoaddr + m_out_x * 2 + (m_out_y + first) * stride,
+        buffer,
+        m_video_width*2, count, stride);
+      if (rowsOut.size()) {
+        // the rows must be in memory at the time downstream sees the count
+        ahbsync();
+        rowsOut->write(m_rows_done + first + count);
+      }
     }
+    m_rows_done += rows;
     // wait(400*clock_cycle); //wait front porch, back porch and blanking time
+    if (r[0x14] & 0x2) {
+      equalize_lut();
+    } else if (r[0x14] & 0x1) {
+      memset(m_lut_histogram, 0, sizeof(m_lut_histogram));
+    }
+    ahbsync();
+    frame.addr = m_videoaddr + m_out_x * 2 + m_out_y * stride;
+    frame.width = m_video_width;
+    frame.height = rows;
+    frame.stride = stride;
+    frame.format = FRAME_YUV422;
+    if (forwarded) {
+      m_inbox.done(frame);
+    }
+    frameOut.write(frame);
     m_frameToggle = !m_frameToggle;
     triggerOut.write(m_frameToggle);
   }
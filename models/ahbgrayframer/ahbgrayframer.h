@@ -15,17 +15,19 @@
 #define MODELS_AHBGRAYFRAMER_AHBGRAYFRAMER_H_
 
 #include <amba.h>
+#include <deque>
 //#include <greenreg_ambasockets.h>
 
 #include "core/common/base.h"
-#include "core/common/ahbmaster.h"
+#include "models/ahbvideomaster/ahbvideomaster.h"
+#include "models/ahbvideomaster/framedescriptor.h"
 #include "core/common/apbdevice.h"
 #include "core/common/apbslave.h"
 #include "core/common/clkdevice.h"
 
 #include "core/common/sr_signal.h"
 
-class AHBGrayframer : public AHBMaster<APBSlave>, public CLKDevice {
+class AHBGrayframer : public AHBVideoMaster<APBSlave>, public CLKDevice {
   public:
     SC_HAS_PROCESS(AHBGrayframer);
     SR_HAS_SIGNALS(AHBGrayframer);
@@ -34,6 +36,23 @@ class AHBGrayframer : public AHBMaster<APBSlave>, public CLKDevice {
     sc_in<bool> triggerIn;
     sc_out<bool> triggerOut;
 
+    /// Descriptor of every finished frame
+    signal<FrameDescriptor>::out frameOut;
+
+    /// Descriptors of the upstream stage, replace triggerIn once connected
+    signal<FrameDescriptor>::in frameIn;
+
+    /// Stamps of the frames entering the pipeline (see AHBFrameTrigger),
+    /// taken in order by the frames on triggerIn of a first stage
+    signal<FrameDescriptor>::in stampIn;
+
+    /// Rows written so far, counted over all frames
+    sc_port<sc_signal_inout_if<uint32_t>, 1, SC_ZERO_OR_MORE_BOUND> rowsOut;
+
+    /// Rows written by the upstream stage. When bound, a frame starts as
+    /// soon as its first stripe is available instead of on triggerIn.
+    sc_port<sc_signal_in_if<uint32_t>, 1, SC_ZERO_OR_MORE_BOUND> rowsIn;
+
     AHBGrayframer(sc_module_name name,
     uint32_t hindex,
     uint32_t pindex,
@@ -47,13 +66,15 @@ class AHBGrayframer : public AHBMaster<APBSlave>, public CLKDevice {
     uint32_t video_width,
     uint32_t frame_width,
     uint32_t frame_height,
-    AbstractionLayer ambaLayer = amba::amba_LT);
+    AbstractionLayer ambaLayer = amba::amba_LT,
+    uint32_t stripe_rows = 0);
 
     /// Destructor
     ~AHBGrayframer();
 
     void init_registers();
     void end_of_elaboration();
+    void end_of_simulation();
 
     sc_event frameDone;
     sc_event frameTriggerEvent;
@@ -66,10 +87,26 @@ class AHBGrayframer : public AHBMaster<APBSlave>, public CLKDevice {
     void init_grayframer();
     void paint_it_gray();
     void frameTrigger();
+    void frame_in(const FrameDescriptor &frame, const sc_time &delay);
+    void stamp_in(const FrameDescriptor &frame, const sc_time &delay);
+
+    /// Wait until the upstream stage has written rows (counted over all frames)
+    void wait_rows(uint32_t rows);
 
     void ctrl_read();
     void ctrl_write();
 
+    void lut_index_write();
+    void lut_data_read();
+    void lut_data_write();
+
+    /// Map a buffered row through the lookup tables, counting the luma
+    /// histogram for the automatic equalization on the way.
+    void apply_lut(uint8_t *row, uint32_t length);
+
+    /// Derive the luma table from the histogram of the finished frame.
+    void equalize_lut();
+
     uint32_t m_videoaddr;
     uint32_t m_video_width;
     uint32_t m_frame_width;
@@ -79,8 +116,25 @@ class AHBGrayframer : public AHBMaster<APBSlave>, public CLKDevice {
     uint32_t m_out_x;
     uint32_t m_out_y;
     uint32_t m_factor;
+    /// Rows handed downstream at once, 0 hands over whole frames
+    uint32_t m_stripe_rows;
+    uint32_t m_rows_done;
+
+    FrameInbox m_inbox;
+    std::deque<FrameDescriptor> m_stamps;
+    /// Stamp of the last frame on triggerIn, used by the next frame started
+    FrameDescriptor m_stamp;
+    bool m_stamped;
+    /// Frames started by this stage as the first one of a pipeline
+    uint32_t m_sequence;
 
     uint8_t *m_buffer;
+
+    /// Per channel lookup tables (Y, U, V), identity after reset
+    uint8_t m_lut[3][256];
+    uint32_t m_lut_channel;
+    uint32_t m_lut_index;
+    uint32_t m_lut_histogram[256];
     bool m_frameToggle;
     char m_channel;
     bool m_grayframer_initialised;
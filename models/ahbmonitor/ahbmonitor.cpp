@@ -0,0 +1,206 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbmonitor
+/// @{
+/// @file ahbmonitor.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/ahbmonitor/ahbmonitor.h"
+#include "core/common/verbose.h"
+#include <iomanip>
+#include <sstream>
+
+AHBMonitorStats::AHBMonitorStats() :
+  reads(0), writes(0),
+  read_bytes(0), write_bytes(0),
+  busy(sc_core::SC_ZERO_TIME),
+  wait(sc_core::SC_ZERO_TIME) {
+  memset(bursts, 0, sizeof(bursts));
+}
+
+AHBTap::AHBTap(ModuleName name,
+  AHBMonitor *monitor,
+  uint32_t hindex,
+  uint8_t vendor,
+  uint16_t device,
+  AbstractionLayer ambaLayer) :
+  AHBDevice<sc_core::sc_module>(
+    name,
+    hindex,
+    vendor,
+    device,
+    0,
+    0,
+    BAR(), BAR(), BAR(), BAR()),
+  ahb_in("ahb_in", amba::amba_AHB, ambaLayer, false),
+  ahb_out("ahb_out", amba::amba_AHB, ambaLayer, false),
+  m_monitor(monitor),
+  m_hindex(hindex) {
+  ahb_in.register_b_transport(this, &AHBTap::b_transport);
+  ahb_in.register_nb_transport_fw(this, &AHBTap::nb_transport_fw);
+  ahb_in.register_transport_dbg(this, &AHBTap::transport_dbg);
+  ahb_in.register_get_direct_mem_ptr(this, &AHBTap::get_direct_mem_ptr);
+  ahb_out.register_nb_transport_bw(this, &AHBTap::nb_transport_bw);
+  ahb_out.register_invalidate_direct_mem_ptr(this, &AHBTap::invalidate_direct_mem_ptr);
+}
+
+void AHBTap::b_transport(tlm::tlm_generic_payload &trans, sc_core::sc_time &delay) {
+  sc_core::sc_time start = sc_core::sc_time_stamp() + delay;
+  sc_core::sc_time before = delay;
+  ahb_out->b_transport(trans, delay);
+  // a master with DMI would bypass the tap from then on
+  trans.set_dmi_allowed(false);
+  m_monitor->transaction(m_hindex, trans, start, delay - before);
+}
+
+tlm::tlm_sync_enum AHBTap::nb_transport_fw(tlm::tlm_generic_payload &trans, tlm::tlm_phase &phase, sc_core::sc_time &delay) {
+  if (phase == tlm::BEGIN_REQ) {
+    m_begin[&trans] = sc_core::sc_time_stamp() + delay;
+  }
+  tlm::tlm_sync_enum status = ahb_out->nb_transport_fw(trans, phase, delay);
+  phase_seen(trans, phase, status, delay);
+  return status;
+}
+
+tlm::tlm_sync_enum AHBTap::nb_transport_bw(tlm::tlm_generic_payload &trans, tlm::tlm_phase &phase, sc_core::sc_time &delay) {
+  phase_seen(trans, phase, tlm::TLM_ACCEPTED, delay);
+  return ahb_in->nb_transport_bw(trans, phase, delay);
+}
+
+// END_REQ is the grant, the first response phase completes the transaction.
+void AHBTap::phase_seen(tlm::tlm_generic_payload &trans, const tlm::tlm_phase &phase,
+    tlm::tlm_sync_enum status, const sc_core::sc_time &delay) {
+  std::map<tlm::tlm_generic_payload *, sc_core::sc_time>::iterator it = m_begin.find(&trans);
+  if (it == m_begin.end()) {
+    return;
+  }
+  sc_core::sc_time now = sc_core::sc_time_stamp() + delay;
+  if (phase == tlm::END_REQ) {
+    m_monitor->grant(m_hindex, now - it->second);
+  } else if (phase == tlm::BEGIN_RESP || phase == tlm::END_RESP || status == tlm::TLM_COMPLETED) {
+    trans.set_dmi_allowed(false);
+    m_monitor->transaction(m_hindex, trans, it->second, now - it->second);
+    m_begin.erase(it);
+  }
+}
+
+unsigned int AHBTap::transport_dbg(tlm::tlm_generic_payload &trans) {
+  return ahb_out->transport_dbg(trans);
+}
+
+// Accesses through a DMI pointer would never reach the tap, so masters
+// are refused DMI while they are monitored.
+bool AHBTap::get_direct_mem_ptr(tlm::tlm_generic_payload &trans, tlm::tlm_dmi &dmi) {
+  return false;
+}
+
+void AHBTap::invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end) {
+  ahb_in->invalidate_direct_mem_ptr(start, end);
+}
+
+AHBMonitor::AHBMonitor(ModuleName name,
+  sc_core::sc_time period,
+  AbstractionLayer ambaLayer) :
+  sc_core::sc_module(name),
+  m_period(period),
+  m_ambaLayer(ambaLayer),
+  m_tracer(NULL) {
+  SC_THREAD(periodic_report);
+}
+
+AHBMonitor::~AHBMonitor() {
+  delete m_tracer;
+  for (size_t i = 0; i < m_taps.size(); i++) {
+    delete m_taps[i];
+  }
+}
+
+void AHBMonitor::trace(const std::string &file) {
+  delete m_tracer;
+  m_tracer = new AHBTracer(file);
+  if (!m_tracer->is_open()) {
+    delete m_tracer;
+    m_tracer = NULL;
+  }
+}
+
+void AHBMonitor::grant(uint32_t hindex, const sc_core::sc_time &wait) {
+  m_stats[hindex].wait += wait;
+}
+
+void AHBMonitor::transaction(uint32_t hindex, const tlm::tlm_generic_payload &trans,
+    const sc_core::sc_time &start, const sc_core::sc_time &latency) {
+  AHBMonitorStats &stats = m_stats[hindex];
+  uint32_t length = trans.get_data_length();
+  if (trans.is_write()) {
+    stats.writes++;
+    stats.write_bytes += length;
+  } else {
+    stats.reads++;
+    stats.read_bytes += length;
+  }
+  uint32_t burst = 0;
+  while (burst < AHBMONITOR_BURST_CLASSES - 1 && (2u << burst) <= length) {
+    burst++;
+  }
+  stats.bursts[burst]++;
+  stats.busy += latency;
+  if (m_tracer) {
+    m_tracer->record(start.to_seconds() * 1e12 + 0.5, hindex, trans.is_write(),
+      trans.get_address(), length, latency.to_seconds() * 1e12 + 0.5);
+  }
+}
+
+void AHBMonitor::report() {
+  double elapsed = sc_core::sc_time_stamp().to_seconds();
+  v::info << name() << "AHB statistics at " << sc_core::sc_time_stamp() << v::endl;
+  v::info << name() << "hindex master               reads   writes  read MB/s  write MB/s  avg lat ns  wait ns   share" << v::endl;
+  for (std::map<uint32_t, AHBMonitorStats>::iterator it = m_stats.begin(); it != m_stats.end(); ++it) {
+    const AHBMonitorStats &s = it->second;
+    uint64_t count = s.reads + s.writes;
+    std::ostringstream line;
+    line << std::setw(6) << it->first << " " << std::left << std::setw(20) << s.name << std::right
+         << std::setw(8) << s.reads << std::setw(9) << s.writes << std::fixed << std::setprecision(2)
+         << std::setw(11) << (elapsed > 0.0 ? s.read_bytes / elapsed / 1e6 : 0.0)
+         << std::setw(12) << (elapsed > 0.0 ? s.write_bytes / elapsed / 1e6 : 0.0)
+         << std::setw(12) << (count ? s.busy.to_seconds() * 1e9 / count : 0.0)
+         << std::setw(9) << s.wait.to_seconds() * 1e9
+         << std::setw(7) << (elapsed > 0.0 ? 100.0 * s.busy.to_seconds() / elapsed : 0.0) << "%";
+    v::info << name() << line.str() << v::endl;
+
+    std::ostringstream bursts;
+    bursts << "       bursts";
+    for (uint32_t b = 0; b < AHBMONITOR_BURST_CLASSES; b++) {
+      if (s.bursts[b]) {
+        bursts << " " << (1u << b) << (b == AHBMONITOR_BURST_CLASSES - 1 ? "+" : "") << ":" << s.bursts[b];
+      }
+    }
+    v::info << name() << bursts.str() << v::endl;
+  }
+}
+
+void AHBMonitor::periodic_report() {
+  if (m_period == sc_core::SC_ZERO_TIME) {
+    return;
+  }
+  while (true) {
+    wait(m_period);
+    report();
+  }
+}
+
+void AHBMonitor::end_of_simulation() {
+  report();
+  if (m_tracer) {
+    m_tracer->close();
+    v::info << name() << "Traced " << m_tracer->records() << " transactions" << v::endl;
+  }
+}
+
+/// @}
@@ -0,0 +1,147 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbmonitor
+/// @{
+/// @file ahbmonitor.h
+/// Per master AHB bandwidth and latency accounting.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBMONITOR_AHBMONITOR_H_
+#define MODELS_AHBMONITOR_AHBMONITOR_H_
+
+#include <amba.h>
+#include <tlm.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "core/common/base.h"
+#include "core/common/ahbdevice.h"
+#include "models/ahbmonitor/ahbtracer.h"
+
+/// Number of burst size classes: 1, 2, 4, ... 512 and >= 1024 bytes
+#define AHBMONITOR_BURST_CLASSES 11
+
+/// Counters of one AHB master
+struct AHBMonitorStats {
+  AHBMonitorStats();
+
+  std::string name;
+  uint64_t reads;
+  uint64_t writes;
+  uint64_t read_bytes;
+  uint64_t write_bytes;
+  uint64_t bursts[AHBMONITOR_BURST_CLASSES];
+  /// Sum of the transaction latencies, the time the master held the bus
+  sc_core::sc_time busy;
+  /// Sum of the times between request and grant (AT only)
+  sc_core::sc_time wait;
+};
+
+class AHBMonitor;
+
+/// Interposer between one master and the AHBCtrl. It registers with the
+/// controller under the identity of the master it replaces, forwards all
+/// transport calls and reports every transaction to the monitor. DMI is
+/// refused, accesses through a DMI pointer would pass the tap unseen.
+class AHBTap : public AHBDevice<sc_core::sc_module> {
+  public:
+    amba::amba_slave_socket<32> ahb_in;
+    amba::amba_master_socket<32> ahb_out;
+
+    AHBTap(ModuleName name,
+      AHBMonitor *monitor,
+      uint32_t hindex,
+      uint8_t vendor,
+      uint16_t device,
+      AbstractionLayer ambaLayer);
+
+  private:
+    void b_transport(tlm::tlm_generic_payload &trans, sc_core::sc_time &delay);
+    tlm::tlm_sync_enum nb_transport_fw(tlm::tlm_generic_payload &trans, tlm::tlm_phase &phase, sc_core::sc_time &delay);
+    tlm::tlm_sync_enum nb_transport_bw(tlm::tlm_generic_payload &trans, tlm::tlm_phase &phase, sc_core::sc_time &delay);
+    unsigned int transport_dbg(tlm::tlm_generic_payload &trans);
+    bool get_direct_mem_ptr(tlm::tlm_generic_payload &trans, tlm::tlm_dmi &dmi);
+    void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end);
+
+    /// Follow the phases of a non-blocking transaction
+    void phase_seen(tlm::tlm_generic_payload &trans, const tlm::tlm_phase &phase,
+      tlm::tlm_sync_enum status, const sc_core::sc_time &delay);
+
+    AHBMonitor *m_monitor;
+    uint32_t m_hindex;
+
+    /// Start time of the outstanding AT transactions
+    std::map<tlm::tlm_generic_payload *, sc_core::sc_time> m_begin;
+};
+
+/// Collects the AHBTap reports per master index and prints them every
+/// period and at the end of simulation.
+class AHBMonitor : public sc_core::sc_module {
+  public:
+    SC_HAS_PROCESS(AHBMonitor);
+
+    /// A period of SC_ZERO_TIME reports at the end of simulation only.
+    AHBMonitor(ModuleName name,
+      sc_core::sc_time period,
+      AbstractionLayer ambaLayer);
+
+    ~AHBMonitor();
+
+    /// Bind the master socket to the bus through a new tap.
+    template<class SOCKET, class BUS>
+    void attach(SOCKET &socket, BUS &bus, const std::string &master,
+        uint32_t hindex, uint8_t vendor, uint16_t device) {
+      AHBTap *tap = new AHBTap(("tap_" + master).c_str(), this, hindex, vendor, device, m_ambaLayer);
+      m_taps.push_back(tap);
+      m_stats[hindex].name = master;
+      socket(tap->ahb_in);
+      tap->ahb_out(bus);
+    }
+
+    /// Bind an AHBMaster to the bus, through a tap if a monitor exists.
+    template<class MASTER, class BUS>
+    static void connect(AHBMonitor *monitor, MASTER &master, BUS &bus) {
+      if (monitor) {
+        monitor->attach(master.ahb, bus, master.name(),
+          master.get_busid(), master.get_vendor_id(), master.get_device_id());
+      } else {
+        master.ahb(bus);
+      }
+    }
+
+    /// Additionally write every transaction to a binary trace file
+    void trace(const std::string &file);
+
+    /// Called by the taps for the grant (END_REQ) of an AT request
+    void grant(uint32_t hindex, const sc_core::sc_time &wait);
+
+    /// Called by the taps once for every completed transaction
+    void transaction(uint32_t hindex, const tlm::tlm_generic_payload &trans,
+      const sc_core::sc_time &start, const sc_core::sc_time &latency);
+
+    /// Counters of a master index
+    const AHBMonitorStats &stats(uint32_t hindex) { return m_stats[hindex]; }
+
+    /// Print the statistics of all masters
+    void report();
+
+    void end_of_simulation();
+
+  private:
+    void periodic_report();
+
+    sc_core::sc_time m_period;
+    AbstractionLayer m_ambaLayer;
+    std::map<uint32_t, AHBMonitorStats> m_stats;
+    std::vector<AHBTap *> m_taps;
+    AHBTracer *m_tracer;
+};
+
+#endif  // MODELS_AHBMONITOR_AHBMONITOR_H_
+/// @}
@@ -0,0 +1,222 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbmonitor
+/// @{
+/// @file ahbtrace.cpp
+/// Offline analyzer for AHBTracer files.
+///
+/// Prints per master totals and a report of non-sequential accesses, and
+/// optionally writes a bandwidth timeline (CSV) and an access heatmap of
+/// the video region (PGM).
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "models/ahbmonitor/ahbtrace.h"
+
+#define AHBTRACE_MASTERS 16
+
+struct MasterPattern {
+  MasterPattern() : count(0), bytes(0), sequential(0), next(0), valid(false) {}
+  uint64_t count;
+  uint64_t bytes;
+  uint64_t sequential;
+  uint32_t next;    ///< address following the previous transfer
+  bool valid;
+  std::map<int64_t, uint64_t> gaps;
+};
+
+static bool by_count(const std::pair<int64_t, uint64_t> &a, const std::pair<int64_t, uint64_t> &b) {
+  return a.second > b.second;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+    "usage: %s [options] trace\n"
+    "  -t file   write the bandwidth timeline as CSV\n"
+    "  -b us     timeline bin width in microseconds (1000)\n"
+    "  -m file   write a heatmap of the video region as PGM\n"
+    "  -a addr   video region base address (0xA0000000)\n"
+    "  -s bytes  video line stride (1920)\n"
+    "  -l lines  video lines (720)\n"
+    "  -c bytes  heatmap cell width (16)\n"
+    "  -n count  gaps listed per master (5)\n", prog);
+}
+
+int main(int argc, char **argv) {
+  const char *timeline_file = NULL, *heatmap_file = NULL;
+  uint64_t bin_ps = 1000000000ull;
+  uint32_t base = 0xA0000000, stride = 1920, lines = 720, cell = 16, top = 5;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:b:m:a:s:l:c:n:h")) != -1) {
+    switch (opt) {
+      case 't': timeline_file = optarg; break;
+      case 'b': bin_ps = strtoull(optarg, NULL, 0) * 1000000ull; break;
+      case 'm': heatmap_file = optarg; break;
+      case 'a': base = strtoul(optarg, NULL, 0); break;
+      case 's': stride = strtoul(optarg, NULL, 0); break;
+      case 'l': lines = strtoul(optarg, NULL, 0); break;
+      case 'c': cell = strtoul(optarg, NULL, 0); break;
+      case 'n': top = strtoul(optarg, NULL, 0); break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  if (optind != argc - 1 || !bin_ps || !stride || !lines || !cell) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  FILE *in = fopen(argv[optind], "rb");
+  if (!in) {
+    perror(argv[optind]);
+    return 1;
+  }
+  AHBTraceHeader header;
+  if (fread(&header, sizeof(header), 1, in) != 1 ||
+      memcmp(header.magic, AHBTRACE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != AHBTRACE_VERSION || header.record_size != sizeof(AHBTraceRecord)) {
+    fprintf(stderr, "%s: not an AHB trace of version %d\n", argv[optind], AHBTRACE_VERSION);
+    fclose(in);
+    return 1;
+  }
+
+  // timeline[bin][master * 2 + write] in bytes
+  std::vector<std::vector<uint64_t> > timeline;
+  uint32_t columns = (stride + cell - 1) / cell;
+  std::vector<uint64_t> heatmap(heatmap_file ? static_cast<size_t>(columns) * lines : 0);
+  uint64_t region = static_cast<uint64_t>(stride) * lines;
+  MasterPattern pattern[AHBTRACE_MASTERS][2];
+  uint64_t records = 0, last_ps = 0;
+
+  std::vector<AHBTraceRecord> chunk(1 << 16);
+  size_t n;
+  while ((n = fread(&chunk[0], sizeof(AHBTraceRecord), chunk.size(), in)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      const AHBTraceRecord &rec = chunk[i];
+      uint32_t master = rec.hindex % AHBTRACE_MASTERS;
+      uint32_t dir = (rec.flags & AHBTRACE_WRITE) ? 1 : 0;
+      records++;
+      last_ps = std::max(last_ps, rec.time_ps + rec.latency_ps);
+
+      MasterPattern &p = pattern[master][dir];
+      p.count++;
+      p.bytes += rec.length;
+      if (p.valid && rec.address == p.next) {
+        p.sequential++;
+      } else if (p.valid) {
+        p.gaps[static_cast<int64_t>(rec.address) - static_cast<int64_t>(p.next)]++;
+      }
+      p.next = rec.address + rec.length;
+      p.valid = true;
+
+      if (timeline_file) {
+        size_t bin = rec.time_ps / bin_ps;
+        if (bin >= timeline.size()) {
+          timeline.resize(bin + 1, std::vector<uint64_t>(AHBTRACE_MASTERS * 2, 0));
+        }
+        timeline[bin][master * 2 + dir] += rec.length;
+      }
+
+      if (heatmap_file && rec.address >= base && rec.address - base < region) {
+        uint64_t offset = rec.address - base;
+        uint64_t end = std::min(offset + rec.length, region);
+        while (offset < end) {
+          uint64_t line = offset / stride;
+          uint64_t col = (offset % stride) / cell;
+          uint64_t next = std::min(line * stride + (col + 1) * cell, std::min((line + 1) * stride, end));
+          heatmap[line * columns + col] += next - offset;
+          offset = next;
+        }
+      }
+    }
+  }
+  fclose(in);
+
+  printf("%llu transactions, %.6f ms traced\n\n",
+    static_cast<unsigned long long>(records), last_ps / 1e9);
+  printf("hindex dir    transfers        bytes   avg len  sequential  MB/s\n");
+  for (uint32_t m = 0; m < AHBTRACE_MASTERS; m++) {
+    for (uint32_t d = 0; d < 2; d++) {
+      const MasterPattern &p = pattern[m][d];
+      if (!p.count) {
+        continue;
+      }
+      printf("%6u %-5s %10llu %12llu %9.1f %10.1f%% %6.2f\n", m, d ? "write" : "read",
+        static_cast<unsigned long long>(p.count), static_cast<unsigned long long>(p.bytes),
+        static_cast<double>(p.bytes) / p.count, 100.0 * p.sequential / p.count,
+        last_ps ? p.bytes / (last_ps / 1e12) / 1e6 : 0.0);
+    }
+  }
+
+  // Non-sequential accesses: the most frequent distances between the end of
+  // one transfer and the start of the next of the same master and direction.
+  printf("\nnon-sequential accesses (gap from the end of the previous transfer)\n");
+  for (uint32_t m = 0; m < AHBTRACE_MASTERS; m++) {
+    for (uint32_t d = 0; d < 2; d++) {
+      const MasterPattern &p = pattern[m][d];
+      if (p.gaps.empty()) {
+        continue;
+      }
+      std::vector<std::pair<int64_t, uint64_t> > gaps(p.gaps.begin(), p.gaps.end());
+      std::sort(gaps.begin(), gaps.end(), by_count);
+      uint64_t jumps = p.count - 1 - p.sequential;
+      printf("%6u %-5s %llu jumps (%.1f%%):", m, d ? "write" : "read",
+        static_cast<unsigned long long>(jumps), 100.0 * jumps / p.count);
+      for (size_t g = 0; g < gaps.size() && g < top; g++) {
+        printf(" %+lld x%llu", static_cast<long long>(gaps[g].first),
+          static_cast<unsigned long long>(gaps[g].second));
+      }
+      printf("\n");
+    }
+  }
+
+  if (timeline_file) {
+    FILE *out = fopen(timeline_file, "w");
+    if (!out) {
+      perror(timeline_file);
+      return 1;
+    }
+    fprintf(out, "time_ms");
+    for (uint32_t m = 0; m < AHBTRACE_MASTERS; m++) {
+      fprintf(out, ",m%u_read_MBps,m%u_write_MBps", m, m);
+    }
+    fprintf(out, "\n");
+    for (size_t b = 0; b < timeline.size(); b++) {
+      fprintf(out, "%.6f", b * bin_ps / 1e9);
+      for (uint32_t c = 0; c < AHBTRACE_MASTERS * 2; c++) {
+        fprintf(out, ",%.3f", timeline[b][c] / (bin_ps / 1e12) / 1e6);
+      }
+      fprintf(out, "\n");
+    }
+    fclose(out);
+  }
+
+  if (heatmap_file) {
+    FILE *out = fopen(heatmap_file, "wb");
+    if (!out) {
+      perror(heatmap_file);
+      return 1;
+    }
+    uint64_t max = *std::max_element(heatmap.begin(), heatmap.end());
+    std::vector<uint8_t> pixels(heatmap.size());
+    for (size_t i = 0; i < heatmap.size(); i++) {
+      pixels[i] = max ? static_cast<uint8_t>(heatmap[i] * 255 / max) : 0;
+    }
+    fprintf(out, "P5\n%u %u\n255\n", columns, lines);
+    fwrite(&pixels[0], 1, pixels.size(), out);
+    fclose(out);
+  }
+  return 0;
+}
+/// @}
@@ -0,0 +1,46 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbmonitor
+/// @{
+/// @file ahbtrace.h
+/// Binary AHB transaction trace format shared by AHBTracer and the
+/// ahbtrace analyzer. Plain C++, no SystemC dependency.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBMONITOR_AHBTRACE_H_
+#define MODELS_AHBMONITOR_AHBTRACE_H_
+
+#include <stdint.h>
+
+/// File magic, followed by version and record size (uint32 each)
+#define AHBTRACE_MAGIC "AHBTRACE"
+#define AHBTRACE_VERSION 1
+
+/// Record flags
+#define AHBTRACE_WRITE 0x01
+
+/// One transaction, stored in host byte order. The trace is meant to be
+/// analyzed on the machine that wrote it.
+struct AHBTraceRecord {
+  uint64_t time_ps;     ///< Start of the transaction
+  uint32_t address;
+  uint32_t length;      ///< Bytes transferred
+  uint32_t latency_ps;  ///< Request to response, saturated at 2^32-1
+  uint8_t hindex;       ///< AHB master index
+  uint8_t flags;
+  uint16_t reserved;
+} __attribute__((packed));
+
+struct AHBTraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+} __attribute__((packed));
+
+#endif  // MODELS_AHBMONITOR_AHBTRACE_H_
+/// @}
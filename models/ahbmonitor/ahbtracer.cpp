@@ -0,0 +1,107 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbmonitor
+/// @{
+/// @file ahbtracer.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/ahbmonitor/ahbtracer.h"
+#include "core/common/verbose.h"
+#include <string.h>
+
+AHBTracer::AHBTracer(const std::string &file, size_t buffer_records) :
+  m_file(fopen(file.c_str(), "wb")),
+  m_capacity(buffer_records ? buffer_records : 1),
+  m_pending_full(false),
+  m_stop(false),
+  m_records(0) {
+  if (!m_file) {
+    v::error << "AHBTracer" << "Cannot open trace file " << file << v::endl;
+    return;
+  }
+  AHBTraceHeader header;
+  memcpy(header.magic, AHBTRACE_MAGIC, sizeof(header.magic));
+  header.version = AHBTRACE_VERSION;
+  header.record_size = sizeof(AHBTraceRecord);
+  fwrite(&header, sizeof(header), 1, m_file);
+  m_active.reserve(m_capacity);
+  m_pending.reserve(m_capacity);
+  m_thread = boost::thread(&AHBTracer::writer, this);
+}
+
+AHBTracer::~AHBTracer() {
+  close();
+}
+
+void AHBTracer::record(uint64_t time_ps, uint8_t hindex, bool write,
+    uint32_t address, uint32_t length, uint64_t latency_ps) {
+  if (!m_file) {
+    return;
+  }
+  AHBTraceRecord rec;
+  rec.time_ps = time_ps;
+  rec.address = address;
+  rec.length = length;
+  rec.latency_ps = latency_ps > 0xFFFFFFFFull ? 0xFFFFFFFFu : static_cast<uint32_t>(latency_ps);
+  rec.hindex = hindex;
+  rec.flags = write ? AHBTRACE_WRITE : 0;
+  rec.reserved = 0;
+  m_active.push_back(rec);
+  m_records++;
+  if (m_active.size() == m_capacity) {
+    hand_over();
+  }
+}
+
+void AHBTracer::hand_over() {
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  while (m_pending_full) {
+    m_cond.wait(lock);
+  }
+  m_active.swap(m_pending);
+  m_pending_full = true;
+  m_cond.notify_all();
+}
+
+void AHBTracer::writer() {
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  while (true) {
+    while (!m_pending_full && !m_stop) {
+      m_cond.wait(lock);
+    }
+    if (!m_pending_full) {
+      break;
+    }
+    lock.unlock();
+    fwrite(&m_pending[0], sizeof(AHBTraceRecord), m_pending.size(), m_file);
+    lock.lock();
+    m_pending.clear();
+    m_pending_full = false;
+    m_cond.notify_all();
+  }
+}
+
+void AHBTracer::close() {
+  if (!m_file) {
+    return;
+  }
+  if (!m_active.empty()) {
+    hand_over();
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_stop = true;
+    m_cond.notify_all();
+  }
+  m_thread.join();
+  fclose(m_file);
+  m_file = NULL;
+}
+
+/// @}
@@ -0,0 +1,63 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbmonitor
+/// @{
+/// @file ahbtracer.h
+/// Buffered binary AHB transaction trace writer.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBMONITOR_AHBTRACER_H_
+#define MODELS_AHBMONITOR_AHBTRACER_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <boost/thread.hpp>
+
+#include "models/ahbmonitor/ahbtrace.h"
+
+/// Collects records in a buffer and hands full buffers to a background
+/// thread, which writes them while the simulation fills the next one.
+/// The simulation only blocks when the writer falls a whole buffer behind.
+class AHBTracer {
+  public:
+    AHBTracer(const std::string &file, size_t buffer_records = 1 << 16);
+
+    /// Flushes and closes the trace
+    ~AHBTracer();
+
+    bool is_open() const { return m_file != NULL; }
+
+    void record(uint64_t time_ps, uint8_t hindex, bool write,
+      uint32_t address, uint32_t length, uint64_t latency_ps);
+
+    /// Write the remaining records and stop the writer thread
+    void close();
+
+    uint64_t records() const { return m_records; }
+
+  private:
+    /// Pass the active buffer to the writer, waiting for it if needed
+    void hand_over();
+
+    void writer();
+
+    FILE *m_file;
+    size_t m_capacity;
+    std::vector<AHBTraceRecord> m_active;
+    std::vector<AHBTraceRecord> m_pending;
+    bool m_pending_full;
+    bool m_stop;
+    uint64_t m_records;
+    boost::mutex m_mutex;
+    boost::condition_variable m_cond;
+    boost::thread m_thread;
+};
+
+#endif  // MODELS_AHBMONITOR_AHBTRACER_H_
+/// @}
@@ -0,0 +1,124 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbmonitor
+/// @{
+/// @file ahbmonitor_at.cpp
+/// Counts of AT transactions whose grant comes without a wait.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include <amba.h>
+#include <tlm.h>
+
+#include "core/common/systemc.h"
+#include "core/common/verbose.h"
+#include "models/ahbmonitor/ahbmonitor.h"
+
+/// Issues TRANSACTIONS reads of LENGTH bytes through the AT protocol
+class ATMaster : public sc_core::sc_module {
+  public:
+    SC_HAS_PROCESS(ATMaster);
+
+    amba::amba_master_socket<32> ahb;
+
+    static const uint32_t TRANSACTIONS = 3;
+    static const uint32_t LENGTH = 16;
+
+    explicit ATMaster(sc_core::sc_module_name name) :
+      sc_core::sc_module(name),
+      ahb("ahb", amba::amba_AHB, amba::amba_AT, false) {
+      ahb.register_nb_transport_bw(this, &ATMaster::nb_transport_bw);
+      SC_THREAD(run);
+    }
+
+  private:
+    void run() {
+      for (uint32_t i = 0; i < TRANSACTIONS; i++) {
+        tlm::tlm_generic_payload trans;
+        uint8_t data[LENGTH];
+        trans.set_command(tlm::TLM_READ_COMMAND);
+        trans.set_address(0x40000000 + i * LENGTH);
+        trans.set_data_ptr(data);
+        trans.set_data_length(LENGTH);
+        tlm::tlm_phase phase = tlm::BEGIN_REQ;
+        sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
+        ahb->nb_transport_fw(trans, phase, delay);
+        wait(m_done);
+      }
+    }
+
+    tlm::tlm_sync_enum nb_transport_bw(tlm::tlm_generic_payload &trans, tlm::tlm_phase &phase, sc_core::sc_time &delay) {
+      if (phase == tlm::BEGIN_RESP) {
+        m_done.notify(delay);
+        return tlm::TLM_COMPLETED;
+      }
+      return tlm::TLM_ACCEPTED;
+    }
+
+    sc_core::sc_event m_done;
+};
+
+/// Grants every request at once (END_REQ with zero delay) and responds
+/// 10 ns later
+class ATSlave : public sc_core::sc_module {
+  public:
+    SC_HAS_PROCESS(ATSlave);
+
+    amba::amba_slave_socket<32> ahb;
+
+    explicit ATSlave(sc_core::sc_module_name name) :
+      sc_core::sc_module(name),
+      ahb("ahb", amba::amba_AHB, amba::amba_AT, false),
+      m_trans(NULL) {
+      ahb.register_nb_transport_fw(this, &ATSlave::nb_transport_fw);
+      SC_THREAD(respond);
+    }
+
+  private:
+    tlm::tlm_sync_enum nb_transport_fw(tlm::tlm_generic_payload &trans, tlm::tlm_phase &phase, sc_core::sc_time &delay) {
+      if (phase != tlm::BEGIN_REQ) {
+        return tlm::TLM_COMPLETED;
+      }
+      m_trans = &trans;
+      m_request.notify(sc_core::sc_time(10, sc_core::SC_NS));
+      phase = tlm::END_REQ;
+      return tlm::TLM_UPDATED;
+    }
+
+    void respond() {
+      while (true) {
+        wait(m_request);
+        m_trans->set_response_status(tlm::TLM_OK_RESPONSE);
+        tlm::tlm_phase phase = tlm::BEGIN_RESP;
+        sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
+        ahb->nb_transport_bw(*m_trans, phase, delay);
+      }
+    }
+
+    tlm::tlm_generic_payload *m_trans;
+    sc_core::sc_event m_request;
+};
+
+int sc_main(int argc, char *argv[]) {
+  AHBMonitor monitor("ahbmonitor", sc_core::SC_ZERO_TIME, amba::amba_AT);
+  ATMaster master("master");
+  ATSlave slave("slave");
+  monitor.attach(master.ahb, slave.ahb, "master", 0, 0x03, 0x000);
+
+  sc_core::sc_start();
+
+  const AHBMonitorStats &stats = monitor.stats(0);
+  if (stats.reads != ATMaster::TRANSACTIONS ||
+      stats.read_bytes != ATMaster::TRANSACTIONS * ATMaster::LENGTH) {
+    v::error << "ahbmonitor_at" << "Counted " << stats.reads << " reads of " << stats.read_bytes
+             << " bytes, expected " << ATMaster::TRANSACTIONS << " of "
+             << ATMaster::TRANSACTIONS * ATMaster::LENGTH << v::endl;
+    return 1;
+  }
+  return 0;
+}
+/// @}
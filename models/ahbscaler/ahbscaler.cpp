@@ -0,0 +1,274 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbscaler
+/// @{
+/// @file ahbscaler.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/ahbscaler/ahbscaler.h"
+#include "models/processprofiler/processprofiler.h"
+#include "core/common/verbose.h"
+
+// Source position of the center of output sample dst in 16.16 fixed point,
+// clamped to the first source sample.
+static uint32_t scaler_source_pos(uint32_t dst, uint32_t step, bool bilinear) {
+  uint64_t pos = ((2 * static_cast<uint64_t>(dst) + 1) * step) >> 1;
+  if (bilinear) {
+    pos = (pos > 0x8000) ? pos - 0x8000 : 0;
+  }
+  return static_cast<uint32_t>(pos);
+}
+
+// Fill index and weight tables for dst_count output samples taken from
+// src_count input samples. The last source sample always gets weight 0, so
+// idx + 1 is only dereferenced when it exists.
+static void scaler_build_table(std::vector<uint32_t> &idx, std::vector<uint8_t> &frac,
+    uint32_t src_count, uint32_t dst_count, uint32_t step, bool bilinear) {
+  idx.resize(dst_count);
+  frac.resize(dst_count);
+  for (uint32_t i = 0; i < dst_count; i++) {
+    uint32_t pos = scaler_source_pos(i, step, bilinear);
+    idx[i] = pos >> 16;
+    frac[i] = bilinear ? (pos >> 8) & 0xFF : 0;
+    if (idx[i] >= src_count - 1) {
+      idx[i] = src_count - 1;
+      frac[i] = 0;
+    }
+  }
+}
+
+static inline uint8_t scaler_lerp(uint8_t a, uint8_t b, uint8_t f) {
+  return static_cast<uint8_t>((a * (256 - f) + b * f + 128) >> 8);
+}
+
+AHBScaler::AHBScaler(sc_module_name name,
+  uint32_t hindex,
+  uint32_t pindex,
+  uint32_t paddr,
+  uint32_t pmask,
+  uint32_t in_x,
+  uint32_t in_y,
+  uint32_t in_width,
+  uint32_t in_height,
+  uint32_t out_x,
+  uint32_t out_y,
+  uint32_t out_width,
+  uint32_t out_height,
+  uint32_t frame_width,
+  bool bilinear,
+  AbstractionLayer ambaLayer) :
+  AHBMaster<APBSlave>(
+    name,
+    hindex,
+    0x03,
+    0x006,
+    0,
+    0,
+    ambaLayer,
+    BAR(), BAR(), BAR(), BAR()),
+  m_videoaddr(0xA0000000),
+  m_stride(frame_width * 2),
+  m_in_x(in_x), m_in_y(in_y),
+  m_in_width(in_width), m_in_height(in_height),
+  m_out_x(out_x), m_out_y(out_y),
+  m_out_width(out_width), m_out_height(out_height),
+  m_bilinear(bilinear),
+  m_xstep(0x10000), m_ystep(0x10000),
+  m_frameToggle(true),
+  m_scaler_initialised(false),
+  m_ctrl_written(false) {
+  init_apb(pindex, 0x03, 0x006, 0, 0, APBIO, pmask, 0, 0, paddr);
+
+  init_registers();
+  // Die Threads der Klasse
+  SC_THREAD(scale_frame);
+  SC_METHOD(frameTrigger);
+  sensitive << triggerIn;
+}
+
+void AHBScaler::init_registers() {
+  r.create_register("CTRL", "Scaler Control Register",
+    0x00,        // offset
+    m_bilinear ? 0x04 : 0x00,
+    0xFF)
+  .callback(SR_PRE_READ, this, &AHBScaler::ctrl_read)
+  .callback(SR_POST_WRITE, this, &AHBScaler::ctrl_write);
+  r.create_register("ADDR", "Scaler Video Address Register",
+    0x04,  // offset
+    m_videoaddr,
+    0xFFFFF000);
+  r.create_register("IN_POS", "Scaler Input Position Register",
+    0x08,       // offset
+    (m_in_x << 16) | m_in_y,
+    0xFFFFFFFF);
+  r.create_register("IN_SIZE", "Scaler Input Size Register",
+    0x0C,       // offset
+    (m_in_width << 16) | m_in_height,
+    0xFFFFFFFF);
+  r.create_register("OUT_POS", "Scaler Output Position Register",
+    0x10,     // offset
+    (m_out_x << 16) | m_out_y,
+    0xFFFFFFFF);
+  r.create_register("OUT_SIZE", "Scaler Output Size Register",
+    0x14,     // offset
+    (m_out_width << 16) | m_out_height,
+    0xFFFFFFFF);
+  r.create_register("STRIDE", "Scaler Line Stride Register (bytes)",
+    0x18,     // offset
+    m_stride,
+    0x0000FFFC);
+}
+
+AHBScaler::~AHBScaler() {
+  GC_UNREGISTER_CALLBACKS();
+}
+
+void AHBScaler::end_of_elaboration() {
+}
+
+void AHBScaler::ctrl_read() {
+  uint32_t reg = r[0x0] & 0x4;
+  reg |= m_scaler_initialised ? 1 : 0;
+  reg |= m_frameToggle << 1;
+  r[0x0] = reg;
+}
+
+void AHBScaler::ctrl_write() {
+  m_ctrl_written = true;
+  if ((r[0x0] & 0x1) && !m_scaler_initialised) {
+    init_scaler();
+  }
+  if (!(r[0x0] & 0x1) && m_scaler_initialised) {
+    m_scaler_initialised = false;
+  }
+  if ((r[0x0] & 0x2) && m_scaler_initialised) {
+    frameTriggerEvent.notify();
+  }
+}
+
+void AHBScaler::init_scaler() {
+  m_videoaddr = r[0x4];
+  m_in_x = (r[0x8] >> 16) & 0xFFFF;
+  m_in_y = (r[0x8] >>  0) & 0xFFFF;
+  m_in_width = (r[0xC] >> 16) & 0xFFFE;
+  m_in_height = (r[0xC] >>  0) & 0xFFFF;
+  m_out_x = (r[0x10] >> 16) & 0xFFFF;
+  m_out_y = (r[0x10] >>  0) & 0xFFFF;
+  m_out_width = (r[0x14] >> 16) & 0xFFFE;
+  m_out_height = (r[0x14] >>  0) & 0xFFFF;
+  m_stride = r[0x18];
+  m_bilinear = (r[0x0] & 0x4) != 0;
+
+  if (!m_in_width || !m_in_height || !m_out_width || !m_out_height) {
+    v::warn << name() << "Invalid scaler window, scaler stays disabled" << v::endl;
+    return;
+  }
+
+  m_xstep = static_cast<uint32_t>((static_cast<uint64_t>(m_in_width) << 16) / m_out_width);
+  m_ystep = static_cast<uint32_t>((static_cast<uint64_t>(m_in_height) << 16) / m_out_height);
+  scaler_build_table(m_lidx, m_lfrac, m_in_width, m_out_width, m_xstep, m_bilinear);
+  scaler_build_table(m_cidx, m_cfrac, m_in_width / 2, m_out_width / 2, m_xstep, m_bilinear);
+
+  m_inrow.resize(m_in_width * 2);
+  m_window[0].resize(m_out_width * 2);
+  m_window[1].resize(m_out_width * 2);
+  m_outrow.resize(m_out_width * 2);
+  m_scaler_initialised = true;
+
+  v::info << name() << "CTRL     r[0x00]: " << v::uint32 << (uint32_t)r[0x0] << v::endl;
+  v::info << name() << "ADDR     r[0x04]: " << v::uint32 << (uint32_t)r[0x4] << v::endl;
+  v::info << name() << "IN_POS   r[0x08]: " << v::uint32 << (uint32_t)r[0x8] << v::endl;
+  v::info << name() << "IN_SIZE  r[0x0C]: " << v::uint32 << (uint32_t)r[0xC] << v::endl;
+  v::info << name() << "OUT_POS  r[0x10]: " << v::uint32 << (uint32_t)r[0x10] << v::endl;
+  v::info << name() << "OUT_SIZE r[0x14]: " << v::uint32 << (uint32_t)r[0x14] << v::endl;
+  v::info << name() << "STRIDE   r[0x18]: " << v::uint32 << (uint32_t)r[0x18] << v::endl;
+}
+
+// A hardware trigger starts the scaler with the current register contents,
+// so platforms without a controlling master can use the reset values. Once
+// software wrote CTRL its enable bit decides.
+void AHBScaler::frameTrigger() {
+  PROFILE_PROCESS();
+  if (!m_scaler_initialised && !m_ctrl_written) {
+    init_scaler();
+  }
+  if (m_scaler_initialised) {
+    frameTriggerEvent.notify();
+  }
+}
+
+void AHBScaler::resample_row(const uint8_t *src, uint8_t *dst) {
+  // YUV 4:2:2 is stored as U Y0 V Y1, chroma is resampled on pixel pairs
+  for (uint32_t k = 0; k < m_out_width / 2; k++) {
+    uint32_t c0 = m_cidx[k] * 4;
+    uint32_t c1 = m_cfrac[k] ? c0 + 4 : c0;
+    uint32_t l0 = m_lidx[2 * k] * 2 + 1;
+    uint32_t l1 = m_lfrac[2 * k] ? l0 + 2 : l0;
+    uint32_t m0 = m_lidx[2 * k + 1] * 2 + 1;
+    uint32_t m1 = m_lfrac[2 * k + 1] ? m0 + 2 : m0;
+    dst[4 * k + 0] = scaler_lerp(src[c0], src[c1], m_cfrac[k]);
+    dst[4 * k + 1] = scaler_lerp(src[l0], src[l1], m_lfrac[2 * k]);
+    dst[4 * k + 2] = scaler_lerp(src[c0 + 2], src[c1 + 2], m_cfrac[k]);
+    dst[4 * k + 3] = scaler_lerp(src[m0], src[m1], m_lfrac[2 * k + 1]);
+  }
+}
+
+uint8_t *AHBScaler::fetch_row(uint32_t line) {
+  if (m_windowline[0] == static_cast<int32_t>(line)) {
+    return &m_window[0][0];
+  }
+  if (m_windowline[1] == static_cast<int32_t>(line)) {
+    return &m_window[1][0];
+  }
+  // Output rows only move downwards, so the upper window row is the one to drop
+  uint32_t slot = (m_windowline[0] < m_windowline[1]) ? 0 : 1;
+  ahbread(m_videoaddr + m_in_x * 2 + (m_in_y + line) * m_stride,
+    &m_inrow[0],
+    m_in_width * 2);
+  resample_row(&m_inrow[0], &m_window[slot][0]);
+  m_windowline[slot] = line;
+  return &m_window[slot][0];
+}
+
+void AHBScaler::scale_frame() {
+  PROFILE_PROCESS();
+  m_frameToggle = false;
+  while (true) {
+    ProcessProfiler::wait(frameTriggerEvent);
+
+    m_windowline[0] = m_windowline[1] = -1;
+    for (uint32_t y = 0; y < m_out_height; y++) {
+      uint32_t pos = scaler_source_pos(y, m_ystep, m_bilinear);
+      uint32_t line = pos >> 16;
+      uint8_t frac = m_bilinear ? (pos >> 8) & 0xFF : 0;
+      if (line >= m_in_height - 1) {
+        line = m_in_height - 1;
+        frac = 0;
+      }
+
+      uint8_t *upper = fetch_row(line);
+      uint8_t *row = upper;
+      if (frac) {
+        uint8_t *lower = fetch_row(line + 1);
+        for (uint32_t x = 0; x < m_out_width * 2; x++) {
+          m_outrow[x] = scaler_lerp(upper[x], lower[x], frac);
+        }
+        row = &m_outrow[0];
+      }
+
+      ahbwrite(m_videoaddr + m_out_x * 2 + (m_out_y + y) * m_stride,
+        row,
+        m_out_width * 2);
+    }
+    m_frameToggle = !m_frameToggle;
+    triggerOut.write(m_frameToggle);
+  }
+}
+
+/// @}
@@ -0,0 +1,120 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbscaler
+/// @{
+/// @file ahbscaler.h
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBSCALER_AHBSCALER_H_
+#define MODELS_AHBSCALER_AHBSCALER_H_
+
+#include <amba.h>
+#include <vector>
+
+#include "core/common/base.h"
+#include "core/common/ahbmaster.h"
+#include "core/common/apbdevice.h"
+#include "core/common/apbslave.h"
+#include "core/common/clkdevice.h"
+
+#include "core/common/sr_signal.h"
+
+/// Rescales a YUV 4:2:2 window of the video memory to an arbitrary output size.
+///
+/// Scaling is separable: every source row is resampled horizontally once,
+/// when it enters the two-row streaming window, and each output row is then
+/// blended vertically from the window. Rows that are not needed for any
+/// output row (large downscale ratios) are never read from the bus.
+class AHBScaler : public AHBMaster<APBSlave>, public CLKDevice {
+  public:
+    SC_HAS_PROCESS(AHBScaler);
+    SR_HAS_SIGNALS(AHBScaler);
+    GC_HAS_CALLBACKS();
+
+    sc_in<bool> triggerIn;
+    sc_out<bool> triggerOut;
+
+    AHBScaler(sc_module_name name,
+    uint32_t hindex,
+    uint32_t pindex,
+    uint32_t paddr,
+    uint32_t pmask,
+    uint32_t in_x,
+    uint32_t in_y,
+    uint32_t in_width,
+    uint32_t in_height,
+    uint32_t out_x,
+    uint32_t out_y,
+    uint32_t out_width,
+    uint32_t out_height,
+    uint32_t frame_width,
+    bool bilinear = true,
+    AbstractionLayer ambaLayer = amba::amba_LT);
+
+    /// Destructor
+    ~AHBScaler();
+
+    void init_registers();
+    void end_of_elaboration();
+
+    sc_event frameTriggerEvent;
+
+    sc_core::sc_time get_clock() {return clock_cycle; }
+
+  protected:
+    void init_scaler();
+    void scale_frame();
+    void frameTrigger();
+
+    void ctrl_read();
+    void ctrl_write();
+
+    /// Make sure the source row line is resampled into the window and return it.
+    uint8_t *fetch_row(uint32_t line);
+
+    /// Resample one source row horizontally into dst (m_out_width pixels).
+    void resample_row(const uint8_t *src, uint8_t *dst);
+
+    uint32_t m_videoaddr;
+    uint32_t m_stride;
+    uint32_t m_in_x;
+    uint32_t m_in_y;
+    uint32_t m_in_width;
+    uint32_t m_in_height;
+    uint32_t m_out_x;
+    uint32_t m_out_y;
+    uint32_t m_out_width;
+    uint32_t m_out_height;
+    bool m_bilinear;
+
+    /// 16.16 fixed point source step per output pixel / row
+    uint32_t m_xstep;
+    uint32_t m_ystep;
+
+    /// Horizontal lookup tables: source luma pixel and chroma pair per
+    /// output pixel / pair, each with an 8 bit interpolation weight.
+    std::vector<uint32_t> m_lidx;
+    std::vector<uint8_t> m_lfrac;
+    std::vector<uint32_t> m_cidx;
+    std::vector<uint8_t> m_cfrac;
+
+    /// Streaming window of two horizontally resampled source rows.
+    std::vector<uint8_t> m_inrow;
+    std::vector<uint8_t> m_window[2];
+    int32_t m_windowline[2];
+    std::vector<uint8_t> m_outrow;
+
+    bool m_frameToggle;
+    bool m_scaler_initialised;
+    /// Software took control, triggers no longer enable the scaler
+    bool m_ctrl_written;
+};
+
+#endif  // MODELS_AHBSCALER_AHBSCALER_H_
+/// @}
@@ -0,0 +1,263 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbstatistics
+/// @{
+/// @file ahbstatistics.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/ahbstatistics/ahbstatistics.h"
+#include "models/processprofiler/processprofiler.h"
+#include "core/common/verbose.h"
+#include <stdio.h>
+
+/// Four histogram bins processed at once when merging the sub-histograms
+typedef uint32_t stats_vec_t __attribute__((vector_size(16)));
+
+AHBStatistics::AHBStatistics(sc_module_name name,
+  uint32_t hindex,
+  uint32_t pindex,
+  uint32_t paddr,
+  uint32_t pmask,
+  uint32_t x,
+  uint32_t y,
+  uint32_t width,
+  uint32_t height,
+  uint32_t frame_width,
+  AbstractionLayer ambaLayer) :
+  AHBMaster<APBSlave>(
+    name,
+    hindex,
+    0x03,
+    0x008,
+    0,
+    0,
+    ambaLayer,
+    BAR(), BAR(), BAR(), BAR()),
+  m_min(0), m_max(0),
+  m_sum(0), m_sumsq(0),
+  m_count(0), m_frames(0),
+  m_row(frame_width * 2),
+  m_block(32 + 256 * 4),
+  m_frameToggle(true),
+  m_busy(false) {
+  init_apb(pindex, 0x03, 0x008, 0, 0, APBIO, pmask, 0, 0, paddr);
+
+  init_registers();
+  r[0x08] = (x << 16) | y;
+  r[0x0C] = (width << 16) | height;
+  r[0x10] = frame_width * 2;
+  // Die Threads der Klasse
+  SC_THREAD(collect);
+  SC_METHOD(frameTrigger);
+  sensitive << triggerIn;
+}
+
+void AHBStatistics::init_registers() {
+  r.create_register("CTRL", "Statistics Control Register",
+    0x00,        // offset
+    0x01,
+    0x0F)
+  .callback(SR_PRE_READ, this, &AHBStatistics::ctrl_read)
+  .callback(SR_POST_WRITE, this, &AHBStatistics::ctrl_write);
+  r.create_register("ADDR", "Statistics Video Address Register",
+    0x04,  // offset
+    0xA0000000,
+    0xFFFFF000);
+  r.create_register("POS", "Statistics Region Position Register",
+    0x08,       // offset
+    0x00000000,
+    0xFFFFFFFF);
+  r.create_register("SIZE", "Statistics Region Size Register",
+    0x0C,       // offset
+    0x00000000,
+    0xFFFFFFFF);
+  r.create_register("STRIDE", "Statistics Line Stride Register (bytes)",
+    0x10,     // offset
+    0x00000000,
+    0x0000FFFC);
+  r.create_register("RESULT", "Statistics Result Block Address Register",
+    0x14,     // offset
+    0x00000000,
+    0xFFFFFFFC);
+  r.create_register("COUNT", "Statistics Sample Count Register",
+    0x18, 0x00000000, 0x00000000);
+  r.create_register("MINMAX", "Statistics Luma Min/Max Register",
+    0x1C, 0x00000000, 0x00000000);
+  r.create_register("MEAN", "Statistics Luma Mean Register (8.8)",
+    0x20, 0x00000000, 0x00000000);
+  r.create_register("VARIANCE", "Statistics Luma Variance Register (24.8)",
+    0x24, 0x00000000, 0x00000000);
+  r.create_register("FRAMES", "Statistics Frame Counter Register",
+    0x28, 0x00000000, 0x00000000);
+  for (uint32_t i = 0; i < 256; i++) {
+    char bin[16];
+    snprintf(bin, sizeof(bin), "BIN%u", i);
+    r.create_register(bin, "Statistics Histogram Bin Register",
+      0x400 + i * 4, 0x00000000, 0x00000000);
+  }
+}
+
+AHBStatistics::~AHBStatistics() {
+  GC_UNREGISTER_CALLBACKS();
+}
+
+void AHBStatistics::end_of_elaboration() {
+}
+
+void AHBStatistics::ctrl_read() {
+  uint32_t reg = r[0x0] & 0xD;
+  reg |= m_frameToggle << 1;
+  reg |= m_busy << 4;
+  r[0x0] = reg;
+}
+
+void AHBStatistics::ctrl_write() {
+  if ((r[0x0] & 0x3) == 0x3) {
+    frameTriggerEvent.notify();
+  }
+}
+
+void AHBStatistics::frameTrigger() {
+  PROFILE_PROCESS();
+  if (r[0x0] & 0x1) {
+    frameTriggerEvent.notify();
+  }
+}
+
+void AHBStatistics::count_row(const uint8_t *row, uint32_t width) {
+  uint32_t min = m_min, max = m_max, sum = 0;
+  uint64_t sumsq = 0;
+  uint32_t i = 0;
+  // Luma sits at the odd bytes of U Y0 V Y1, pixel i goes to lane i % 4
+  for (; i + AHBSTATISTICS_LANES <= width; i += AHBSTATISTICS_LANES) {
+    const uint8_t *p = row + i * 2;
+    uint32_t y0 = p[1], y1 = p[3], y2 = p[5], y3 = p[7];
+    m_subhist[0][y0]++;
+    m_subhist[1][y1]++;
+    m_subhist[2][y2]++;
+    m_subhist[3][y3]++;
+    sum += y0 + y1 + y2 + y3;
+    sumsq += y0 * y0 + y1 * y1 + y2 * y2 + y3 * y3;
+    min = std::min(min, std::min(std::min(y0, y1), std::min(y2, y3)));
+    max = std::max(max, std::max(std::max(y0, y1), std::max(y2, y3)));
+  }
+  for (; i < width; i++) {
+    uint32_t y0 = row[i * 2 + 1];
+    m_subhist[i % AHBSTATISTICS_LANES][y0]++;
+    sum += y0;
+    sumsq += y0 * y0;
+    min = std::min(min, y0);
+    max = std::max(max, y0);
+  }
+  m_min = min;
+  m_max = max;
+  m_sum += sum;
+  m_sumsq += sumsq;
+  m_count += width;
+}
+
+void AHBStatistics::publish() {
+  for (uint32_t b = 0; b < 256; b += 4) {
+    stats_vec_t acc, lane;
+    memcpy(&acc, &m_subhist[0][b], sizeof(acc));
+    for (uint32_t l = 1; l < AHBSTATISTICS_LANES; l++) {
+      memcpy(&lane, &m_subhist[l][b], sizeof(lane));
+      acc += lane;
+    }
+    memcpy(&m_hist[b], &acc, sizeof(acc));
+  }
+
+  uint32_t bins = (r[0x0] & 0x4) ? 256 : 64;
+  if (bins == 64) {
+    for (uint32_t b = 0; b < 64; b++) {
+      m_hist[b] = m_hist[4 * b] + m_hist[4 * b + 1] + m_hist[4 * b + 2] + m_hist[4 * b + 3];
+    }
+    memset(&m_hist[64], 0, sizeof(uint32_t) * (256 - 64));
+  }
+
+  double mean = 0.0, variance = 0.0;
+  if (m_count) {
+    mean = static_cast<double>(m_sum) / m_count;
+    variance = static_cast<double>(m_sumsq) / m_count - mean * mean;
+  } else {
+    m_min = m_max = 0;
+  }
+
+  m_frames++;
+  r[0x18] = m_count;
+  r[0x1C] = (m_max << 16) | m_min;
+  r[0x20] = static_cast<uint32_t>(mean * 256.0 + 0.5);
+  r[0x24] = static_cast<uint32_t>(variance * 256.0 + 0.5);
+  r[0x28] = m_frames;
+  for (uint32_t b = 0; b < 256; b++) {
+    r[0x400 + b * 4] = m_hist[b];
+  }
+
+  if ((r[0x0] & 0x8) && r[0x14]) {
+    write_result_block(bins);
+  }
+}
+
+static inline void statistics_store_word(uint8_t *dst, uint32_t value) {
+  dst[0] = value >> 24;
+  dst[1] = value >> 16;
+  dst[2] = value >> 8;
+  dst[3] = value;
+}
+
+// Result block layout (32 bit words): frames, count, minmax, mean, variance,
+// number of bins, two reserved words, followed by the bins.
+void AHBStatistics::write_result_block(uint32_t bins) {
+  uint8_t *block = &m_block[0];
+  statistics_store_word(block + 0x00, r[0x28]);
+  statistics_store_word(block + 0x04, r[0x18]);
+  statistics_store_word(block + 0x08, r[0x1C]);
+  statistics_store_word(block + 0x0C, r[0x20]);
+  statistics_store_word(block + 0x10, r[0x24]);
+  statistics_store_word(block + 0x14, bins);
+  statistics_store_word(block + 0x18, 0);
+  statistics_store_word(block + 0x1C, 0);
+  for (uint32_t b = 0; b < bins; b++) {
+    statistics_store_word(block + 0x20 + b * 4, m_hist[b]);
+  }
+  ahbwrite(r[0x14], block, 0x20 + bins * 4);
+}
+
+void AHBStatistics::collect() {
+  PROFILE_PROCESS();
+  m_frameToggle = false;
+  while (true) {
+    ProcessProfiler::wait(frameTriggerEvent);
+    m_busy = true;
+
+    uint32_t videoaddr = r[0x4];
+    uint32_t x = (r[0x8] >> 16) & 0xFFFF;
+    uint32_t y = (r[0x8] >>  0) & 0xFFFF;
+    uint32_t width = std::min((r[0xC] >> 16) & 0xFFFF, static_cast<uint32_t>(m_row.size() / 2));
+    uint32_t height = (r[0xC] >>  0) & 0xFFFF;
+    uint32_t stride = r[0x10];
+
+    memset(m_subhist, 0, sizeof(m_subhist));
+    m_min = 255;
+    m_max = 0;
+    m_sum = m_sumsq = 0;
+    m_count = 0;
+    for (uint32_t i = 0; i < height && width; i++) {
+      ahbread(videoaddr + x * 2 + (y + i) * stride, &m_row[0], width * 2);
+      count_row(&m_row[0], width);
+    }
+    publish();
+
+    m_busy = false;
+    m_frameToggle = !m_frameToggle;
+    triggerOut.write(m_frameToggle);
+  }
+}
+
+/// @}
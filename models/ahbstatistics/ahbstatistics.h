@@ -0,0 +1,103 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbstatistics
+/// @{
+/// @file ahbstatistics.h
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBSTATISTICS_AHBSTATISTICS_H_
+#define MODELS_AHBSTATISTICS_AHBSTATISTICS_H_
+
+#include <amba.h>
+#include <algorithm>
+#include <vector>
+
+#include "core/common/base.h"
+#include "core/common/ahbmaster.h"
+#include "core/common/apbdevice.h"
+#include "core/common/apbslave.h"
+#include "core/common/clkdevice.h"
+
+#include "core/common/sr_signal.h"
+
+/// Number of interleaved sub-histograms. Neighbouring pixels never update
+/// the same counter array, so the counting loop has no store-to-load
+/// dependency between consecutive pixels.
+#define AHBSTATISTICS_LANES 4
+
+/// Streams a region of the video memory once per frame and computes a luma
+/// histogram (64 or 256 bins) together with min, max, mean and variance.
+///
+/// Results are readable through APB registers and can optionally be written
+/// as one result block to memory at the end of every frame.
+class AHBStatistics : public AHBMaster<APBSlave>, public CLKDevice {
+  public:
+    SC_HAS_PROCESS(AHBStatistics);
+    SR_HAS_SIGNALS(AHBStatistics);
+    GC_HAS_CALLBACKS();
+
+    sc_in<bool> triggerIn;
+    sc_out<bool> triggerOut;
+
+    AHBStatistics(sc_module_name name,
+    uint32_t hindex,
+    uint32_t pindex,
+    uint32_t paddr,
+    uint32_t pmask,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    uint32_t frame_width,
+    AbstractionLayer ambaLayer = amba::amba_LT);
+
+    /// Destructor
+    ~AHBStatistics();
+
+    void init_registers();
+    void end_of_elaboration();
+
+    sc_event frameTriggerEvent;
+
+    sc_core::sc_time get_clock() {return clock_cycle; }
+
+  protected:
+    void collect();
+    void frameTrigger();
+
+    void ctrl_read();
+    void ctrl_write();
+
+    /// Count the luma samples of one UYVY row into the sub-histograms.
+    void count_row(const uint8_t *row, uint32_t width);
+
+    /// Merge the sub-histograms and publish all results.
+    void publish();
+
+    /// Write the result block to RESULT_ADDR in bus byte order.
+    void write_result_block(uint32_t bins);
+
+    uint32_t m_subhist[AHBSTATISTICS_LANES][256] __attribute__((aligned(16)));
+    uint32_t m_hist[256] __attribute__((aligned(16)));
+    uint32_t m_min;
+    uint32_t m_max;
+    uint64_t m_sum;
+    uint64_t m_sumsq;
+    uint32_t m_count;
+    uint32_t m_frames;
+
+    std::vector<uint8_t> m_row;
+    std::vector<uint8_t> m_block;
+
+    bool m_frameToggle;
+    bool m_busy;
+};
+
+#endif  // MODELS_AHBSTATISTICS_AHBSTATISTICS_H_
+/// @}
@@ -0,0 +1,235 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbvideomaster
+/// @{
+/// @file ahbvideomaster.h
+/// Strided two dimensional transfers for the video masters.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBVIDEOMASTER_AHBVIDEOMASTER_H_
+#define MODELS_AHBVIDEOMASTER_AHBVIDEOMASTER_H_
+
+#include <tlm.h>
+#include <tlm_utils/tlm_quantumkeeper.h>
+#include <algorithm>
+#include <cstring>
+
+#include "core/common/ahbmaster.h"
+#include "core/common/verbose.h"
+#include "models/processprofiler/processprofiler.h"
+
+/// Longest single AHB transfer issued when rows are coalesced
+#define AHBVIDEOMASTER_MAX_BURST 0x10000
+
+/// Transfer fidelity of all video masters, switchable at runtime
+enum AHBVideoFidelity {
+  /// Fast in the LT layer and detailed in the AT layer
+  AHBVIDEO_NATIVE,
+  /// DMI and temporal decoupling in both layers. Without DMI the AT layer
+  /// falls back to debug transfers annotated with one clock per word.
+  AHBVIDEO_FAST,
+  /// Every burst on the bus, waited for after each region
+  AHBVIDEO_DETAILED
+};
+
+inline AHBVideoFidelity &ahbvideo_fidelity() {
+  static AHBVideoFidelity fidelity = AHBVIDEO_NATIVE;
+  return fidelity;
+}
+
+/// AHBMaster with transfers of rectangular regions of the video memory.
+///
+/// A region is height rows of width bytes, the rows are stride bytes apart
+/// on the bus and packed (width bytes apart) in the local buffer.
+/// Contiguous rows are merged into bursts of up to AHBVIDEOMASTER_MAX_BURST
+/// bytes, a region covered by a DMI grant is copied directly.
+///
+/// In the LT layer the master is temporally decoupled: the bus delays are
+/// added to a local time offset kept by a tlm_quantumkeeper, which waits
+/// only when the offset exceeds the global quantum. Models call ahbsync()
+/// before they signal the end of a frame or access registers with blocking
+/// transfers. A global quantum of SC_ZERO_TIME waits once per region.
+/// The host time saved by a larger quantum has not been measured; compare
+/// the wall time in report.summary for conf.system.quantum 0 and e.g. 1000.
+///
+/// Which of this applies is decided per region by ahbvideo_fidelity(), so
+/// the video traffic can run with fast transfers and switch to detailed
+/// ones later on (see APBVideoDetail).
+template<class BASE = sc_core::sc_module>
+class AHBVideoMaster : public AHBMaster<BASE> {
+  public:
+    AHBVideoMaster(ModuleName name,
+      uint8_t hindex,
+      uint8_t vendor,
+      uint16_t device,
+      uint8_t version,
+      uint8_t irq,
+      AbstractionLayer ambaLayer,
+      BAR bar0 = BAR(),
+      BAR bar1 = BAR(),
+      BAR bar2 = BAR(),
+      BAR bar3 = BAR()) :
+      AHBMaster<BASE>(name, hindex, vendor, device, version, irq, ambaLayer, bar0, bar1, bar2, bar3) {
+      m_qk.reset();
+    }
+
+    /// Read height rows of width bytes, stride bytes apart, into data.
+    void ahbread2d(uint32_t addr, uint8_t *data, uint32_t width, uint32_t height, uint32_t stride) {
+      uint32_t last = addr + (height - 1) * stride + width;
+      if (!width || !height) {
+        return;
+      }
+      sc_core::sc_time delay = local_time();
+      if (dmi_region(addr, last, tlm::TLM_READ_COMMAND)) {
+        const uint8_t *mem = m_dmi.get_dmi_ptr() + (addr - m_dmi.get_start_address());
+        for (uint32_t i = 0; i < height; i++) {
+          memcpy(data + i * width, mem + i * stride, width);
+        }
+        delay += m_dmi.get_read_latency() * ((height * width + 3) / 4);
+      } else if (stride == width) {
+        for (uint32_t done = 0; done < height * width; done += AHBVIDEOMASTER_MAX_BURST) {
+          transfer(false, addr + done, data + done,
+            std::min(height * width - done, static_cast<uint32_t>(AHBVIDEOMASTER_MAX_BURST)), &delay);
+        }
+      } else {
+        for (uint32_t i = 0; i < height; i++) {
+          transfer(false, addr + i * stride, data + i * width, width, &delay);
+        }
+      }
+      sync(delay);
+    }
+
+    /// Write height rows of width bytes from data, stride bytes apart.
+    /// Every row is written to repeat consecutive lines.
+    void ahbwrite2d(uint32_t addr, uint8_t *data, uint32_t width, uint32_t height, uint32_t stride, uint32_t repeat = 1) {
+      uint32_t lines = height * repeat;
+      uint32_t last = addr + (lines - 1) * stride + width;
+      if (!width || !lines) {
+        return;
+      }
+      sc_core::sc_time delay = local_time();
+      if (dmi_region(addr, last, tlm::TLM_WRITE_COMMAND)) {
+        uint8_t *mem = m_dmi.get_dmi_ptr() + (addr - m_dmi.get_start_address());
+        for (uint32_t l = 0; l < lines; l++) {
+          memcpy(mem + l * stride, data + (l / repeat) * width, width);
+        }
+        delay += m_dmi.get_write_latency() * ((lines * width + 3) / 4);
+      } else if (stride == width && repeat == 1) {
+        for (uint32_t done = 0; done < lines * width; done += AHBVIDEOMASTER_MAX_BURST) {
+          transfer(true, addr + done, data + done,
+            std::min(lines * width - done, static_cast<uint32_t>(AHBVIDEOMASTER_MAX_BURST)), &delay);
+        }
+      } else {
+        for (uint32_t l = 0; l < lines; l++) {
+          transfer(true, addr + l * stride, data + (l / repeat) * width, width, &delay);
+        }
+      }
+      sync(delay);
+    }
+
+    /// Add processing time to the local time offset.
+    void consume(const sc_core::sc_time &time) {
+      m_qk.inc(time);
+      if (!fast() || m_qk.need_sync()) {
+        ahbsync();
+      }
+    }
+
+    /// Wait for the local time offset, e.g. at the end of a frame.
+    void ahbsync() {
+      sc_core::sc_time local = m_qk.get_local_time();
+      if (local != sc_core::SC_ZERO_TIME) {
+        ProcessProfiler::wait(local);
+      }
+      m_qk.reset();
+    }
+
+  private:
+    bool fast() const {
+      AHBVideoFidelity fidelity = ahbvideo_fidelity();
+      return fidelity == AHBVIDEO_FAST || (fidelity == AHBVIDEO_NATIVE && this->m_ambaLayer == amba::amba_LT);
+    }
+
+    /// Local time offset to start a region with. Detailed transfers are
+    /// not decoupled, so the offset is waited for first. Without an
+    /// offset the sync point is rebased, it is stale after a frame wait.
+    sc_core::sc_time local_time() {
+      if (!fast()) {
+        ahbsync();
+      } else if (m_qk.get_local_time() == sc_core::SC_ZERO_TIME) {
+        m_qk.reset();
+      }
+      return m_qk.get_local_time();
+    }
+
+    /// Issue one burst, in the LT layer without waiting for it.
+    void transfer(bool write, uint32_t addr, uint8_t *data, uint32_t length, sc_core::sc_time *delay) {
+      if (this->m_ambaLayer != amba::amba_LT && fast()) {
+        if (write) {
+          this->ahbwrite_dbg(addr, data, length);
+        } else {
+          this->ahbread_dbg(addr, data, length);
+        }
+        *delay += this->get_clock() * ((length + 3) / 4);
+        return;
+      }
+      if (this->m_ambaLayer != amba::amba_LT) {
+        if (write) {
+          this->ahbwrite(addr, data, length);
+        } else {
+          this->ahbread(addr, data, length);
+        }
+        return;
+      }
+      tlm::tlm_response_status response = tlm::TLM_OK_RESPONSE;
+      if (write) {
+        this->ahbwrite(addr, data, length, delay, false, false, &response);
+      } else {
+        this->ahbread(addr, data, length, delay, false, false, &response);
+      }
+      if (response != tlm::TLM_OK_RESPONSE) {
+        v::warn << this->name() << "2D transfer of " << length << " bytes at "
+                << v::uint32 << addr << " failed" << v::endl;
+      }
+    }
+
+    /// Take over the local time offset after a region
+    void sync(const sc_core::sc_time &delay) {
+      m_qk.set(delay);
+      if (!fast() || m_qk.need_sync()) {
+        ahbsync();
+      }
+    }
+
+    /// Ask for a DMI pointer covering [start, end). The grant is requested
+    /// per region and never kept across a wait, so invalidations between
+    /// two regions cannot leave a stale pointer behind.
+    bool dmi_region(uint32_t start, uint32_t end, tlm::tlm_command command) {
+      if (!fast()) {
+        return false;
+      }
+      tlm::tlm_generic_payload trans;
+      trans.set_command(command);
+      trans.set_address(start);
+      trans.set_data_length(end - start);
+      m_dmi.init();
+      if (!this->ahb->get_direct_mem_ptr(trans, m_dmi)) {
+        return false;
+      }
+      if (m_dmi.get_start_address() > start || m_dmi.get_end_address() < end - 1) {
+        return false;
+      }
+      return (command == tlm::TLM_READ_COMMAND) ? m_dmi.is_read_allowed() : m_dmi.is_write_allowed();
+    }
+
+    tlm::tlm_dmi m_dmi;
+    tlm_utils::tlm_quantumkeeper m_qk;
+};
+
+#endif  // MODELS_AHBVIDEOMASTER_AHBVIDEOMASTER_H_
+/// @}
@@ -0,0 +1,69 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbvideomaster
+/// @{
+/// @file framedescriptor.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/ahbvideomaster/framedescriptor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+void FrameLatency::record(const FrameDescriptor &frame) {
+  Sample sample = { frame.sequence, frame.timestamp, sc_core::sc_time_stamp() };
+  m_samples.push_back(sample);
+}
+
+sc_core::sc_time FrameLatency::percentile(double p) const {
+  if (m_samples.empty()) {
+    return SC_ZERO_TIME;
+  }
+  std::vector<sc_core::sc_time> latencies;
+  latencies.reserve(m_samples.size());
+  for (size_t i = 0; i < m_samples.size(); i++) {
+    latencies.push_back(m_samples[i].end - m_samples[i].start);
+  }
+  std::sort(latencies.begin(), latencies.end());
+  size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * latencies.size()));
+  return latencies[rank ? rank - 1 : 0];
+}
+
+void FrameLatency::report(const char *name) const {
+  if (m_samples.empty()) {
+    return;
+  }
+  v::info << name << "Frame latency min/p50/p95/p99/max: "
+          << percentile(0) << " / " << percentile(50) << " / " << percentile(95) << " / "
+          << percentile(99) << " / " << percentile(100) << v::endl;
+  sc_core::sc_time span = m_samples.back().end - m_samples.front().end;
+  if (m_samples.size() > 1 && span > sc_core::SC_ZERO_TIME) {
+    v::info << name << "Throughput: " << (m_samples.size() - 1) / span.to_seconds()
+            << " fps simulated over " << m_samples.size() << " frames" << v::endl;
+  }
+}
+
+bool FrameLatency::write_csv(const std::string &file) const {
+  FILE *out = fopen(file.c_str(), "w");
+  if (!out) {
+    v::error << "FrameLatency" << "Cannot write latencies to " << file << v::endl;
+    return false;
+  }
+  fprintf(out, "sequence,start_ns,end_ns,latency_ns\n");
+  for (size_t i = 0; i < m_samples.size(); i++) {
+    const Sample &s = m_samples[i];
+    fprintf(out, "%u,%.0f,%.0f,%.0f\n", s.sequence,
+      s.start.to_seconds() * 1e9, s.end.to_seconds() * 1e9, (s.end - s.start).to_seconds() * 1e9);
+  }
+  fclose(out);
+  return true;
+}
+
+/// @}
@@ -0,0 +1,151 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbvideomaster
+/// @{
+/// @file framedescriptor.h
+/// Frame descriptors handed between the video models over sr_signal ports.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBVIDEOMASTER_FRAMEDESCRIPTOR_H_
+#define MODELS_AHBVIDEOMASTER_FRAMEDESCRIPTOR_H_
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "core/common/systemc.h"
+#include "core/common/verbose.h"
+
+/// Pixel formats of a frame buffer
+enum FrameFormat {
+  /// YUV 4:2:2, byte order U Y V Y
+  FRAME_YUV422 = 0
+};
+
+/// A finished frame: where it is, its geometry and where it came from.
+///
+/// The sequence number and the timestamp are assigned by the first stage of
+/// a pipeline and forwarded by every stage behind it, so a consumer sees
+/// frames lost anywhere upstream as gaps and can compute the end-to-end
+/// latency.
+struct FrameDescriptor {
+  /// Bus address of the first pixel
+  uint32_t addr;
+  /// Pixels per row
+  uint32_t width;
+  /// Rows
+  uint32_t height;
+  /// Bytes from one row to the next
+  uint32_t stride;
+  /// One of FrameFormat
+  uint32_t format;
+  /// Frame number, counted from 1 by the first stage
+  uint32_t sequence;
+  /// Simulated time the first stage started the frame
+  sc_core::sc_time timestamp;
+};
+
+inline std::ostream &operator<<(std::ostream &os, const FrameDescriptor &frame) {
+  return os << "frame " << frame.sequence << " at 0x" << std::hex << frame.addr << std::dec
+            << " " << frame.width << "x" << frame.height << " stride " << frame.stride;
+}
+
+/// End-to-end latencies of the frames a consumer finished.
+///
+/// The latency of a frame is the time from the stamp of the first stage to
+/// the call of record(). The report gives min, median, 95th and 99th
+/// percentile and max (nearest rank) and the throughput between the first
+/// and the last recorded frame.
+class FrameLatency {
+  public:
+    /// Record a frame finished now
+    void record(const FrameDescriptor &frame);
+
+    /// Print the statistics under the given name
+    void report(const char *name) const;
+
+    /// Write one line per frame: sequence, start, end and latency in ns
+    bool write_csv(const std::string &file) const;
+
+    uint32_t frames() const { return m_samples.size(); }
+
+    /// Latency at the given percentile (0..100)
+    sc_core::sc_time percentile(double p) const;
+
+  private:
+    struct Sample {
+      uint32_t sequence;
+      sc_core::sc_time start;
+      sc_core::sc_time end;
+    };
+    std::vector<Sample> m_samples;
+};
+
+/// Receive side of a frame descriptor port.
+///
+/// Holds the latest descriptor until the model takes it. A descriptor that
+/// is overwritten before it was taken and the gaps in the sequence numbers
+/// are counted as dropped frames.
+class FrameInbox {
+  public:
+    FrameInbox() : m_pending(false), m_received(0), m_dropped(0), m_next(0) {}
+
+    /// Store a descriptor from the port callback
+    void put(const FrameDescriptor &frame) {
+      if (m_pending) {
+        m_dropped++;
+      }
+      if (m_next && frame.sequence > m_next) {
+        m_dropped += frame.sequence - m_next;
+      }
+      m_next = frame.sequence + 1;
+      m_frame = frame;
+      m_pending = true;
+      m_received++;
+    }
+
+    /// Take the pending descriptor, false if there is none
+    bool take(FrameDescriptor &frame) {
+      if (!m_pending) {
+        return false;
+      }
+      frame = m_frame;
+      m_pending = false;
+      return true;
+    }
+
+    /// Account the end-to-end latency of a frame finished now
+    void done(const FrameDescriptor &frame) {
+      m_latency.record(frame);
+    }
+
+    /// True once a descriptor arrived, the model then ignores its frame toggle
+    bool linked() const { return m_received != 0; }
+    uint32_t received() const { return m_received; }
+    uint32_t dropped() const { return m_dropped; }
+
+    /// Print received and dropped frames and the latencies
+    void report(const char *name) const {
+      v::info << name << "Frames received: " << m_received << ", dropped: " << m_dropped << v::endl;
+      m_latency.report(name);
+    }
+
+    const FrameLatency &latency() const { return m_latency; }
+
+  private:
+    bool m_pending;
+    FrameDescriptor m_frame;
+    uint32_t m_received;
+    uint32_t m_dropped;
+    uint32_t m_next;
+    FrameLatency m_latency;
+};
+
+#endif  // MODELS_AHBVIDEOMASTER_FRAMEDESCRIPTOR_H_
+/// @}
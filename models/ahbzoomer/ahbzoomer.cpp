@@ -0,0 +1,173 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbzoomer
+/// @{
+/// @file ahbzoomer.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/ahbzoomer/ahbzoomer.h"
+#include "models/processprofiler/processprofiler.h"
+#include "core/common/verbose.h"
+
+AHBZoomer::AHBZoomer(sc_module_name name,
+  uint32_t hindex,
+  uint32_t pindex,
+  uint32_t paddr,
+  uint32_t pmask,
+  uint32_t frame_width,
+  AbstractionLayer ambaLayer) :
+  AHBVideoMaster<APBSlave>(
+    name,
+    hindex,
+    0x03,
+    0x007,
+    0,
+    0,
+    ambaLayer,
+    BAR(), BAR(), BAR(), BAR()),
+  m_frame_width(frame_width),
+  m_factor(2),
+  m_inrow(frame_width * 2),
+  m_outrow(frame_width * 2),
+  m_frameToggle(true),
+  m_busy(false) {
+  init_apb(pindex, 0x03, 0x007, 0, 0, APBIO, pmask, 0, 0, paddr);
+
+  init_registers();
+  // Die Threads der Klasse
+  SC_THREAD(zoom_frame);
+  SC_METHOD(frameTrigger);
+  sensitive << triggerIn;
+}
+
+void AHBZoomer::init_registers() {
+  r.create_register("CTRL", "Zoomer Control Register",
+    0x00,        // offset
+    0x00,
+    0xFF)
+  .callback(SR_PRE_READ, this, &AHBZoomer::ctrl_read)
+  .callback(SR_POST_WRITE, this, &AHBZoomer::ctrl_write);
+  r.create_register("ADDR", "Zoomer Video Address Register",
+    0x04,  // offset
+    0xA0000000,
+    0xFFFFF000);
+  r.create_register("SRC_POS", "Zoomer Source Position Register",
+    0x08,       // offset
+    0x00000000,
+    0xFFFFFFFF);
+  r.create_register("SRC_SIZE", "Zoomer Source Size Register",
+    0x0C,       // offset
+    (m_frame_width / 4 << 16) | (m_frame_width / 4 * 3 / 4),
+    0xFFFFFFFF);
+  r.create_register("DST_POS", "Zoomer Destination Position Register",
+    0x10,     // offset
+    0x00000000,
+    0xFFFFFFFF);
+  r.create_register("FACTOR", "Zoomer Zoom Factor Register",
+    0x14,     // offset
+    m_factor,
+    0x0000000F);
+  r.create_register("STRIDE", "Zoomer Line Stride Register (bytes)",
+    0x18,     // offset
+    m_frame_width * 2,
+    0x0000FFFC);
+}
+
+AHBZoomer::~AHBZoomer() {
+  GC_UNREGISTER_CALLBACKS();
+}
+
+void AHBZoomer::end_of_elaboration() {
+}
+
+void AHBZoomer::ctrl_read() {
+  uint32_t reg = r[0x0] & 0x1;
+  reg |= m_frameToggle << 1;
+  reg |= m_busy << 2;
+  r[0x0] = reg;
+}
+
+void AHBZoomer::ctrl_write() {
+  if ((r[0x0] & 0x3) == 0x3) {
+    frameTriggerEvent.notify();
+  }
+}
+
+void AHBZoomer::frameTrigger() {
+  PROFILE_PROCESS();
+  if (r[0x0] & 0x1) {
+    frameTriggerEvent.notify();
+  }
+}
+
+void AHBZoomer::zoom_frame() {
+  PROFILE_PROCESS();
+  m_frameToggle = false;
+  while (true) {
+    ProcessProfiler::wait(frameTriggerEvent);
+    m_busy = true;
+
+    // The window is sampled once per frame, so software may move it between frames
+    uint32_t videoaddr = r[0x4];
+    uint32_t src_x = (r[0x8] >> 16) & 0xFFFF;
+    uint32_t src_y = (r[0x8] >>  0) & 0xFFFF;
+    uint32_t src_width = (r[0xC] >> 16) & 0xFFFE;
+    uint32_t src_height = (r[0xC] >>  0) & 0xFFFF;
+    uint32_t dst_x = (r[0x10] >> 16) & 0xFFFF;
+    uint32_t dst_y = (r[0x10] >>  0) & 0xFFFF;
+    uint32_t stride = r[0x18];
+    m_factor = r[0x14] ? static_cast<uint32_t>(r[0x14]) : 1;
+
+    // Clip the zoomed row to the line and to the preallocated buffers
+    uint32_t line_width = std::min(stride / 2, m_frame_width);
+    if (dst_x >= line_width) {
+      src_width = 0;
+    } else if (dst_x + src_width * m_factor > line_width) {
+      src_width = ((line_width - dst_x) / m_factor) & ~1u;
+    }
+    uint32_t out_width = src_width * m_factor;
+
+    for (uint32_t y = 0; y < src_height && src_width; y++) {
+      ahbread2d(videoaddr + src_x * 2 + (src_y + y) * stride,
+        &m_inrow[0],
+        src_width * 2,
+        1,
+        stride);
+
+      // replicate pixels, U and V are taken from the source pixel pair of the left pixel
+      uint32_t s0 = 0, n0 = 0, s1 = 1 / m_factor, n1 = 1 % m_factor;
+      for (uint32_t p = 0; p < out_width; p += 2) {
+        uint32_t c = (s0 & ~1u) * 2;
+        m_outrow[2 * p + 0] = m_inrow[c];
+        m_outrow[2 * p + 1] = m_inrow[s0 * 2 + 1];
+        m_outrow[2 * p + 2] = m_inrow[c + 2];
+        m_outrow[2 * p + 3] = m_inrow[s1 * 2 + 1];
+        // advance s0 = p / factor and s1 = (p + 1) / factor without dividing
+        n0 += 2;
+        while (n0 >= m_factor) { n0 -= m_factor; s0++; }
+        n1 += 2;
+        while (n1 >= m_factor) { n1 -= m_factor; s1++; }
+      }
+
+      ahbwrite2d(videoaddr + dst_x * 2 + (dst_y + y * m_factor) * stride,
+        &m_outrow[0],
+        out_width * 2,
+        1,
+        stride,
+        m_factor);
+    }
+
+    ahbsync();
+    m_busy = false;
+    m_frameToggle = !m_frameToggle;
+    triggerOut.write(m_frameToggle);
+  }
+}
+
+/// @}
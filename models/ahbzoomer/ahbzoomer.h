@@ -0,0 +1,80 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup ahbzoomer
+/// @{
+/// @file ahbzoomer.h
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_AHBZOOMER_AHBZOOMER_H_
+#define MODELS_AHBZOOMER_AHBZOOMER_H_
+
+#include <amba.h>
+#include <algorithm>
+#include <vector>
+
+#include "core/common/base.h"
+#include "models/ahbvideomaster/ahbvideomaster.h"
+#include "core/common/apbdevice.h"
+#include "core/common/apbslave.h"
+#include "core/common/clkdevice.h"
+
+#include "core/common/sr_signal.h"
+
+/// Zooms a window of the video memory by an integer factor (pixel replication).
+///
+/// Hardware replacement for AHBDemoSoftware::zoom. Each source row is read
+/// once, widened into a preallocated row buffer and written to factor
+/// destination lines in one strided transfer.
+class AHBZoomer : public AHBVideoMaster<APBSlave>, public CLKDevice {
+  public:
+    SC_HAS_PROCESS(AHBZoomer);
+    SR_HAS_SIGNALS(AHBZoomer);
+    GC_HAS_CALLBACKS();
+
+    sc_in<bool> triggerIn;
+    sc_out<bool> triggerOut;
+
+    AHBZoomer(sc_module_name name,
+    uint32_t hindex,
+    uint32_t pindex,
+    uint32_t paddr,
+    uint32_t pmask,
+    uint32_t frame_width,
+    AbstractionLayer ambaLayer = amba::amba_LT);
+
+    /// Destructor
+    ~AHBZoomer();
+
+    void init_registers();
+    void end_of_elaboration();
+
+    sc_event frameTriggerEvent;
+
+    sc_core::sc_time get_clock() {return clock_cycle; }
+
+  protected:
+    void zoom_frame();
+    void frameTrigger();
+
+    void ctrl_read();
+    void ctrl_write();
+
+    uint32_t m_frame_width;
+    uint32_t m_factor;
+
+    /// Row buffers sized for the widest possible line at construction time.
+    std::vector<uint8_t> m_inrow;
+    std::vector<uint8_t> m_outrow;
+
+    bool m_frameToggle;
+    bool m_busy;
+};
+
+#endif  // MODELS_AHBZOOMER_AHBZOOMER_H_
+/// @}
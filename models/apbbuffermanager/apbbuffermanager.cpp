@@ -0,0 +1,262 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup apbbuffermanager
+/// @{
+/// @file apbbuffermanager.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/apbbuffermanager/apbbuffermanager.h"
+#include "core/common/verbose.h"
+#include "core/common/sr_registry.h"
+
+SR_HAS_MODULE(APBBufferManager);
+
+APBBufferManager::APBBufferManager(ModuleName name,
+  uint16_t pindex,
+  uint16_t paddr,
+  uint16_t pmask,
+  uint16_t pirq,
+  uint32_t base,
+  uint32_t size,
+  uint32_t count) :
+  APBSlave(name, pindex, 0x1, 0x00E, 1, pirq, APBIO, pmask, false, false, paddr),
+  irq("irq"),
+  m_pirq(pirq),
+  m_ctrl(count ? 0x1 : 0x0),
+  m_base(base),
+  m_size(size),
+  m_count(count > MAX_BUFFERS ? MAX_BUFFERS : count),
+  m_dropped(0),
+  m_frames(0),
+  m_irq(false) {
+  init_registers();
+  reset();
+}
+
+APBBufferManager::~APBBufferManager() {
+  GC_UNREGISTER_CALLBACKS();
+}
+
+void APBBufferManager::init_registers() {
+  r.create_register("CTRL", "Buffer Manager Control Register", 0x00,
+    m_ctrl,
+    0x0F)
+  .callback(SR_POST_WRITE, this, &APBBufferManager::ctrl_write);
+  r.create_register("BASE", "Buffer Manager Pool Address", 0x04,
+    m_base,
+    0xFFFFFFFF)
+  .callback(SR_POST_WRITE, this, &APBBufferManager::pool_write);
+  r.create_register("SIZE", "Buffer Manager Buffer Size", 0x08,
+    m_size,
+    0xFFFFFFFF)
+  .callback(SR_POST_WRITE, this, &APBBufferManager::pool_write);
+  r.create_register("COUNT", "Buffer Manager Buffer Count", 0x0C,
+    m_count,
+    0xFF)
+  .callback(SR_POST_WRITE, this, &APBBufferManager::pool_write);
+  r.create_register("FREE", "Buffer Manager Free Queue", 0x10,
+    0x00,
+    0xFFFFFFFF)
+  .callback(SR_PRE_READ, this, &APBBufferManager::free_read)
+  .callback(SR_POST_WRITE, this, &APBBufferManager::free_write);
+  r.create_register("FULL", "Buffer Manager Full Queue", 0x14,
+    0x00,
+    0xFFFFFFFF)
+  .callback(SR_PRE_READ, this, &APBBufferManager::full_read)
+  .callback(SR_POST_WRITE, this, &APBBufferManager::full_write);
+  r.create_register("RELEASE", "Buffer Manager Release Register", 0x18,
+    0x00,
+    0xFFFFFFFF)
+  .callback(SR_POST_WRITE, this, &APBBufferManager::release_write);
+  r.create_register("STATUS", "Buffer Manager Status Register", 0x1C,
+    0x00,
+    0x00)
+  .callback(SR_PRE_READ, this, &APBBufferManager::status_read);
+  r.create_register("TAKE", "Buffer Manager Take Register", 0x20,
+    0x00,
+    0xFFFFFFFF)
+  .callback(SR_POST_WRITE, this, &APBBufferManager::take_write);
+}
+
+void APBBufferManager::end_of_simulation() {
+  v::info << name() << "Frames passed: " << m_frames << ", dropped: " << m_dropped << v::endl;
+}
+
+uint32_t APBBufferManager::peek_free() const {
+  if (!(m_ctrl & 0x1)) {
+    return 0;
+  }
+  if (!m_free.empty()) {
+    return address(m_free.front());
+  }
+  if ((m_ctrl & 0x8) && !m_full.empty()) {
+    return address(m_full.front());
+  }
+  return 0;
+}
+
+uint32_t APBBufferManager::peek_full() const {
+  if (!(m_ctrl & 0x1) || m_full.empty()) {
+    return 0;
+  }
+  return address(m_full.front());
+}
+
+uint32_t APBBufferManager::dequeue_free() {
+  if (!(m_ctrl & 0x1)) {
+    return 0;
+  }
+  uint32_t index;
+  if (!m_free.empty()) {
+    index = m_free.front();
+    m_free.pop_front();
+  } else if ((m_ctrl & 0x8) && !m_full.empty()) {
+    // Latest frame wins, the oldest waiting frame is overwritten
+    index = m_full.front();
+    m_full.pop_front();
+    m_dropped++;
+  } else {
+    return 0;
+  }
+  m_state[index] = BUFFER_FILLING;
+  update_irq();
+  return address(index);
+}
+
+bool APBBufferManager::enqueue_full(uint32_t addr) {
+  int index = buffer(addr);
+  if (index < 0 || m_state[index] != BUFFER_FILLING) {
+    v::warn << name() << "Enqueued buffer 0x" << std::hex << addr << std::dec
+            << " was not dequeued from the free queue" << v::endl;
+    return false;
+  }
+  m_state[index] = BUFFER_FULL;
+  m_full.push_back(index);
+  m_frames++;
+  update_irq();
+  return true;
+}
+
+uint32_t APBBufferManager::dequeue_full() {
+  if (!(m_ctrl & 0x1) || m_full.empty()) {
+    return 0;
+  }
+  uint32_t index = m_full.front();
+  m_full.pop_front();
+  m_state[index] = BUFFER_READING;
+  update_irq();
+  return address(index);
+}
+
+bool APBBufferManager::release(uint32_t addr) {
+  int index = buffer(addr);
+  if (index < 0 || m_state[index] == BUFFER_FREE || m_state[index] == BUFFER_FULL) {
+    v::warn << name() << "Released buffer 0x" << std::hex << addr << std::dec
+            << " is not in use" << v::endl;
+    return false;
+  }
+  m_state[index] = BUFFER_FREE;
+  m_free.push_back(index);
+  update_irq();
+  return true;
+}
+
+void APBBufferManager::ctrl_write() {
+  bool toggled = (r[0x00] & 0x1) != (m_ctrl & 0x1);
+  m_ctrl = r[0x00];
+  if (toggled) {
+    reset();
+  } else {
+    update_irq();
+  }
+}
+
+void APBBufferManager::pool_write() {
+  m_base = r[0x04];
+  m_size = r[0x08];
+  m_count = r[0x0C];
+  if (m_count > MAX_BUFFERS) {
+    v::warn << name() << "Only " << MAX_BUFFERS << " buffers are supported, not " << m_count << v::endl;
+    m_count = MAX_BUFFERS;
+    r[0x0C] = m_count;
+  }
+  reset();
+}
+
+void APBBufferManager::free_read() {
+  r[0x10] = peek_free();
+}
+
+void APBBufferManager::free_write() {
+  uint32_t addr = r[0x10];
+  if (!addr || addr != peek_free()) {
+    v::warn << name() << "Buffer 0x" << std::hex << addr << std::dec
+            << " is not the next free buffer" << v::endl;
+    return;
+  }
+  dequeue_free();
+}
+
+void APBBufferManager::full_read() {
+  r[0x14] = peek_full();
+}
+
+void APBBufferManager::full_write() {
+  enqueue_full(r[0x14]);
+}
+
+void APBBufferManager::release_write() {
+  release(r[0x18]);
+}
+
+void APBBufferManager::take_write() {
+  uint32_t addr = r[0x20];
+  if (!addr || addr != peek_full()) {
+    v::warn << name() << "Buffer 0x" << std::hex << addr << std::dec
+            << " is not the oldest full buffer" << v::endl;
+    return;
+  }
+  dequeue_full();
+}
+
+void APBBufferManager::status_read() {
+  uint32_t dropped = m_dropped > 0xFFFF ? 0xFFFF : m_dropped;
+  r[0x1C] = (dropped << 16) | (m_full.size() << 8) | m_free.size();
+}
+
+void APBBufferManager::reset() {
+  m_free.clear();
+  m_full.clear();
+  m_state.assign(m_count, BUFFER_FREE);
+  for (uint32_t i = 0; i < m_count; i++) {
+    m_free.push_back(i);
+  }
+  m_dropped = 0;
+  m_frames = 0;
+  update_irq();
+}
+
+int APBBufferManager::buffer(uint32_t addr) const {
+  if (!m_size || addr < m_base || (addr - m_base) % m_size) {
+    return -1;
+  }
+  uint32_t index = (addr - m_base) / m_size;
+  return index < m_count ? static_cast<int>(index) : -1;
+}
+
+void APBBufferManager::update_irq() {
+  bool level = (m_ctrl & 0x1) &&
+    (((m_ctrl & 0x2) && !m_full.empty()) || ((m_ctrl & 0x4) && !m_free.empty()));
+  if (level != m_irq) {
+    m_irq = level;
+    irq.write(std::make_pair(1 << m_pirq, level));
+  }
+}
+
+/// @}
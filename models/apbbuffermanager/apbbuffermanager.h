@@ -0,0 +1,133 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup apbbuffermanager
+/// @{
+/// @file apbbuffermanager.h
+/// Pool of frame buffers with free and full queues.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_APBBUFFERMANAGER_APBBUFFERMANAGER_H_
+#define MODELS_APBBUFFERMANAGER_APBBUFFERMANAGER_H_
+
+#include <deque>
+#include <vector>
+
+#include "core/common/systemc.h"
+#include "core/common/apbdevice.h"
+#include "core/common/apbslave.h"
+#include "core/common/sr_signal.h"
+
+/// Owns a pool of equally sized frame buffers, so that a producer and a
+/// consumer can run at their own rates instead of sharing one buffer.
+///
+/// A producer takes a buffer from the free queue, fills it and puts it on
+/// the full queue. A consumer takes the oldest full buffer and releases it
+/// to the free queue when done. No buffer is written while it is read, so
+/// frames do not tear. Buffer i lives at BASE + i * SIZE. An address of 0
+/// means the queue is empty.
+///
+/// Reading a register has no side effect, so debug reads and register
+/// dumps leave the queues alone. A buffer is dequeued by writing back the
+/// address read from FREE or FULL.
+///
+/// Registers:
+/// - 0x00 CTRL    bit 0: enable, bit 1: IRQ while full buffers wait,
+///                bit 2: IRQ while free buffers wait, bit 3: take the
+///                oldest full buffer if no buffer is free (drops a frame)
+/// - 0x04 BASE    address of the first buffer
+/// - 0x08 SIZE    bytes per buffer
+/// - 0x0C COUNT   number of buffers, at most 16
+/// - 0x10 FREE    read: next free buffer, write: dequeue it for filling
+/// - 0x14 FULL    read: oldest full buffer, write: enqueue a filled buffer
+/// - 0x18 RELEASE write: return a buffer to the free queue
+/// - 0x1C STATUS  bits 7..0: free, 15..8: full, 31..16: dropped frames
+/// - 0x20 TAKE    write: dequeue the oldest full buffer for reading
+///
+/// Enabling or disabling the manager or writing BASE, SIZE or COUNT
+/// resets the pool so that all buffers are free, and clears the counters.
+class APBBufferManager : public APBSlave {
+  public:
+    SC_HAS_PROCESS(APBBufferManager);
+    SR_HAS_SIGNALS(APBBufferManager);
+    GC_HAS_CALLBACKS();
+
+    /// Level of the interrupt selected in CTRL
+    signal<std::pair<uint32_t, bool> >::out irq;
+
+    /// The pool given here is used until software reprograms it, a count
+    /// of 0 leaves the manager disabled.
+    APBBufferManager(ModuleName name,
+      uint16_t pindex,
+      uint16_t paddr,
+      uint16_t pmask,
+      uint16_t pirq,
+      uint32_t base,
+      uint32_t size,
+      uint32_t count);
+
+    ~APBBufferManager();
+
+    void init_registers();
+
+    /// Queue operations, also available to models without going over the bus
+    uint32_t peek_free() const;
+    uint32_t peek_full() const;
+    uint32_t dequeue_free();
+    bool enqueue_full(uint32_t addr);
+    uint32_t dequeue_full();
+    bool release(uint32_t addr);
+
+    static const uint32_t MAX_BUFFERS = 16;
+
+  protected:
+    /// Where a buffer is
+    enum BufferState {
+      BUFFER_FREE,
+      BUFFER_FILLING,
+      BUFFER_FULL,
+      BUFFER_READING
+    };
+
+    void end_of_simulation();
+
+    void ctrl_write();
+    void pool_write();
+    void free_read();
+    void free_write();
+    void full_read();
+    void full_write();
+    void release_write();
+    void status_read();
+    void take_write();
+
+    /// Make all buffers free
+    void reset();
+
+    /// Buffer number of an address, -1 if it is no buffer of the pool
+    int buffer(uint32_t addr) const;
+    uint32_t address(uint32_t index) const { return m_base + index * m_size; }
+
+    /// Drive the interrupt after a queue changed
+    void update_irq();
+
+    uint16_t m_pirq;
+    uint32_t m_ctrl;
+    uint32_t m_base;
+    uint32_t m_size;
+    uint32_t m_count;
+    uint32_t m_dropped;
+    uint32_t m_frames;
+    bool m_irq;
+
+    std::deque<uint32_t> m_free;
+    std::deque<uint32_t> m_full;
+    std::vector<BufferState> m_state;
+};
+
+#endif  // MODELS_APBBUFFERMANAGER_APBBUFFERMANAGER_H_
+/// @}
@@ -0,0 +1,184 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup apbbuffermanager
+/// @{
+/// @file apbbuffermanager_queues.cpp
+/// Buffers through the free and full queues, overwrite mode, resets and IRQ.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include <amba.h>
+#include <tlm.h>
+
+#include "core/common/systemc.h"
+#include "core/common/verbose.h"
+#include "core/common/sr_signal.h"
+#include "models/apbbuffermanager/apbbuffermanager.h"
+
+/// Register access without an APB bus
+class TestBufferManager : public APBBufferManager {
+  public:
+    static const uint32_t BASE = 0x40000000;
+    static const uint32_t SIZE = 0x1000;
+    static const uint32_t PIRQ = 4;
+
+    explicit TestBufferManager(sc_core::sc_module_name name) :
+      APBBufferManager(name, 0, 0, 0xFFF, PIRQ, BASE, SIZE, 3) {}
+
+    void write(uint32_t offset, uint32_t value) {
+      r[offset] = value;
+      switch (offset) {
+        case 0x00: ctrl_write(); break;
+        case 0x04:
+        case 0x08:
+        case 0x0C: pool_write(); break;
+        case 0x10: free_write(); break;
+        case 0x14: full_write(); break;
+        case 0x18: release_write(); break;
+        case 0x20: take_write(); break;
+        default: break;
+      }
+    }
+
+    uint32_t read(uint32_t offset) {
+      switch (offset) {
+        case 0x10: free_read(); break;
+        case 0x14: full_read(); break;
+        case 0x1C: status_read(); break;
+        default: break;
+      }
+      return r[offset];
+    }
+};
+
+/// Walks buffers through the queues and checks the registers and the IRQ
+class Testbench : public sc_core::sc_module {
+  public:
+    SC_HAS_PROCESS(Testbench);
+    SR_HAS_SIGNALS(Testbench);
+
+    signal<std::pair<uint32_t, bool> >::in irq;
+    amba::amba_master_socket<32> apb;
+
+    Testbench(sc_core::sc_module_name name, TestBufferManager &manager) :
+      sc_core::sc_module(name),
+      irq(&Testbench::irq_in, "irq"),
+      apb("apb", amba::amba_APB, amba::amba_LT, false),
+      m_failures(0),
+      m_irq(false),
+      m_manager(manager) {
+      SC_THREAD(run);
+    }
+
+    uint32_t failures() const { return m_failures; }
+
+  private:
+    void irq_in(const std::pair<uint32_t, bool> &value, const sc_core::sc_time &delay) {
+      check(value.first == (1u << TestBufferManager::PIRQ), "IRQ line");
+      m_irq = value.second;
+    }
+
+    void check(bool ok, const char *what) {
+      if (!ok) {
+        v::error << name() << "Failed: " << what << v::endl;
+        m_failures++;
+      }
+    }
+
+    /// Fill a buffer like a producer does
+    void produce(uint32_t addr) {
+      check(m_manager.dequeue_free() == addr, "dequeue free");
+      check(m_manager.enqueue_full(addr), "enqueue full");
+    }
+
+    void run() {
+      const uint32_t b0 = TestBufferManager::BASE;
+      const uint32_t b1 = b0 + TestBufferManager::SIZE;
+      const uint32_t b2 = b1 + TestBufferManager::SIZE;
+
+      // reads have no side effect
+      check(m_manager.read(0x10) == b0, "first free buffer");
+      check(m_manager.read(0x10) == b0, "free read twice");
+      check(m_manager.read(0x14) == 0, "no full buffer");
+      check(m_manager.read(0x1C) == 3, "three free");
+
+      // dequeue by writing back the address read
+      m_manager.write(0x10, b0);
+      m_manager.write(0x10, b0);
+      check(m_manager.read(0x10) == b1, "b0 dequeued once");
+      m_manager.write(0x14, b0);
+      m_manager.write(0x14, b0);
+      check(m_manager.read(0x1C) == ((1 << 8) | 2), "b0 full once");
+      check(!m_manager.enqueue_full(b1), "enqueue needs a dequeue first");
+
+      // IRQ while full buffers wait
+      m_manager.write(0x00, 0x3);
+      check(m_irq, "IRQ with a full buffer");
+      m_manager.write(0x20, b1);
+      check(m_manager.read(0x14) == b0, "take needs the oldest full buffer");
+      m_manager.write(0x20, b0);
+      check(!m_irq, "IRQ drops with the last full buffer");
+      check(!m_manager.enqueue_full(b0), "a buffer in reading cannot be enqueued");
+      m_manager.write(0x18, b0);
+      check(m_manager.read(0x1C) == 3, "b0 released");
+
+      // full queue in order, the free queue in release order
+      produce(b1);
+      produce(b2);
+      produce(b0);
+      check(m_manager.peek_full() == b1, "oldest full buffer");
+      check(m_manager.peek_free() == 0, "no free buffer");
+      check(m_manager.dequeue_free() == 0, "nothing to dequeue");
+      check(!m_manager.release(b2), "a full buffer cannot be released");
+      check(!m_manager.release(b0 + TestBufferManager::SIZE / 2), "release between buffers");
+      check(!m_manager.release(b0 + 3 * TestBufferManager::SIZE), "release behind the pool");
+
+      // overwrite mode drops the oldest frame
+      m_manager.write(0x00, 0x9);
+      check(m_manager.read(0x10) == b1, "overwrite offers the oldest full buffer");
+      check(m_manager.dequeue_free() == b1, "overwrite dequeues it");
+      check(m_manager.read(0x1C) == ((1 << 16) | (2 << 8)), "one frame dropped");
+      check(m_manager.dequeue_full() == b2, "next full buffer");
+      check(m_manager.release(b2), "release after reading");
+      check(m_manager.release(b1), "release after filling");
+      check(m_manager.read(0x10) == b2, "released buffers are free in order");
+
+      // writing the pool resets it, at most 16 buffers
+      m_manager.write(0x0C, 2);
+      check(m_manager.read(0x1C) == 2, "reset to two free buffers");
+      check(m_manager.read(0x10) == b0, "reset starts with the first buffer");
+      m_manager.write(0x0C, 20);
+      check(m_manager.read(0x0C) == APBBufferManager::MAX_BUFFERS, "count clamped");
+      check(m_manager.read(0x1C) == APBBufferManager::MAX_BUFFERS, "sixteen free buffers");
+
+      // disabled, the queues are empty to software
+      m_manager.write(0x00, 0x0);
+      check(m_manager.read(0x10) == 0, "disabled free queue");
+      check(m_manager.dequeue_free() == 0, "disabled dequeue");
+      sc_core::sc_stop();
+    }
+
+    uint32_t m_failures;
+    bool m_irq;
+    TestBufferManager &m_manager;
+};
+
+int sc_main(int argc, char *argv[]) {
+  TestBufferManager manager("buffermanager");
+  Testbench tb("tb", manager);
+  tb.apb(manager.apb);
+  sr_signal::connect(manager.irq, tb.irq);
+
+  sc_core::sc_start();
+
+  if (tb.failures()) {
+    v::error << "apbbuffermanager_queues" << tb.failures() << " checks failed" << v::endl;
+    return 1;
+  }
+  return 0;
+}
+/// @}
@@ -13,6 +13,7 @@
 ///
 
 #include "models/apbkeyboard/apbkeyboard.h"
+#include "models/processprofiler/processprofiler.h"
 #include "core/common/sr_registry.h"
 #include <string>
 
@@ -24,8 +25,15 @@ APBKeyboard::APBKeyboard(ModuleName name,
   uint16_t pindex,
   uint16_t paddr,
   uint16_t pmask,
-  uint16_t pirq) :
-  APBSlave(name, pindex, 0x1, 0x00C, 1, pirq, APBIO, pmask, false, false, paddr){
+  uint16_t pirq,
+  uint32_t depth) :
+  APBSlave(name, pindex, 0x1, 0x00C, 1, pirq, APBIO, pmask, false, false, paddr),
+  irq("irq"),
+  lastkey(0),
+  m_depth(depth ? depth : 1),
+  m_pirq(pirq),
+  m_overflow(false),
+  m_irq(false) {
   SC_THREAD(update_key);
   SC_METHOD(get_key);
   sensitive << keyboardIn;
@@ -45,17 +53,100 @@ void APBKeyboard::init_registers() {
     0,        // offset
     0x00,     // init value
     0xFF);    // write mask
+  r.create_register("ctrl", "Keyboard Control Register",
+    0x04,     // offset
+    0x00,     // init value
+    0x03)     // write mask
+  .callback(SR_POST_WRITE, this, &APBKeyboard::ctrl_write);
+  r.create_register("status", "Keyboard Status Register",
+    0x08,     // offset
+    0x00,     // init value
+    0x04)     // write mask
+  .callback(SR_PRE_READ, this, &APBKeyboard::status_read)
+  .callback(SR_POST_WRITE, this, &APBKeyboard::status_write);
+  r.create_register("count", "Keyboard Event Count Register",
+    0x0C,     // offset
+    0x00,     // init value
+    0x00)     // write mask
+  .callback(SR_PRE_READ, this, &APBKeyboard::count_read);
+  r.create_register("event", "Keyboard Event Register",
+    0x10,     // offset
+    0x00,     // init value
+    0x00)     // write mask
+  .callback(SR_PRE_READ, this, &APBKeyboard::event_read);
+}
+
+void APBKeyboard::ctrl_write() {
+  if (r[0x4] & 0x2) {
+    m_fifo.clear();
+    r[0x4] = r[0x4] & 0x1;
+  }
+  update_irq();
+}
+
+void APBKeyboard::status_read() {
+  r[0x8] = (m_overflow << 2) | ((m_fifo.size() >= m_depth) << 1) | !m_fifo.empty();
+}
+
+void APBKeyboard::status_write() {
+  if (r[0x8] & 0x4) {
+    m_overflow = false;
+  }
+}
+
+void APBKeyboard::count_read() {
+  r[0xC] = ((m_depth > 0xFFFF ? 0xFFFF : m_depth) << 16) | m_fifo.size();
+}
+
+void APBKeyboard::event_read() {
+  if (m_fifo.empty()) {
+    r[0x10] = 0;
+    return;
+  }
+  r[0x10] = m_fifo.front();
+  m_fifo.pop_front();
+  update_irq();
+}
+
+void APBKeyboard::push(uint32_t event) {
+  if (m_fifo.size() >= m_depth) {
+    m_overflow = true;
+    return;
+  }
+  m_fifo.push_back(event);
+}
+
+void APBKeyboard::update_irq() {
+  bool level = (r[0x4] & 0x1) && !m_fifo.empty();
+  if (level != m_irq) {
+    m_irq = level;
+    irq.write(std::make_pair(1 << m_pirq, level));
+  }
 }
 
 void APBKeyboard::get_key() {
-  lastkey = keyboardIn.read();
+  PROFILE_PROCESS();
+  uint8_t key = keyboardIn.read();
+  uint8_t last = lastkey;
+  // 0 and 1 mean no key is held
+  if (key != last) {
+    if (last > 1) {
+      push(last | 0x100);
+    }
+    if (key > 1) {
+      push(key);
+    }
+    update_irq();
+  }
+  lastkey = key;
   r[0x0] = lastkey;
   keyReceived.notify();
 }
 
 void APBKeyboard::update_key() {
+  PROFILE_PROCESS();
   while(1) {
-    wait(keyReceived);
+    ProcessProfiler::wait(keyReceived);
     v::info << name() << "got key: " << r[0x0] << v::endl;
   }
 }
@@ -13,6 +13,8 @@
 ///
 
 #ifndef MODELS_APBKEYBOARD_APBKEYBOARD_H_
+#include <deque>
+
 #include "core/common/systemc.h"
 #include "core/common/apbdevice.h"
 #include "core/common/clkdevice.h"
@@ -21,6 +23,19 @@
 #include "core/common/apbslave.h"
 
 /// @brief This class is a TLM 2.0 Model of a very basic Keyboard.
+///
+/// keyboardIn carries the held key, 1 or 0 when none is held. Every change
+/// is queued as key events in a FIFO of depth entries, so software takes
+/// each press and release once instead of polling the held key.
+///
+/// Registers:
+/// - 0x00 DATA   held key
+/// - 0x04 CTRL   bit 0: IRQ while events wait, bit 1: flush the FIFO
+/// - 0x08 STATUS bit 0: not empty, bit 1: full, bit 2: events were lost
+///               (write 1 to clear)
+/// - 0x0C COUNT  bits 15..0: events waiting, bits 31..16: depth
+/// - 0x10 EVENT  read: oldest event, bits 7..0: key, bit 8: released.
+///               0 if the FIFO is empty.
 class APBKeyboard : public APBSlave, public CLKDevice {
   public:
     SC_HAS_PROCESS(APBKeyboard);
@@ -30,8 +45,12 @@ class APBKeyboard : public APBSlave, public CLKDevice {
     sc_in<char> keyboardIn;
     sc_event keyReceived;
 
+    /// Level of the interrupt, high while events wait and it is enabled
+    signal<std::pair<uint32_t, bool> >::out irq;
+
     APBKeyboard(ModuleName name, uint16_t pindex = 0,
-    uint16_t paddr = 0, uint16_t pmask = 4095, uint16_t pirq = 0
+    uint16_t paddr = 0, uint16_t pmask = 4095, uint16_t pirq = 0,
+    uint32_t depth = 16
     );
 
     /// Free all counter and unregister all callbacks.
@@ -39,7 +58,11 @@ class APBKeyboard : public APBSlave, public CLKDevice {
     void init_registers();
 
     // Register Callbacks
-    //TODO needed?
+    void ctrl_write();
+    void status_read();
+    void status_write();
+    void count_read();
+    void event_read();
 
     // SCTHREADS
     void update_key();
@@ -47,6 +70,19 @@ class APBKeyboard : public APBSlave, public CLKDevice {
     void get_key();
 
     char lastkey;
+
+  private:
+    /// Queue an event, dropped if the FIFO is full
+    void push(uint32_t event);
+
+    /// Drive the interrupt after the FIFO or CTRL changed
+    void update_irq();
+
+    std::deque<uint32_t> m_fifo;
+    uint32_t m_depth;
+    uint16_t m_pirq;
+    bool m_overflow;
+    bool m_irq;
 };
 
 #endif  // MODELS_APBUART_APBUART_H_
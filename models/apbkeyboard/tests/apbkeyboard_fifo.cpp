@@ -0,0 +1,161 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup apbkeyboard
+/// @{
+/// @file apbkeyboard_fifo.cpp
+/// Key events through the FIFO, its overflow, flush and the IRQ level.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include <amba.h>
+#include <tlm.h>
+
+#include "core/common/systemc.h"
+#include "core/common/verbose.h"
+#include "core/common/sr_signal.h"
+#include "models/apbkeyboard/apbkeyboard.h"
+
+/// Register access without an APB bus
+class TestKeyboard : public APBKeyboard {
+  public:
+    static const uint32_t DEPTH = 4;
+    static const uint32_t PIRQ = 3;
+
+    explicit TestKeyboard(sc_core::sc_module_name name) :
+      APBKeyboard(name, 0, 0, 0xFFF, PIRQ, DEPTH) {}
+
+    void write(uint32_t offset, uint32_t value) {
+      r[offset] = value;
+      if (offset == 0x4) {
+        ctrl_write();
+      } else if (offset == 0x8) {
+        status_write();
+      }
+    }
+
+    uint32_t read(uint32_t offset) {
+      if (offset == 0x8) {
+        status_read();
+      } else if (offset == 0xC) {
+        count_read();
+      } else if (offset == 0x10) {
+        event_read();
+      }
+      return r[offset];
+    }
+};
+
+/// Presses keys and checks the registers and the IRQ after each step
+class Testbench : public sc_core::sc_module {
+  public:
+    SC_HAS_PROCESS(Testbench);
+    SR_HAS_SIGNALS(Testbench);
+
+    signal<std::pair<uint32_t, bool> >::in irq;
+    sc_core::sc_out<char> keyOut;
+    amba::amba_master_socket<32> apb;
+
+    Testbench(sc_core::sc_module_name name, TestKeyboard &keyboard) :
+      sc_core::sc_module(name),
+      irq(&Testbench::irq_in, "irq"),
+      keyOut("keyOut"),
+      apb("apb", amba::amba_APB, amba::amba_LT, false),
+      m_failures(0),
+      m_irq(false),
+      m_keyboard(keyboard) {
+      SC_THREAD(run);
+    }
+
+    uint32_t failures() const { return m_failures; }
+
+  private:
+    void irq_in(const std::pair<uint32_t, bool> &value, const sc_core::sc_time &delay) {
+      check(value.first == (1u << TestKeyboard::PIRQ), "IRQ line");
+      m_irq = value.second;
+    }
+
+    void check(bool ok, const char *what) {
+      if (!ok) {
+        v::error << name() << "Failed: " << what << v::endl;
+        m_failures++;
+      }
+    }
+
+    void key(char value) {
+      keyOut.write(value);
+      wait(1, sc_core::SC_NS);
+    }
+
+    void run() {
+      const uint32_t depth = TestKeyboard::DEPTH << 16;
+      m_keyboard.write(0x4, 0x1);
+      check(!m_irq, "no IRQ while the FIFO is empty");
+
+      // a press and its release
+      key('a');
+      check(m_irq, "IRQ with a waiting event");
+      key(0);
+      check(m_keyboard.read(0x0) == 0, "held key after the release");
+      check(m_keyboard.read(0xC) == (depth | 2), "two events waiting");
+      check(m_keyboard.read(0x8) == 0x1, "not empty");
+      check(m_keyboard.read(0x10) == 'a', "press event");
+      check(m_irq, "IRQ while an event waits");
+      check(m_keyboard.read(0x10) == ('a' | 0x100), "release event");
+      check(!m_irq, "IRQ drops with the last event");
+      check(m_keyboard.read(0x10) == 0, "empty FIFO reads 0");
+      check(m_keyboard.read(0x8) == 0x0, "empty");
+
+      // b, release b, c, release c, d: five events for four entries
+      key('b');
+      key('c');
+      key('d');
+      check(m_keyboard.read(0x0) == 'd', "held key");
+      check(m_keyboard.read(0xC) == (depth | 4), "FIFO full");
+      check(m_keyboard.read(0x8) == 0x7, "not empty, full and overflow");
+      m_keyboard.write(0x8, 0x4);
+      check(m_keyboard.read(0x8) == 0x3, "overflow cleared");
+      check(m_keyboard.read(0x10) == 'b', "oldest event kept");
+
+      // flush
+      m_keyboard.write(0x4, 0x3);
+      check(m_keyboard.read(0xC) == depth, "flushed");
+      check(m_keyboard.read(0x4) == 0x1, "flush bit clears");
+      check(!m_irq, "no IRQ after the flush");
+
+      // events wait without IRQ until it is enabled
+      m_keyboard.write(0x4, 0x0);
+      key(0);
+      check(m_keyboard.read(0xC) == (depth | 1), "release of d");
+      check(!m_irq, "IRQ disabled");
+      m_keyboard.write(0x4, 0x1);
+      check(m_irq, "IRQ once enabled");
+      sc_core::sc_stop();
+    }
+
+    uint32_t m_failures;
+    bool m_irq;
+    TestKeyboard &m_keyboard;
+};
+
+int sc_main(int argc, char *argv[]) {
+  sc_core::sc_signal<char> keySignal;
+  TestKeyboard keyboard("keyboard");
+  Testbench tb("tb", keyboard);
+  tb.keyOut(keySignal);
+  keyboard.keyboardIn(keySignal);
+  tb.apb(keyboard.apb);
+  sr_signal::connect(keyboard.irq, tb.irq);
+
+  sc_core::sc_start();
+
+  if (tb.failures()) {
+    v::error << "apbkeyboard_fifo" << tb.failures() << " checks failed" << v::endl;
+    return 1;
+  }
+  return 0;
+}
+/// @}
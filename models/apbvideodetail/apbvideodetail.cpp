@@ -0,0 +1,110 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup apbvideodetail
+/// @{
+/// @file apbvideodetail.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/apbvideodetail/apbvideodetail.h"
+#include "core/common/verbose.h"
+#include "core/common/sr_registry.h"
+
+SR_HAS_MODULE(APBVideoDetail);
+
+APBVideoDetail::APBVideoDetail(ModuleName name,
+  uint16_t pindex,
+  uint16_t paddr,
+  uint16_t pmask,
+  sc_core::sc_time detail_at,
+  uint32_t detail_frame,
+  uint32_t detail_frames) :
+  APBSlave(name, pindex, 0x1, 0x00D, 1, 0, APBIO, pmask, false, false, paddr),
+  m_detail_at(detail_at),
+  m_detail_frame(detail_frame),
+  m_detail_frames(detail_frames),
+  m_frames(0),
+  m_detail_start(0),
+  m_detailed(false) {
+  SC_THREAD(schedule);
+
+  SC_METHOD(count_frame);
+  sensitive << frameIn;
+  dont_initialize();
+
+  init_registers();
+}
+
+APBVideoDetail::~APBVideoDetail() {
+  GC_UNREGISTER_CALLBACKS();
+}
+
+void APBVideoDetail::init_registers() {
+  r.create_register("CTRL", "Video Detail Control Register", 0x00,
+    0x00,
+    0x01)
+  .callback(SR_PRE_READ, this, &APBVideoDetail::ctrl_read)
+  .callback(SR_POST_WRITE, this, &APBVideoDetail::ctrl_write);
+  r.create_register("FRAMES", "Video Detail Frame Counter", 0x04,
+    0x00,
+    0x00)
+  .callback(SR_PRE_READ, this, &APBVideoDetail::frames_read);
+}
+
+// Fast video transfers until a scheduled detailed window starts
+void APBVideoDetail::start_of_simulation() {
+  if (m_detail_at != sc_core::SC_ZERO_TIME || m_detail_frame) {
+    ahbvideo_fidelity() = AHBVIDEO_FAST;
+    v::info << name() << "Fast video transfers until the detailed window" << v::endl;
+  }
+}
+
+void APBVideoDetail::schedule() {
+  if (m_detail_at == sc_core::SC_ZERO_TIME) {
+    return;
+  }
+  wait(m_detail_at);
+  detail(true);
+}
+
+void APBVideoDetail::count_frame() {
+  m_frames++;
+  if (m_detail_frame && m_frames == m_detail_frame) {
+    detail(true);
+  } else if (m_detailed && m_detail_frames && m_frames - m_detail_start == m_detail_frames) {
+    detail(false);
+  }
+}
+
+void APBVideoDetail::ctrl_read() {
+  r[0x00] = m_detailed ? 0x1 : 0x0;
+}
+
+void APBVideoDetail::ctrl_write() {
+  detail(r[0x00] & 0x1);
+}
+
+void APBVideoDetail::frames_read() {
+  r[0x04] = m_frames;
+}
+
+void APBVideoDetail::detail(bool detailed) {
+  AHBVideoFidelity fidelity = detailed ? AHBVIDEO_DETAILED : AHBVIDEO_FAST;
+  if (detailed) {
+    m_detail_start = m_frames;
+  }
+  m_detailed = detailed;
+  if (ahbvideo_fidelity() == fidelity) {
+    return;
+  }
+  ahbvideo_fidelity() = fidelity;
+  v::info << name() << (detailed ? "Detailed" : "Fast") << " video transfers from frame " << m_frames
+          << " at " << sc_core::sc_time_stamp() << v::endl;
+}
+
+/// @}
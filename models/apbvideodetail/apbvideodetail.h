@@ -0,0 +1,84 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup apbvideodetail
+/// @{
+/// @file apbvideodetail.h
+/// Runtime switching between fast and detailed video transfers.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_APBVIDEODETAIL_APBVIDEODETAIL_H_
+#define MODELS_APBVIDEODETAIL_APBVIDEODETAIL_H_
+
+#include "core/common/systemc.h"
+#include "core/common/apbdevice.h"
+#include "core/common/apbslave.h"
+#include "core/common/sr_signal.h"
+#include "models/ahbvideomaster/ahbvideomaster.h"
+
+/// Switches the fidelity of all AHBVideoMasters at runtime, so the video
+/// traffic runs with fast transfers and is modelled in detail only for a
+/// window of frames.
+///
+/// The detailed window starts at a simulated time, after a number of
+/// frames or when software writes CTRL. It lasts a number of frames or
+/// until the end of simulation. With neither time nor frame configured the
+/// masters keep their native fidelity until CTRL is written.
+///
+/// This is not a fast-forward of the platform. Only the video masters are
+/// affected, the LEON3, the AHBCtrl, the MCtrl and the memories stay in the
+/// layer chosen at elaboration, so booting and loading in AT still run in
+/// AT. Boot in LT and restore a checkpoint to skip those.
+///
+/// Registers:
+/// - 0x00 CTRL   bit 0: detailed transfers (read/write)
+/// - 0x04 FRAMES frames counted on frameIn (read only)
+class APBVideoDetail : public APBSlave {
+  public:
+    SC_HAS_PROCESS(APBVideoDetail);
+    SR_HAS_SIGNALS(APBVideoDetail);
+    GC_HAS_CALLBACKS();
+
+    /// Frame signal the frame counts refer to, may stay unbound
+    sc_core::sc_port<sc_core::sc_signal_in_if<bool>, 1, sc_core::SC_ZERO_OR_MORE_BOUND> frameIn;
+
+    /// A detail_at of SC_ZERO_TIME or detail_frame of 0 disables that
+    /// trigger, detail_frames of 0 keeps the detailed fidelity to the end.
+    APBVideoDetail(ModuleName name,
+      uint16_t pindex,
+      uint16_t paddr,
+      uint16_t pmask,
+      sc_core::sc_time detail_at,
+      uint32_t detail_frame,
+      uint32_t detail_frames);
+
+    ~APBVideoDetail();
+
+    void init_registers();
+
+  private:
+    void start_of_simulation();
+    void schedule();
+    void count_frame();
+
+    void ctrl_read();
+    void ctrl_write();
+    void frames_read();
+
+    /// Switch all video masters and log the switch
+    void detail(bool detailed);
+
+    sc_core::sc_time m_detail_at;
+    uint32_t m_detail_frame;
+    uint32_t m_detail_frames;
+    uint32_t m_frames;
+    uint32_t m_detail_start;
+    bool m_detailed;
+};
+
+#endif  // MODELS_APBVIDEODETAIL_APBVIDEODETAIL_H_
+/// @}
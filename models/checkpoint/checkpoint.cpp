@@ -0,0 +1,370 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup checkpoint
+/// @{
+/// @file checkpoint.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/checkpoint/checkpoint.h"
+#include "core/common/verbose.h"
+#include "core/common/sr_registry.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+
+SR_HAS_MODULE(Checkpoint);
+
+// Sections of a checkpoint file: type, name, start, size and payload.
+// Memory payloads are the non-zero pages, each with its offset in front.
+struct CheckpointSection {
+  char type;
+  uint8_t reserved[3];
+  uint32_t name_length;
+  uint32_t start;
+  uint32_t size;
+  uint32_t count;
+};
+
+static bool checkpoint_write(FILE *file, const void *data, size_t length) {
+  return fwrite(data, 1, length, file) == length;
+}
+
+static bool checkpoint_read(FILE *file, void *data, size_t length) {
+  return fread(data, 1, length, file) == length;
+}
+
+// Longest section name and processor state accepted from a file
+#define CHECKPOINT_MAX_NAME 256
+#define CHECKPOINT_MAX_STATE 65536
+
+// True if no host page behind a DMI pointer in [data, data + length) was
+// ever written. Such pages are neither in memory nor swapped out and hold
+// zeros. mincore() cannot tell them from swapped pages, so the flags of
+// /proc/self/pagemap are used. Without it every page counts as written.
+static bool checkpoint_untouched(const uint8_t *data, uint32_t length) {
+  static int pagemap = open("/proc/self/pagemap", O_RDONLY);
+  if (pagemap < 0) {
+    return false;
+  }
+  uintptr_t host_page = sysconf(_SC_PAGESIZE);
+  uintptr_t first = reinterpret_cast<uintptr_t>(data) / host_page;
+  uintptr_t last = (reinterpret_cast<uintptr_t>(data) + length - 1) / host_page;
+  std::vector<uint64_t> entries(last - first + 1);
+  size_t bytes = entries.size() * sizeof(uint64_t);
+  if (pread(pagemap, &entries[0], bytes, first * sizeof(uint64_t)) != static_cast<ssize_t>(bytes)) {
+    return false;
+  }
+  for (size_t i = 0; i < entries.size(); i++) {
+    // bit 63: present, bit 62: swapped
+    if (entries[i] >> 62) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Checkpoint::Checkpoint(ModuleName name,
+  uint32_t hindex,
+  uint32_t pindex,
+  uint32_t paddr,
+  uint32_t pmask,
+  const std::string &save_file,
+  const std::string &restore_file,
+  sc_core::sc_time save_at,
+  AbstractionLayer ambaLayer) :
+  AHBMaster<APBSlave>(name,
+    hindex,
+    0x03,
+    0x00A,
+    0,
+    0,
+    ambaLayer,
+    BAR(), BAR(), BAR(), BAR()),
+  m_save_file(save_file),
+  m_restore_file(restore_file),
+  m_save_at(save_at),
+  m_saved(false),
+  m_restored(false) {
+  init_apb(pindex, 0x03, 0x00A, 0, 0, APBIO, pmask, 0, 0, paddr);
+  init_registers();
+  SC_THREAD(schedule);
+}
+
+Checkpoint::~Checkpoint() {
+  for (size_t i = 0; i < m_states.size(); i++) {
+    delete m_states[i];
+  }
+  GC_UNREGISTER_CALLBACKS();
+}
+
+void Checkpoint::init_registers() {
+  r.create_register("CTRL", "Checkpoint Control Register", 0x00,
+    0x00,
+    0x01)
+  .callback(SR_PRE_READ, this, &Checkpoint::ctrl_read)
+  .callback(SR_POST_WRITE, this, &Checkpoint::ctrl_write);
+}
+
+void Checkpoint::add_memory(const std::string &name, uint32_t start, uint32_t size) {
+  Region region = { 'M', name, start, size };
+  m_regions.push_back(region);
+}
+
+void Checkpoint::add_registers(const std::string &name, uint32_t base, uint32_t size) {
+  Region region = { 'R', name, base, size & ~3u };
+  m_regions.push_back(region);
+}
+
+void Checkpoint::add_state(CheckpointState *state) {
+  m_states.push_back(state);
+}
+
+void Checkpoint::ctrl_read() {
+  r[0x00] = m_restored ? 0x1 : 0x0;
+}
+
+void Checkpoint::ctrl_write() {
+  // A restored run resumes right at the request, it must not save again
+  if ((r[0x00] & 0x1) && !m_restored && !m_saved) {
+    save();
+  }
+}
+
+// Restores at time 0 and saves at m_save_at. Restoring in a process makes
+// sure the bus decoders are set up.
+void Checkpoint::schedule() {
+  if (!m_restore_file.empty()) {
+    m_restored = restore();
+    // A partly restored platform must not run as if it had booted
+    if (!m_restored) {
+      v::error << name() << "Restore failed, stopping the simulation" << v::endl;
+      sc_core::sc_stop();
+      return;
+    }
+  }
+  restored.notify(sc_core::SC_ZERO_TIME);
+  if (m_save_at == sc_core::SC_ZERO_TIME || m_save_file.empty()) {
+    return;
+  }
+  wait(m_save_at);
+  if (!m_saved) {
+    save();
+  }
+}
+
+bool Checkpoint::save() {
+  if (m_save_file.empty()) {
+    return false;
+  }
+  FILE *file = fopen(m_save_file.c_str(), "wb");
+  if (!file) {
+    v::error << name() << "Cannot write checkpoint " << m_save_file << v::endl;
+    return false;
+  }
+  uint32_t version = CHECKPOINT_VERSION;
+  uint64_t time_ps = sc_core::sc_time_stamp().to_seconds() * 1e12 + 0.5;
+  bool ok = checkpoint_write(file, CHECKPOINT_MAGIC, 8) &&
+            checkpoint_write(file, &version, sizeof(version)) &&
+            checkpoint_write(file, &time_ps, sizeof(time_ps));
+
+  std::vector<uint8_t> page(CHECKPOINT_PAGE);
+  static const uint8_t zero[CHECKPOINT_PAGE] = { 0 };
+  uint64_t stored = 0;
+  for (size_t i = 0; ok && i < m_regions.size(); i++) {
+    const Region &region = m_regions[i];
+    CheckpointSection section = { region.type, { 0, 0, 0 },
+      static_cast<uint32_t>(region.name.size()), region.start, region.size, 0 };
+    long position = ftell(file);
+    ok = checkpoint_write(file, &section, sizeof(section)) &&
+         checkpoint_write(file, region.name.data(), region.name.size());
+    if (region.type == 'R') {
+      page.resize(std::max<size_t>(region.size, CHECKPOINT_PAGE));
+      ahbread_dbg(region.start, &page[0], region.size);
+      ok = ok && checkpoint_write(file, &page[0], region.size);
+      continue;
+    }
+    // Pages are taken through DMI where the memory grants it, so pages
+    // the host never backed are skipped without reading them. Swapped
+    // out pages are read back like resident ones.
+    tlm::tlm_dmi dmi;
+    bool direct = false;
+    bool warned = false;
+    for (uint32_t offset = 0; ok && offset < region.size; offset += CHECKPOINT_PAGE) {
+      uint32_t addr = region.start + offset;
+      uint32_t length = std::min<uint32_t>(CHECKPOINT_PAGE, region.size - offset);
+      if (!direct || addr < dmi.get_start_address() || addr + length - 1 > dmi.get_end_address()) {
+        direct = dmi_page(addr, length, dmi);
+      }
+      const uint8_t *data = &page[0];
+      if (direct) {
+        data = dmi.get_dmi_ptr() + (addr - dmi.get_start_address());
+        if (checkpoint_untouched(data, length)) {
+          continue;
+        }
+      } else {
+        if (!warned) {
+          v::warn << name() << region.name << " grants no DMI, its pages are read from " << v::uint32 << addr
+                  << " on. A storage with DMI (e.g. LazyStorage) saves faster." << v::endl;
+          warned = true;
+        }
+        ahbread_dbg(addr, &page[0], length);
+      }
+      if (memcmp(data, zero, length) == 0) {
+        continue;
+      }
+      ok = checkpoint_write(file, &offset, sizeof(offset)) && checkpoint_write(file, data, length);
+      section.count++;
+      stored += length;
+    }
+    // Patch the page count into the section header
+    long end = ftell(file);
+    ok = ok && fseek(file, position, SEEK_SET) == 0 && checkpoint_write(file, &section, sizeof(section)) &&
+         fseek(file, end, SEEK_SET) == 0;
+  }
+
+  for (size_t i = 0; ok && i < m_states.size(); i++) {
+    std::vector<uint32_t> state;
+    m_states[i]->save(state);
+    std::string state_name = m_states[i]->name();
+    CheckpointSection section = { 'C', { 0, 0, 0 },
+      static_cast<uint32_t>(state_name.size()), 0, 0, static_cast<uint32_t>(state.size()) };
+    ok = checkpoint_write(file, &section, sizeof(section)) &&
+         checkpoint_write(file, state_name.data(), state_name.size()) &&
+         (state.empty() || checkpoint_write(file, &state[0], state.size() * sizeof(uint32_t)));
+  }
+  ok = (fclose(file) == 0) && ok;
+  if (!ok) {
+    v::error << name() << "Writing checkpoint " << m_save_file << " failed" << v::endl;
+    return false;
+  }
+  m_saved = true;
+  v::info << name() << "Saved checkpoint " << m_save_file << " at " << sc_core::sc_time_stamp()
+          << ", " << stored / 1024 << " KiB of memory" << v::endl;
+  return true;
+}
+
+bool Checkpoint::dmi_page(uint32_t addr, uint32_t length, tlm::tlm_dmi &dmi) {
+  tlm::tlm_generic_payload trans;
+  trans.set_command(tlm::TLM_READ_COMMAND);
+  trans.set_address(addr);
+  trans.set_data_length(length);
+  dmi.init();
+  return ahb->get_direct_mem_ptr(trans, dmi) && dmi.is_read_allowed() && dmi.get_dmi_ptr() &&
+         dmi.get_start_address() <= addr && dmi.get_end_address() >= addr + length - 1;
+}
+
+const Checkpoint::Region *Checkpoint::region(char type, const std::string &name, uint32_t start, uint32_t size) const {
+  for (size_t i = 0; i < m_regions.size(); i++) {
+    const Region &region = m_regions[i];
+    if (region.type == type && region.name == name && region.start == start && region.size == size) {
+      return &region;
+    }
+  }
+  return NULL;
+}
+
+bool Checkpoint::restore() {
+  FILE *file = fopen(m_restore_file.c_str(), "rb");
+  if (!file) {
+    v::error << name() << "Cannot read checkpoint " << m_restore_file << v::endl;
+    return false;
+  }
+  char magic[8];
+  uint32_t version = 0;
+  uint64_t time_ps = 0;
+  if (!checkpoint_read(file, magic, sizeof(magic)) || memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 ||
+      !checkpoint_read(file, &version, sizeof(version)) || version != CHECKPOINT_VERSION ||
+      !checkpoint_read(file, &time_ps, sizeof(time_ps))) {
+    v::error << name() << m_restore_file << " is no checkpoint of version " << CHECKPOINT_VERSION << v::endl;
+    fclose(file);
+    return false;
+  }
+
+  std::vector<uint8_t> data(CHECKPOINT_PAGE);
+  CheckpointSection section;
+  bool ok = true;
+  while (ok && checkpoint_read(file, &section, sizeof(section))) {
+    if (section.name_length > CHECKPOINT_MAX_NAME) {
+      v::error << name() << "Section name of " << section.name_length << " bytes in " << m_restore_file << v::endl;
+      ok = false;
+      break;
+    }
+    std::string section_name(section.name_length, '\0');
+    ok = !section_name.size() || checkpoint_read(file, &section_name[0], section_name.size());
+    // Memories and registers must be the regions of this platform, sizes
+    // and offsets are never taken from the file alone
+    if (ok && (section.type == 'M' || section.type == 'R') &&
+        !region(section.type, section_name, section.start, section.size)) {
+      v::error << name() << "Section " << section_name << " at " << v::uint32 << section.start
+               << " of " << section.size << " bytes is no region of this platform" << v::endl;
+      ok = false;
+      break;
+    }
+    if (section.type == 'M') {
+      for (uint32_t i = 0; ok && i < section.count; i++) {
+        uint32_t offset;
+        ok = checkpoint_read(file, &offset, sizeof(offset));
+        if (ok && (offset >= section.size || offset % CHECKPOINT_PAGE)) {
+          v::error << name() << "Page at offset " << v::uint32 << offset << " is outside of "
+                   << section_name << v::endl;
+          ok = false;
+          break;
+        }
+        uint32_t length = std::min<uint32_t>(CHECKPOINT_PAGE, section.size - offset);
+        ok = ok && checkpoint_read(file, &data[0], length);
+        if (ok) {
+          ahbwrite_dbg(section.start + offset, &data[0], length);
+        }
+      }
+    } else if (section.type == 'R') {
+      data.resize(std::max<size_t>(section.size, CHECKPOINT_PAGE));
+      ok = checkpoint_read(file, &data[0], section.size);
+      for (uint32_t offset = section.size; ok && offset >= 4; offset -= 4) {
+        ahbwrite_dbg(section.start + offset - 4, &data[offset - 4], 4);
+      }
+    } else if (section.type == 'C') {
+      if (section.count > CHECKPOINT_MAX_STATE) {
+        v::error << name() << "State " << section_name << " of " << section.count << " words" << v::endl;
+        ok = false;
+        break;
+      }
+      std::vector<uint32_t> state(section.count);
+      ok = state.empty() || checkpoint_read(file, &state[0], state.size() * sizeof(uint32_t));
+      bool found = false;
+      for (size_t i = 0; ok && i < m_states.size(); i++) {
+        if (m_states[i]->name() == section_name) {
+          found = true;
+          if (!m_states[i]->restore(state)) {
+            v::error << name() << "State " << section_name << " of " << state.size()
+                     << " words does not fit the processor" << v::endl;
+            ok = false;
+          }
+        }
+      }
+      if (ok && !found) {
+        v::error << name() << "State " << section_name << " belongs to no processor of this platform" << v::endl;
+        ok = false;
+      }
+    } else {
+      ok = false;
+    }
+  }
+  fclose(file);
+  if (!ok) {
+    v::error << name() << "Checkpoint " << m_restore_file << " is truncated or invalid" << v::endl;
+    return false;
+  }
+  v::info << name() << "Restored checkpoint " << m_restore_file << " taken at "
+          << sc_core::sc_time(static_cast<double>(time_ps), SC_PS) << v::endl;
+  return true;
+}
+
+/// @}
@@ -0,0 +1,173 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup checkpoint
+/// @{
+/// @file checkpoint.h
+/// Save and restore memories, register banks and processor state.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_CHECKPOINT_CHECKPOINT_H_
+#define MODELS_CHECKPOINT_CHECKPOINT_H_
+
+#include <amba.h>
+#include <string>
+#include <vector>
+
+#include "core/common/base.h"
+#include "core/common/ahbmaster.h"
+#include "core/common/apbdevice.h"
+#include "core/common/apbslave.h"
+#include "core/common/clkdevice.h"
+#include "core/common/sr_signal.h"
+
+/// Granularity of the sparse memory images, pages of zeros are not stored
+#define CHECKPOINT_PAGE 4096
+
+#define CHECKPOINT_MAGIC "CUSECKPT"
+#define CHECKPOINT_VERSION 1
+
+/// Processor state as a list of words
+class CheckpointState {
+  public:
+    virtual ~CheckpointState() {}
+    virtual std::string name() const = 0;
+    virtual void save(std::vector<uint32_t> &state) = 0;
+    /// False if the state does not fit, the processor is left unchanged
+    virtual bool restore(const std::vector<uint32_t> &state) = 0;
+};
+
+/// Processor state through a TRAP ABI interface: all GDB registers and the
+/// program counter. Windows other than the current one are not part of the
+/// GDB registers, software flushes them to the stack before it requests a
+/// checkpoint.
+template<class ABI>
+class CheckpointABI : public CheckpointState {
+  public:
+    CheckpointABI(const std::string &name, ABI &abi) : m_name(name), m_abi(abi) {}
+
+    std::string name() const { return m_name; }
+
+    void save(std::vector<uint32_t> &state) {
+      state.clear();
+      for (unsigned int i = 0; i < m_abi.nGDBRegs(); i++) {
+        state.push_back(m_abi.readGDBReg(i));
+      }
+      state.push_back(m_abi.readPC());
+    }
+
+    bool restore(const std::vector<uint32_t> &state) {
+      if (state.size() != m_abi.nGDBRegs() + 1) {
+        return false;
+      }
+      for (unsigned int i = 0; i < m_abi.nGDBRegs(); i++) {
+        m_abi.setGDBReg(state[i], i);
+      }
+      m_abi.setPC(state.back());
+      return true;
+    }
+
+  private:
+    std::string m_name;
+    ABI &m_abi;
+};
+
+/// Wrap a processor ABI interface, deducing its type
+template<class ABI>
+CheckpointState *checkpoint_abi(const std::string &name, ABI &abi) {
+  return new CheckpointABI<ABI>(name, abi);
+}
+
+/// Writes the contents of memory regions, register windows and processor
+/// states to a file and restores them at the start of the next run.
+///
+/// Memories and registers are accessed with debug transfers over the AHB,
+/// so every slave on the bus can be saved. Memory regions are stored in
+/// pages, pages of zeros are skipped. Where a memory grants DMI its pages
+/// are read directly and pages the host never backed are skipped unread,
+/// so saving costs the touched memory, not the configured size.
+///
+/// A restore only accepts sections matching the regions added to this
+/// platform, and processor states of the registered processors with the
+/// expected number of registers. It stops the simulation if the file cannot
+/// be restored. Register windows are restored from the highest to the lowest
+/// offset, control registers at offset 0 are written last and see the rest
+/// of the configuration.
+///
+/// The checkpoint is saved at a simulated time or when software writes 1
+/// to CTRL (offset 0x00). Reading CTRL returns 1 after a restore.
+class Checkpoint : public AHBMaster<APBSlave>, public CLKDevice {
+  public:
+    SC_HAS_PROCESS(Checkpoint);
+    SR_HAS_SIGNALS(Checkpoint);
+    GC_HAS_CALLBACKS();
+
+    /// Notified one delta after the restore at time 0, hold the processors
+    /// in reset until then
+    sc_core::sc_event restored;
+
+    /// An empty file name disables saving or restoring, a save_at of
+    /// SC_ZERO_TIME saves on request of software only.
+    Checkpoint(ModuleName name,
+      uint32_t hindex,
+      uint32_t pindex,
+      uint32_t paddr,
+      uint32_t pmask,
+      const std::string &save_file,
+      const std::string &restore_file,
+      sc_core::sc_time save_at,
+      AbstractionLayer ambaLayer = amba::amba_LT);
+
+    ~Checkpoint();
+
+    void init_registers();
+
+    /// Memory of size bytes at start, stored sparsely
+    void add_memory(const std::string &name, uint32_t start, uint32_t size);
+
+    /// Register window of size bytes at base, stored word by word
+    void add_registers(const std::string &name, uint32_t base, uint32_t size);
+
+    /// Processor state, the checkpoint takes ownership
+    void add_state(CheckpointState *state);
+
+    /// Write the checkpoint file
+    bool save();
+
+    sc_core::sc_time get_clock() { return clock_cycle; }
+
+  protected:
+    struct Region {
+      char type;
+      std::string name;
+      uint32_t start;
+      uint32_t size;
+    };
+
+    void schedule();
+    bool restore();
+
+    /// DMI pointer covering [addr, addr + length), false if not granted
+    bool dmi_page(uint32_t addr, uint32_t length, tlm::tlm_dmi &dmi);
+
+    /// The registered region matching a section of a file, NULL if none
+    const Region *region(char type, const std::string &name, uint32_t start, uint32_t size) const;
+
+    void ctrl_read();
+    void ctrl_write();
+
+    std::string m_save_file;
+    std::string m_restore_file;
+    sc_core::sc_time m_save_at;
+    std::vector<Region> m_regions;
+    std::vector<CheckpointState *> m_states;
+    bool m_saved;
+    bool m_restored;
+};
+
+#endif  // MODELS_CHECKPOINT_CHECKPOINT_H_
+/// @}
@@ -0,0 +1,295 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup checkpoint
+/// @{
+/// @file checkpoint_roundtrip.cpp
+/// Save and restore of a memory, a register window and a processor state.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include <amba.h>
+#include <tlm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#include "core/common/systemc.h"
+#include "core/common/verbose.h"
+#include "models/checkpoint/checkpoint.h"
+
+/// Four pages of anonymous memory at 0 granted as DMI, so pages that are
+/// never written stay unbacked, and a register window at REGS that records
+/// the order of its writes
+class TestMemory : public sc_core::sc_module {
+  public:
+    amba::amba_slave_socket<32> ahb;
+
+    static const uint32_t SIZE = 4 * CHECKPOINT_PAGE;
+    static const uint32_t REGS = 0x10000;
+    static const uint32_t REGS_SIZE = 16;
+
+    explicit TestMemory(sc_core::sc_module_name name) :
+      sc_core::sc_module(name),
+      ahb("ahb", amba::amba_AHB, amba::amba_LT, false),
+      m_regs(REGS_SIZE, 0) {
+      void *data = mmap(NULL, SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      m_data = data == MAP_FAILED ? NULL : static_cast<uint8_t *>(data);
+      ahb.register_b_transport(this, &TestMemory::b_transport);
+      ahb.register_transport_dbg(this, &TestMemory::transport_dbg);
+      ahb.register_get_direct_mem_ptr(this, &TestMemory::get_direct_mem_ptr);
+    }
+
+    ~TestMemory() {
+      if (m_data) {
+        munmap(m_data, SIZE);
+      }
+    }
+
+    uint8_t *data() { return m_data; }
+    std::vector<uint8_t> &regs() { return m_regs; }
+    std::vector<uint32_t> &writes() { return m_writes; }
+
+  private:
+    void b_transport(tlm::tlm_generic_payload &trans, sc_core::sc_time &delay) {
+      transport_dbg(trans);
+    }
+
+    unsigned int transport_dbg(tlm::tlm_generic_payload &trans) {
+      uint32_t addr = trans.get_address();
+      uint32_t length = trans.get_data_length();
+      uint8_t *target = NULL;
+      if (addr + length <= SIZE) {
+        target = m_data + addr;
+      } else if (addr >= REGS && addr + length <= REGS + REGS_SIZE) {
+        target = &m_regs[addr - REGS];
+      }
+      if (!target) {
+        trans.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
+        return 0;
+      }
+      if (trans.is_write()) {
+        memcpy(target, trans.get_data_ptr(), length);
+        if (addr >= REGS) {
+          m_writes.push_back(addr);
+        }
+      } else {
+        memcpy(trans.get_data_ptr(), target, length);
+      }
+      trans.set_response_status(tlm::TLM_OK_RESPONSE);
+      return length;
+    }
+
+    bool get_direct_mem_ptr(tlm::tlm_generic_payload &trans, tlm::tlm_dmi &dmi) {
+      if (trans.get_address() >= SIZE) {
+        return false;
+      }
+      dmi.set_dmi_ptr(m_data);
+      dmi.set_start_address(0);
+      dmi.set_end_address(SIZE - 1);
+      dmi.allow_read_write();
+      return true;
+    }
+
+    uint8_t *m_data;
+    std::vector<uint8_t> m_regs;
+    std::vector<uint32_t> m_writes;
+};
+
+/// Processor with a register file of adjustable size, in the shape of a
+/// TRAP ABI interface
+class TestABI {
+  public:
+    TestABI() : m_regs(8, 0), m_pc(0) {}
+
+    unsigned int nGDBRegs() { return m_regs.size(); }
+    uint32_t readGDBReg(unsigned int i) { return m_regs[i]; }
+    void setGDBReg(uint32_t value, unsigned int i) { m_regs[i] = value; }
+    uint32_t readPC() { return m_pc; }
+    void setPC(uint32_t value) { m_pc = value; }
+
+    std::vector<uint32_t> m_regs;
+    uint32_t m_pc;
+};
+
+/// Restores from a file in the middle of a run
+class TestCheckpoint : public Checkpoint {
+  public:
+    TestCheckpoint(sc_core::sc_module_name name, const std::string &file) :
+      Checkpoint(name, 1, 0, 0, 0xFFF, file, "", sc_core::SC_ZERO_TIME) {}
+
+    bool restore_from(const std::string &file) {
+      m_restore_file = file;
+      return restore();
+    }
+};
+
+/// Saves, scrambles, restores and compares
+class Testbench : public sc_core::sc_module {
+  public:
+    SC_HAS_PROCESS(Testbench);
+
+    amba::amba_master_socket<32> apb;
+
+    Testbench(sc_core::sc_module_name name, TestCheckpoint &checkpoint, TestMemory &mem,
+              TestABI &abi, const std::string &file) :
+      sc_core::sc_module(name),
+      apb("apb", amba::amba_APB, amba::amba_LT, false),
+      m_failures(0),
+      m_checkpoint(checkpoint),
+      m_mem(mem),
+      m_abi(abi),
+      m_file(file) {
+      SC_THREAD(run);
+    }
+
+    uint32_t failures() const { return m_failures; }
+
+  private:
+    void check(bool ok, const char *what) {
+      if (!ok) {
+        v::error << name() << "Failed: " << what << v::endl;
+        m_failures++;
+      }
+    }
+
+    /// Copy the first length bytes of the checkpoint to file, or garbage
+    /// if length is 0
+    void copy(const std::string &file, size_t length) {
+      FILE *in = fopen(m_file.c_str(), "rb");
+      FILE *out = fopen(file.c_str(), "wb");
+      std::vector<uint8_t> data(length ? length : 64, 0x5A);
+      if (length && (!in || fread(&data[0], 1, length, in) != length)) {
+        check(false, "read back the checkpoint");
+      }
+      if (out) {
+        fwrite(&data[0], 1, data.size(), out);
+        fclose(out);
+      }
+      if (in) {
+        fclose(in);
+      }
+    }
+
+    void run() {
+      uint8_t *data = m_mem.data();
+      if (!data) {
+        check(false, "map the memory");
+        sc_core::sc_stop();
+        return;
+      }
+      // page 0 and the start of page 3 hold data, page 1 zeros, page 2 is never written
+      for (uint32_t i = 0; i < CHECKPOINT_PAGE; i++) {
+        data[i] = i * 7 + 1;
+      }
+      memset(data + CHECKPOINT_PAGE, 0, CHECKPOINT_PAGE);
+      for (uint32_t i = 0; i < 100; i++) {
+        data[3 * CHECKPOINT_PAGE + i] = 0xC0 + (i & 0xF);
+      }
+      // page 2 is not read either, that would back it with the zero page
+      std::vector<uint8_t> page0(data, data + CHECKPOINT_PAGE);
+      std::vector<uint8_t> page3(data + 3 * CHECKPOINT_PAGE, data + 4 * CHECKPOINT_PAGE);
+      for (uint32_t i = 0; i < TestMemory::REGS_SIZE; i++) {
+        m_mem.regs()[i] = 0x10 + i;
+      }
+      for (uint32_t i = 0; i < m_abi.m_regs.size(); i++) {
+        m_abi.m_regs[i] = 0x1000 + i;
+      }
+      m_abi.m_pc = 0x40001234;
+
+      wait(1, sc_core::SC_US);
+      check(m_checkpoint.save(), "save");
+
+      // only the two pages with data are stored
+      struct stat st;
+      size_t expected = 20 +
+        20 + 3 + 2 * (4 + CHECKPOINT_PAGE) +
+        20 + 4 + TestMemory::REGS_SIZE +
+        20 + 3 + 4 * (m_abi.m_regs.size() + 1);
+      check(stat(m_file.c_str(), &st) == 0 && static_cast<size_t>(st.st_size) == expected, "sparse file size");
+
+      // scramble what was saved, zero pages are expected to be zero on restore
+      memset(data, 0x55, CHECKPOINT_PAGE);
+      memset(data + 3 * CHECKPOINT_PAGE, 0x55, CHECKPOINT_PAGE);
+      m_mem.regs().assign(TestMemory::REGS_SIZE, 0);
+      m_mem.writes().clear();
+      m_abi.m_regs.assign(m_abi.m_regs.size(), 0);
+      m_abi.m_pc = 0;
+
+      check(m_checkpoint.restore_from(m_file), "restore");
+      check(memcmp(data, &page0[0], CHECKPOINT_PAGE) == 0, "first page restored");
+      check(memcmp(data + 3 * CHECKPOINT_PAGE, &page3[0], CHECKPOINT_PAGE) == 0, "last page restored");
+      for (uint32_t i = CHECKPOINT_PAGE; i < 3 * CHECKPOINT_PAGE; i++) {
+        check(data[i] == 0, "zero and untouched pages stay zero");
+      }
+      for (uint32_t i = 0; i < TestMemory::REGS_SIZE; i++) {
+        check(m_mem.regs()[i] == 0x10 + i, "registers restored");
+      }
+      check(m_mem.writes().size() == TestMemory::REGS_SIZE / 4 &&
+            m_mem.writes().back() == TestMemory::REGS, "register at offset 0 written last");
+      for (uint32_t i = 0; i < m_abi.m_regs.size(); i++) {
+        check(m_abi.m_regs[i] == 0x1000 + i, "processor registers restored");
+      }
+      check(m_abi.m_pc == 0x40001234, "program counter restored");
+
+      // broken files are refused
+      std::string broken = m_file + ".broken";
+      copy(broken, 0);
+      check(!m_checkpoint.restore_from(broken), "garbage refused");
+      copy(broken, expected - 10);
+      check(!m_checkpoint.restore_from(broken), "truncated file refused");
+      unlink(broken.c_str());
+
+      // a processor with another register count does not take the state
+      m_abi.m_regs.resize(9, 0);
+      m_abi.m_pc = 0;
+      check(!m_checkpoint.restore_from(m_file), "state of another size refused");
+      check(m_abi.m_pc == 0, "refused state leaves the processor alone");
+      sc_core::sc_stop();
+    }
+
+    uint32_t m_failures;
+    TestCheckpoint &m_checkpoint;
+    TestMemory &m_mem;
+    TestABI &m_abi;
+    std::string m_file;
+};
+
+int sc_main(int argc, char *argv[]) {
+  char name[] = "/tmp/checkpoint_roundtripXXXXXX";
+  int fd = mkstemp(name);
+  if (fd < 0) {
+    v::error << "checkpoint_roundtrip" << "Cannot create a temporary file" << v::endl;
+    return 1;
+  }
+  close(fd);
+
+  TestMemory mem("mem");
+  TestABI abi;
+  TestCheckpoint checkpoint("checkpoint", name);
+  checkpoint.add_memory("ram", 0, TestMemory::SIZE);
+  checkpoint.add_registers("regs", TestMemory::REGS, TestMemory::REGS_SIZE);
+  checkpoint.add_state(checkpoint_abi("cpu", abi));
+  Testbench tb("tb", checkpoint, mem, abi, name);
+  checkpoint.ahb(mem.ahb);
+  tb.apb(checkpoint.apb);
+  checkpoint.set_clk(10, sc_core::SC_NS);
+
+  sc_core::sc_start();
+  unlink(name);
+
+  if (tb.failures()) {
+    v::error << "checkpoint_roundtrip" << tb.failures() << " checks failed" << v::endl;
+    return 1;
+  }
+  return 0;
+}
+/// @}
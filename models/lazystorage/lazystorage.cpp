@@ -0,0 +1,119 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup lazystorage
+/// @{
+/// @file lazystorage.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/lazystorage/lazystorage.h"
+#include "core/common/verbose.h"
+#include "core/common/sr_registry.h"
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+SR_HAS_MODULE(LazyStorage);
+
+LazyStorage::LazyStorage(sc_core::sc_module_name mn) :
+  sc_core::sc_module(mn),
+  m_data(NULL),
+  m_size(0) {
+}
+
+LazyStorage::~LazyStorage() {
+  if (m_data) {
+    munmap(m_data, m_size);
+  }
+}
+
+void LazyStorage::set_size(const uint32_t &size) {
+  if (m_data) {
+    munmap(m_data, m_size);
+    m_data = NULL;
+  }
+  m_size = size;
+  if (!m_size) {
+    return;
+  }
+  void *data = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (data == MAP_FAILED) {
+    v::error << name() << "Cannot map " << (m_size >> 20) << " MB of memory" << v::endl;
+    m_size = 0;
+    return;
+  }
+  m_data = static_cast<uint8_t *>(data);
+}
+
+void LazyStorage::write(const uint32_t &addr, const uint8_t &byte) {
+  m_data[addr] = byte;
+}
+
+uint8_t LazyStorage::read(const uint32_t &addr) const {
+  return m_data[addr];
+}
+
+void LazyStorage::write_block(const uint32_t &addr, const uint8_t *data, const uint32_t &len) {
+  memcpy(m_data + addr, data, len);
+}
+
+void LazyStorage::read_block(const uint32_t &addr, uint8_t *data, const uint32_t &len) const {
+  memcpy(data, m_data + addr, len);
+}
+
+void LazyStorage::erase(const uint32_t &start, const uint32_t &end) {
+  if (!m_data || start > end || start >= m_size) {
+    return;
+  }
+  uint32_t last = std::min(end, m_size - 1);
+  uint32_t page = sysconf(_SC_PAGESIZE);
+  uint32_t first_page = (start + page - 1) & ~(page - 1);
+  uint32_t end_page = (static_cast<uint64_t>(last) + 1) & ~static_cast<uint64_t>(page - 1);
+  if (first_page >= end_page) {
+    memset(m_data + start, 0, last - start + 1);
+    return;
+  }
+  // partial pages are cleared, whole pages dropped and read as zero again
+  memset(m_data + start, 0, first_page - start);
+  madvise(m_data + first_page, end_page - first_page, MADV_DONTNEED);
+  memset(m_data + end_page, 0, last + 1 - end_page);
+}
+
+uint8_t *LazyStorage::get_dmi_ptr() {
+  return m_data;
+}
+
+bool LazyStorage::allow_dmi_rw() {
+  return m_data != NULL;
+}
+
+uint64_t LazyStorage::touched() const {
+  if (!m_data) {
+    return 0;
+  }
+  size_t page = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> resident((m_size + page - 1) / page);
+  if (mincore(m_data, m_size, &resident[0])) {
+    return 0;
+  }
+  uint64_t pages = 0;
+  for (size_t i = 0; i < resident.size(); i++) {
+    pages += resident[i] & 1;
+  }
+  return pages * page;
+}
+
+void LazyStorage::end_of_simulation() {
+  uint64_t used = touched();
+  v::info << name() << "Touched " << (used >> 10) << " KiB of " << (m_size >> 10) << " KiB ("
+          << (m_size ? 100.0 * used / m_size : 0.0) << "%)" << v::endl;
+}
+
+/// @}
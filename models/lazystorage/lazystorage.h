@@ -0,0 +1,59 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup lazystorage
+/// @{
+/// @file lazystorage.h
+/// Memory storage committed page by page on first use.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_LAZYSTORAGE_LAZYSTORAGE_H_
+#define MODELS_LAZYSTORAGE_LAZYSTORAGE_H_
+
+#include <stdint.h>
+
+#include "core/common/systemc.h"
+#include "gaisler/memory/storage.h"
+
+/// Storage implementation for the Memory models ("LazyStorage") that maps
+/// the whole memory without reserving it. The host commits a page when the
+/// simulation first touches it, so configured sizes cost neither startup
+/// time nor RSS. Untouched memory reads as zero and, unlike MapStorage, the
+/// memory stays one block that can be granted as DMI.
+///
+/// At the end of simulation the touched (resident) and configured bytes
+/// are reported.
+class LazyStorage : public Storage, public sc_core::sc_module {
+  public:
+    LazyStorage(sc_core::sc_module_name mn = "");
+    ~LazyStorage();
+
+    void set_size(const uint32_t &size);
+    void write(const uint32_t &addr, const uint8_t &byte);
+    uint8_t read(const uint32_t &addr) const;
+    void write_block(const uint32_t &addr, const uint8_t *data, const uint32_t &len);
+    void read_block(const uint32_t &addr, uint8_t *data, const uint32_t &len) const;
+
+    /// Zero [start, end], whole pages are returned to the host
+    void erase(const uint32_t &start, const uint32_t &end);
+
+    uint8_t *get_dmi_ptr();
+    bool allow_dmi_rw();
+
+    /// Bytes in pages the simulation has touched
+    uint64_t touched() const;
+    uint32_t size() const { return m_size; }
+
+  private:
+    void end_of_simulation();
+
+    uint8_t *m_data;
+    uint32_t m_size;
+};
+
+#endif  // MODELS_LAZYSTORAGE_LAZYSTORAGE_H_
+/// @}
@@ -0,0 +1,90 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup lazystorage
+/// @{
+/// @file lazystorage_erase.cpp
+/// Page math of LazyStorage::erase: partial pages, whole pages and clamping.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include <unistd.h>
+#include <vector>
+
+#include "core/common/systemc.h"
+#include "core/common/verbose.h"
+#include "models/lazystorage/lazystorage.h"
+
+static uint32_t failures = 0;
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    v::error << "lazystorage_erase" << "Failed: " << what << v::endl;
+    failures++;
+  }
+}
+
+/// True if [start, end] reads as value
+static bool filled(const LazyStorage &storage, uint32_t start, uint32_t end, uint8_t value) {
+  std::vector<uint8_t> data(end - start + 1);
+  storage.read_block(start, &data[0], data.size());
+  for (size_t i = 0; i < data.size(); i++) {
+    if (data[i] != value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int sc_main(int argc, char *argv[]) {
+  const uint32_t page = sysconf(_SC_PAGESIZE);
+  const uint32_t size = 8 * page;
+  LazyStorage storage("storage");
+  storage.set_size(size);
+  check(storage.touched() == 0, "nothing touched after mapping");
+
+  std::vector<uint8_t> pattern(size, 0xAA);
+  storage.write_block(0, &pattern[0], size);
+  check(storage.touched() == size, "all pages touched");
+
+  // within one page only the range is cleared
+  storage.erase(100, 200);
+  check(filled(storage, 100, 200, 0), "erase within a page");
+  check(storage.read(99) == 0xAA && storage.read(201) == 0xAA, "bytes around a partial erase");
+  check(storage.touched() == size, "a partial page stays resident");
+
+  // pages 1 and 2 are dropped, the ends of pages 0 and 3 cleared
+  storage.erase(page - 10, 3 * page + 9);
+  check(storage.touched() == size - 2 * page, "whole pages returned to the host");
+  check(filled(storage, page - 10, 3 * page + 9, 0), "erase across pages");
+  check(storage.read(page - 11) == 0xAA && storage.read(3 * page + 10) == 0xAA, "bytes around a page erase");
+
+  // an exactly aligned range leaves no partial page
+  storage.erase(4 * page, 5 * page - 1);
+  check(filled(storage, 4 * page, 5 * page - 1, 0), "aligned erase");
+  check(storage.read(4 * page - 1) == 0xAA && storage.read(5 * page) == 0xAA, "bytes around an aligned erase");
+
+  // the end is clamped to the memory
+  storage.erase(7 * page + 5, 0xFFFFFFFF);
+  check(filled(storage, 7 * page + 5, size - 1, 0), "erase clamped to the end");
+  check(storage.read(7 * page + 4) == 0xAA, "byte before a clamped erase");
+
+  // empty and out of range requests change nothing
+  storage.erase(300, 299);
+  storage.erase(size, size + 10);
+  check(storage.read(300) == 0xAA && storage.read(299) == 0xAA, "reversed range ignored");
+
+  storage.erase(0, size - 1);
+  check(storage.touched() == 0, "all pages returned");
+  check(filled(storage, 0, size - 1, 0), "erased memory reads as zero");
+
+  if (failures) {
+    v::error << "lazystorage_erase" << failures << " checks failed" << v::endl;
+    return 1;
+  }
+  return 0;
+}
+/// @}
@@ -0,0 +1,434 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup platformbuilder
+/// @{
+/// @file platformbuilder.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/platformbuilder/platformbuilder.h"
+
+#include <cstdlib>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/foreach.hpp>
+
+#include "gaisler/ahbmem/ahbmem.h"
+#ifdef HAVE_AHBDISPLAY
+#include "models/ahbdisplay/ahbdisplay.h"
+#endif
+#ifdef HAVE_AHBCAMERA
+#include "models/ahbcamera/ahbcamera.h"
+#endif
+#include "models/ahbfilecamera/ahbfilecamera.h"
+#include "models/ahbgrayframer/ahbgrayframer.h"
+#include "models/ahbscaler/ahbscaler.h"
+#include "models/ahbzoomer/ahbzoomer.h"
+#include "models/ahbstatistics/ahbstatistics.h"
+#include "models/ahbframetrigger/ahbframetrigger.h"
+#include "models/apbkeyboard/apbkeyboard.h"
+#include "gaisler/irqmp/irqmp.h"
+#include "core/common/verbose.h"
+
+PlatformBuilder::PlatformBuilder(AHBCtrl &ahbctrl,
+  APBCtrl &apbctrl,
+  AHBMonitor *monitor,
+  uint32_t clock_ns,
+  amba::amba_layer_ids ambaLayer,
+  bool pow_mon,
+  Irqmp *irqmp) :
+  m_ahbctrl(ahbctrl),
+  m_apbctrl(apbctrl),
+  m_monitor(monitor),
+  m_clock_ns(clock_ns),
+  m_ambaLayer(ambaLayer),
+  m_pow_mon(pow_mon),
+  m_irqmp(irqmp),
+  m_frame_width(960),
+  m_frame_height(720),
+  m_video_width(320),
+  m_models(0) {
+}
+
+uint32_t PlatformBuilder::number(const ptree &node, const char *key, uint32_t def) {
+  boost::optional<std::string> value = node.get_optional<std::string>(key);
+  if (!value || value->empty()) {
+    return def;
+  }
+  return strtoul(value->c_str(), NULL, 0);
+}
+
+std::string PlatformBuilder::text(const ptree &node, const char *key, const std::string &def) {
+  return node.get<std::string>(key, def);
+}
+
+sc_core::sc_signal<bool> &PlatformBuilder::signal(const std::string &name) {
+  std::map<std::string, sc_core::sc_signal<bool> *>::iterator it = m_signals.find(name);
+  if (it == m_signals.end()) {
+    // Unnamed, the signal names would clash with the model names
+    it = m_signals.insert(std::make_pair(name, new sc_core::sc_signal<bool>())).first;
+  }
+  return *it->second;
+}
+
+sc_core::sc_signal<bool> &PlatformBuilder::output(const std::string &name) {
+  m_driven.insert(name);
+  return signal(name);
+}
+
+sc_core::sc_signal<uint32_t> &PlatformBuilder::rows(const std::string &name) {
+  std::map<std::string, sc_core::sc_signal<uint32_t> *>::iterator it = m_rows.find(name);
+  if (it == m_rows.end()) {
+    it = m_rows.insert(std::make_pair(name, new sc_core::sc_signal<uint32_t>())).first;
+  }
+  return *it->second;
+}
+
+sc_core::sc_signal<char> &PlatformBuilder::keys(const std::string &name) {
+  std::map<std::string, sc_core::sc_signal<char> *>::iterator it = m_keys.find(name);
+  if (it == m_keys.end()) {
+    it = m_keys.insert(std::make_pair(name, new sc_core::sc_signal<char>())).first;
+  }
+  return *it->second;
+}
+
+AHBGrayframer *PlatformBuilder::source(const ptree &node) {
+  std::string name = text(node, "source", "");
+  std::map<std::string, AHBGrayframer *>::iterator it = m_grayframers.find(name);
+  if (it == m_grayframers.end()) {
+    v::error << "PlatformBuilder" << "Unknown frame source " << name << v::endl;
+    return NULL;
+  }
+  return it->second;
+}
+
+template<class MODEL>
+void PlatformBuilder::connect(MODEL *model) {
+  AHBMonitor::connect(m_monitor, *model, m_ahbctrl.ahbIN);
+  model->set_clk(m_clock_ns, SC_NS);
+  m_models++;
+}
+
+std::string PlatformBuilder::path(const ptree &node, const char *key) const {
+  std::string name = text(node, key, "");
+  if (name.empty() || name[0] == '/') {
+    return name;
+  }
+  return m_dir + name;
+}
+
+bool PlatformBuilder::build(const std::string &file) {
+  ptree root;
+  try {
+    boost::property_tree::read_json(file, root);
+  } catch (boost::property_tree::json_parser_error &e) {
+    v::error << "PlatformBuilder" << "Cannot read platform " << file << ": " << e.what() << v::endl;
+    return false;
+  }
+
+  m_frame_width = number(root, "frame.width", m_frame_width);
+  m_frame_height = number(root, "frame.height", m_frame_height);
+  m_video_width = number(root, "frame.video_width", m_video_width);
+  m_frames = text(root, "frames", "");
+  size_t slash = file.rfind('/');
+  m_dir = (slash == std::string::npos) ? "" : file.substr(0, slash + 1);
+
+  // Sections in the order the hard-coded platforms create them
+  static const struct {
+    const char *section;
+    const char *name;
+    bool (PlatformBuilder::*build)(const ptree &node);
+  } sections[] = {
+    { "ahbmem", "ahbmem", &PlatformBuilder::build_ahbmem },
+    { "camera", "ahbcamera", &PlatformBuilder::build_camera },
+    { "filecamera", "ahbfilecamera", &PlatformBuilder::build_filecamera },
+    { "grayframer", "ahbgrayframer", &PlatformBuilder::build_grayframer },
+    { "scaler", "ahbscaler", &PlatformBuilder::build_scaler },
+    { "zoomer", "ahbzoomer", &PlatformBuilder::build_zoomer },
+    { "statistics", "ahbstatistics", &PlatformBuilder::build_statistics },
+    { "display", "ahbdisplay", &PlatformBuilder::build_display },
+    { "keyboard", "apbkeyboard", &PlatformBuilder::build_keyboard },
+    // Last, it watches every signal the other sections created
+    { "frametrigger", "ahbframetrigger", &PlatformBuilder::build_frametrigger }
+  };
+
+  for (ptree::const_iterator it = root.begin(); it != root.end(); ++it) {
+    bool known = (it->first == "frame" || it->first == "frames");
+    for (uint32_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) {
+      known |= (it->first == sections[i].section);
+    }
+    if (!known) {
+      v::error << "PlatformBuilder" << "Unknown section " << it->first << " in " << file << v::endl;
+      return false;
+    }
+  }
+
+  // Names become SystemC module names, a clash would only show at elaboration
+  std::set<std::string> names;
+  for (uint32_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) {
+    boost::optional<ptree &> section = root.get_child_optional(sections[i].section);
+    if (!section) {
+      continue;
+    }
+    BOOST_FOREACH(const ptree::value_type &entry, *section) {
+      std::string name = text(entry.second, "name", sections[i].name);
+      if (!names.insert(name).second) {
+        v::error << "PlatformBuilder" << "Duplicate name " << name << " in " << file << v::endl;
+        return false;
+      }
+      if (!(this->*sections[i].build)(entry.second)) {
+        return false;
+      }
+    }
+  }
+
+  if (m_frames.empty()) {
+    v::error << "PlatformBuilder" << "No frame signal given as \"frames\" in " << file << v::endl;
+    return false;
+  }
+  if (m_driven.find(m_frames) == m_driven.end()) {
+    v::error << "PlatformBuilder" << "Frame signal " << m_frames << " is not driven by any model" << v::endl;
+    return false;
+  }
+  v::info << "PlatformBuilder" << "Built " << m_models << " models and " << m_signals.size()
+          << " frame signals from " << file << v::endl;
+  return true;
+}
+
+bool PlatformBuilder::build_ahbmem(const ptree &node) {
+  AHBMem *ahbmem = new AHBMem(text(node, "name", "ahbmem").c_str(),
+    number(node, "addr", 0xA00),
+    number(node, "mask", 0xE00),
+    m_ambaLayer,
+    number(node, "index", 1),
+    number(node, "cacheable", 1),
+    number(node, "waitstates", 0),
+    m_pow_mon);
+  m_ahbctrl.ahbOUT(ahbmem->ahb);
+  ahbmem->set_clk(m_clock_ns, SC_NS);
+  m_models++;
+  return true;
+}
+
+bool PlatformBuilder::build_frametrigger(const ptree &node) {
+  AHBFrameTrigger *ahbframetrigger = new AHBFrameTrigger(text(node, "name", "ahbframetrigger").c_str(),
+    number(node, "index", 1),
+    sc_core::sc_time(number(node, "interval", 40), SC_MS),
+    m_pow_mon,
+    m_ambaLayer,
+    path(node, "stimulus"));
+  connect(ahbframetrigger);
+  for (std::map<std::string, sc_core::sc_signal<bool> *>::iterator it = m_signals.begin();
+       it != m_signals.end(); ++it) {
+    ahbframetrigger->watch(it->first, *it->second);
+  }
+  ahbframetrigger->closed_loop(number(node, "inflight", 0), text(node, "stages", ""));
+  // Frames are stamped at the first grayframer of each pipeline
+  for (std::map<std::string, AHBGrayframer *>::iterator it = m_grayframers.begin();
+       it != m_grayframers.end(); ++it) {
+    if (m_heads.count(it->first)) {
+      sr_signal::connect(ahbframetrigger->frameOut, it->second->stampIn);
+    }
+  }
+  return true;
+}
+
+bool PlatformBuilder::build_camera(const ptree &node) {
+#ifdef HAVE_AHBCAMERA
+  std::string name = text(node, "name", "ahbcamera");
+  std::string video = text(node, "video", "bigbuckbunny_small_short.m2v");
+  AHBCamera *ahbcamera = new AHBCamera(name.c_str(),
+    number(node, "hindex", 3),
+    number(node, "pindex", 5),
+    number(node, "paddr", 0x501),
+    number(node, "pmask", 0xFFF),
+    m_frame_width, m_frame_height,
+    video.c_str(),
+    m_ambaLayer);
+  connect(ahbcamera);
+  m_apbctrl.apb(ahbcamera->apb);
+  ahbcamera->triggerOut(output(text(node, "done", name)));
+  return true;
+#else
+  v::error << "PlatformBuilder" << "Built without AHBCamera" << v::endl;
+  return false;
+#endif
+}
+
+bool PlatformBuilder::build_filecamera(const ptree &node) {
+  std::string name = text(node, "name", "ahbfilecamera");
+  std::string video = text(node, "video", "");
+  AHBFileCamera *ahbfilecamera = new AHBFileCamera(name.c_str(),
+    number(node, "hindex", 3),
+    number(node, "pindex", 5),
+    number(node, "paddr", 0x501),
+    number(node, "pmask", 0xFFF),
+    m_frame_width, m_frame_height,
+    video.c_str(),
+    m_ambaLayer,
+    number(node, "loop", 1),
+    number(node, "decimate", 1),
+    number(node, "width", 320), number(node, "height", 240),
+    number(node, "prefetch", 4));
+  connect(ahbfilecamera);
+  m_apbctrl.apb(ahbfilecamera->apb);
+  ahbfilecamera->triggerOut(output(text(node, "done", name)));
+  return true;
+}
+
+bool PlatformBuilder::build_grayframer(const ptree &node) {
+  std::string name = text(node, "name", "ahbgrayframer");
+  std::string channel = text(node, "channel", "Y");
+  AHBGrayframer *ahbgrayframer = new AHBGrayframer(name.c_str(),
+    number(node, "hindex", 4),
+    number(node, "pindex", 6),
+    number(node, "paddr", 0x502),
+    number(node, "pmask", 0xFFF),
+    channel.empty() ? 'Y' : channel[0],
+    number(node, "in_x", 0), number(node, "in_y", 0),
+    number(node, "out_x", m_video_width), number(node, "out_y", 0),
+    m_video_width,
+    m_frame_width, m_frame_height,
+    m_ambaLayer,
+    number(node, "stripe", 0));
+  connect(ahbgrayframer);
+  m_apbctrl.apb(ahbgrayframer->apb);
+  ahbgrayframer->triggerIn(signal(text(node, "trigger", "camera")));
+  ahbgrayframer->triggerOut(output(text(node, "done", name)));
+  // Stripe-level handoff, rows names the upstream grayframer
+  ahbgrayframer->rowsOut(rows(name));
+  std::string upstream = text(node, "rows", "");
+  if (!upstream.empty()) {
+    ahbgrayframer->rowsIn(rows(upstream));
+  }
+  // Frame descriptors from an earlier grayframer
+  if (node.count("source")) {
+    AHBGrayframer *producer = source(node);
+    if (!producer) {
+      return false;
+    }
+    sr_signal::connect(producer->frameOut, ahbgrayframer->frameIn);
+  }
+  m_grayframers[name] = ahbgrayframer;
+  if (upstream.empty() && !node.count("source")) {
+    m_heads.insert(name);
+  }
+  return true;
+}
+
+bool PlatformBuilder::build_scaler(const ptree &node) {
+  std::string name = text(node, "name", "ahbscaler");
+  AHBScaler *ahbscaler = new AHBScaler(name.c_str(),
+    number(node, "hindex", 5),
+    number(node, "pindex", 7),
+    number(node, "paddr", 0x503),
+    number(node, "pmask", 0xFFF),
+    number(node, "in_x", 0), number(node, "in_y", 0),
+    number(node, "in_width", m_video_width * 3 / 4), number(node, "in_height", m_frame_height / 4),
+    number(node, "out_x", m_frame_width - m_video_width),
+    number(node, "out_y", m_frame_height - m_frame_height / 3),
+    number(node, "out_width", m_video_width), number(node, "out_height", m_frame_height / 3),
+    m_frame_width,
+    number(node, "bilinear", 1),
+    m_ambaLayer);
+  connect(ahbscaler);
+  m_apbctrl.apb(ahbscaler->apb);
+  ahbscaler->triggerIn(signal(text(node, "trigger", "camera")));
+  ahbscaler->triggerOut(output(text(node, "done", name)));
+  return true;
+}
+
+bool PlatformBuilder::build_zoomer(const ptree &node) {
+  std::string name = text(node, "name", "ahbzoomer");
+  AHBZoomer *ahbzoomer = new AHBZoomer(name.c_str(),
+    number(node, "hindex", 6),
+    number(node, "pindex", 9),
+    number(node, "paddr", 0x504),
+    number(node, "pmask", 0xFFF),
+    m_frame_width,
+    m_ambaLayer);
+  connect(ahbzoomer);
+  m_apbctrl.apb(ahbzoomer->apb);
+  ahbzoomer->triggerIn(signal(text(node, "trigger", "camera")));
+  ahbzoomer->triggerOut(output(text(node, "done", name)));
+  return true;
+}
+
+bool PlatformBuilder::build_statistics(const ptree &node) {
+  std::string name = text(node, "name", "ahbstatistics");
+  AHBStatistics *ahbstatistics = new AHBStatistics(name.c_str(),
+    number(node, "hindex", 8),
+    number(node, "pindex", 12),
+    number(node, "paddr", 0x507),
+    number(node, "pmask", 0xFFF),
+    number(node, "x", 0), number(node, "y", 0),
+    number(node, "width", m_video_width), number(node, "height", m_frame_height / 3),
+    m_frame_width,
+    m_ambaLayer);
+  connect(ahbstatistics);
+  m_apbctrl.apb(ahbstatistics->apb);
+  ahbstatistics->triggerIn(signal(text(node, "trigger", "camera")));
+  ahbstatistics->triggerOut(output(text(node, "done", name)));
+  return true;
+}
+
+bool PlatformBuilder::build_display(const ptree &node) {
+#ifdef HAVE_AHBDISPLAY
+  std::string name = text(node, "name", "ahbdisplay");
+  AHBDisplay *ahbdisplay = new AHBDisplay(name.c_str(),
+    number(node, "hindex", 2),
+    number(node, "pindex", 4),
+    number(node, "paddr", 0x500),
+    number(node, "pmask", 0xFFF),
+    m_frame_width, m_frame_height);
+  connect(ahbdisplay);
+  m_apbctrl.apb(ahbdisplay->apb);
+  ahbdisplay->triggerIn(signal(text(node, "trigger", "camera")));
+  ahbdisplay->triggerOut(output(text(node, "done", name)));
+  ahbdisplay->keyboardOut(keys(text(node, "keys", "keys")));
+  std::string latency = text(node, "latency", "");
+  if (!latency.empty()) {
+    ahbdisplay->latency_csv(latency);
+  }
+  if (node.count("source")) {
+    AHBGrayframer *producer = source(node);
+    if (!producer) {
+      return false;
+    }
+    sr_signal::connect(producer->frameOut, ahbdisplay->frameIn);
+  }
+  return true;
+#else
+  v::error << "PlatformBuilder" << "Built without AHBDisplay" << v::endl;
+  return false;
+#endif
+}
+
+bool PlatformBuilder::build_keyboard(const ptree &node) {
+  std::string name = text(node, "name", "apbkeyboard");
+  uint32_t pirq = number(node, "pirq", 0);
+  if (pirq && !m_irqmp) {
+    v::error << "PlatformBuilder" << "Keyboard " << name << " has pirq " << pirq
+             << " but the platform has no interrupt controller" << v::endl;
+    return false;
+  }
+  APBKeyboard *apbkeyboard = new APBKeyboard(name.c_str(),
+    number(node, "pindex", 8),
+    number(node, "paddr", 0x508),
+    number(node, "pmask", 0xFFF),
+    pirq,
+    number(node, "depth", 16));
+  m_apbctrl.apb(apbkeyboard->apb);
+  if (pirq) {
+    sr_signal::connect(m_irqmp->irq_in, apbkeyboard->irq, pirq);
+  }
+  apbkeyboard->keyboardIn(keys(text(node, "keys", "keys")));
+  m_models++;
+  return true;
+}
+
+/// @}
@@ -0,0 +1,124 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup platformbuilder
+/// @{
+/// @file platformbuilder.h
+/// Instantiates and wires the video pipeline from a JSON description.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_PLATFORMBUILDER_PLATFORMBUILDER_H_
+#define MODELS_PLATFORMBUILDER_PLATFORMBUILDER_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <boost/property_tree/ptree.hpp>
+
+#include "core/common/systemc.h"
+#include "core/common/amba.h"
+#include "gaisler/ahbctrl/ahbctrl.h"
+#include "gaisler/apbctrl/apbctrl.h"
+#include "models/ahbmonitor/ahbmonitor.h"
+
+class AHBGrayframer;
+class Irqmp;
+
+/// Builds the memories and video models of a platform from a JSON file
+/// instead of hard-coded sc_main blocks, so topologies with several
+/// instances of a model can be tried without recompiling.
+///
+/// Every model section is an array of instances. Models are connected by
+/// named frame signals: "trigger" names the input, the output is named
+/// after the instance unless "done" is given. Signals are created on first
+/// use and can be fetched by the platform with signal().
+class PlatformBuilder {
+  public:
+    PlatformBuilder(AHBCtrl &ahbctrl,
+      APBCtrl &apbctrl,
+      AHBMonitor *monitor,
+      uint32_t clock_ns,
+      amba::amba_layer_ids ambaLayer,
+      bool pow_mon,
+      Irqmp *irqmp = NULL);
+
+    /// Instantiate and wire all models of the description, false on errors
+    bool build(const std::string &file);
+
+    /// Frame signal by name, created on first use
+    sc_core::sc_signal<bool> &signal(const std::string &name);
+
+    /// Row counter of a stage by name, created on first use
+    sc_core::sc_signal<uint32_t> &rows(const std::string &name);
+
+    /// Key code signal by name, created on first use
+    sc_core::sc_signal<char> &keys(const std::string &name);
+
+    /// Name of the frame signal that completes a frame ("frames" entry)
+    const std::string &frames() const { return m_frames; }
+
+    /// Number of models instantiated by build()
+    uint32_t models() const { return m_models; }
+
+  private:
+    typedef boost::property_tree::ptree ptree;
+
+    /// Numbers may be given as JSON numbers or as strings like "0xA00"
+    static uint32_t number(const ptree &node, const char *key, uint32_t def);
+    static std::string text(const ptree &node, const char *key, const std::string &def);
+    /// File name relative to the description, absolute names are kept
+    std::string path(const ptree &node, const char *key) const;
+    /// Frame signal a model drives, marked as driven
+    sc_core::sc_signal<bool> &output(const std::string &name);
+
+    /// Bind the AHB master to the bus (through the monitor) and set its clock
+    template<class MODEL> void connect(MODEL *model);
+
+    bool build_ahbmem(const ptree &node);
+    bool build_frametrigger(const ptree &node);
+    bool build_camera(const ptree &node);
+    bool build_filecamera(const ptree &node);
+    bool build_grayframer(const ptree &node);
+    bool build_scaler(const ptree &node);
+    bool build_zoomer(const ptree &node);
+    bool build_statistics(const ptree &node);
+    bool build_display(const ptree &node);
+    bool build_keyboard(const ptree &node);
+
+    /// The grayframer named by "source", NULL (and an error) if there is none
+    AHBGrayframer *source(const ptree &node);
+
+    AHBCtrl &m_ahbctrl;
+    APBCtrl &m_apbctrl;
+    AHBMonitor *m_monitor;
+    uint32_t m_clock_ns;
+    amba::amba_layer_ids m_ambaLayer;
+    bool m_pow_mon;
+    /// Takes the interrupts of the models, NULL on platforms without one
+    Irqmp *m_irqmp;
+
+    uint32_t m_frame_width;
+    uint32_t m_frame_height;
+    uint32_t m_video_width;
+    std::string m_frames;
+    /// Directory of the description, relative file names start there
+    std::string m_dir;
+    uint32_t m_models;
+
+    std::map<std::string, sc_core::sc_signal<bool> *> m_signals;
+    /// Names of the frame signals some model drives
+    std::set<std::string> m_driven;
+    std::map<std::string, sc_core::sc_signal<uint32_t> *> m_rows;
+    std::map<std::string, sc_core::sc_signal<char> *> m_keys;
+    /// Grayframers by name, sources of frame descriptors
+    std::map<std::string, AHBGrayframer *> m_grayframers;
+    /// Grayframers without an upstream grayframer
+    std::set<std::string> m_heads;
+};
+
+#endif  // MODELS_PLATFORMBUILDER_PLATFORMBUILDER_H_
+/// @}
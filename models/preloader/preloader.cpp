@@ -0,0 +1,130 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup preloader
+/// @{
+/// @file preloader.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/preloader/preloader.h"
+#include "core/common/verbose.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+/// Bytes read from a file and written per debug transfer
+#define PRELOADER_CHUNK 65536
+
+Preloader::Preloader(ModuleName name,
+  uint32_t hindex,
+  const std::string &files,
+  AbstractionLayer ambaLayer) :
+  AHBMaster<>(name,
+    hindex,
+    0x03,
+    0x00B,
+    0,
+    0,
+    ambaLayer,
+    BAR(), BAR(), BAR(), BAR()),
+  m_bytes(0),
+  m_invalid(false) {
+  if (!parse(files)) {
+    m_entries.clear();
+    m_invalid = true;
+  }
+  SC_THREAD(preload);
+}
+
+// file@address[:row_bytes:stride], entries separated by commas
+bool Preloader::parse(const std::string &files) {
+  size_t start = 0;
+  while (start < files.size()) {
+    size_t end = files.find(',', start);
+    if (end == std::string::npos) {
+      end = files.size();
+    }
+    std::string item = files.substr(start, end - start);
+    start = end + 1;
+    if (item.empty()) {
+      continue;
+    }
+    size_t at = item.rfind('@');
+    if (at == std::string::npos || at == 0) {
+      v::error << name() << "Preload entry " << item << " is not file@address" << v::endl;
+      return false;
+    }
+    Entry entry = { item.substr(0, at), 0, 0, 0 };
+    const char *spec = item.c_str() + at + 1;
+    char *rest;
+    entry.addr = strtoul(spec, &rest, 0);
+    if (*rest == ':') {
+      entry.row = strtoul(rest + 1, &rest, 0);
+      if (*rest == ':') {
+        entry.stride = strtoul(rest + 1, &rest, 0);
+      }
+      if (!entry.row || entry.stride < entry.row) {
+        v::error << name() << "Preload entry " << item << " needs row_bytes and a stride of at least that" << v::endl;
+        return false;
+      }
+    }
+    if (rest == spec || *rest) {
+      v::error << name() << "Invalid address in preload entry " << item << v::endl;
+      return false;
+    }
+    m_entries.push_back(entry);
+  }
+  return true;
+}
+
+bool Preloader::load(const Entry &entry) {
+  FILE *file = fopen(entry.file.c_str(), "rb");
+  if (!file) {
+    v::error << name() << "Cannot open preload file " << entry.file << v::endl;
+    return false;
+  }
+  std::vector<uint8_t> data(entry.row ? entry.row : PRELOADER_CHUNK);
+  uint32_t addr = entry.addr;
+  uint64_t bytes = 0;
+  size_t length;
+  bool ok = true;
+  while ((length = fread(&data[0], 1, data.size(), file)) > 0) {
+    if (ahbwrite_dbg(addr, &data[0], length) != length) {
+      ok = false;
+      break;
+    }
+    addr += entry.row ? entry.stride : length;
+    bytes += length;
+  }
+  fclose(file);
+  if (!ok) {
+    v::error << name() << "No memory takes " << entry.file << " at " << v::uint32 << addr << v::endl;
+    return false;
+  }
+  m_bytes += bytes;
+  v::info << name() << "Preloaded " << entry.file << " (" << bytes << " bytes) at "
+          << v::uint32 << entry.addr << v::endl;
+  return true;
+}
+
+// Loads at time 0. In a process the bus decoders are set up.
+void Preloader::preload() {
+  bool ok = !m_invalid;
+  for (size_t i = 0; ok && i < m_entries.size(); i++) {
+    ok = load(m_entries[i]);
+  }
+  if (!ok) {
+    // the processors stay in reset, loaded is never notified
+    v::error << name() << "Preload failed, stopping the simulation" << v::endl;
+    sc_core::sc_stop();
+    return;
+  }
+  loaded.notify(sc_core::SC_ZERO_TIME);
+}
+
+/// @}
@@ -0,0 +1,76 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup preloader
+/// @{
+/// @file preloader.h
+/// Loads files into the memories of a platform before software runs.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_PRELOADER_PRELOADER_H_
+#define MODELS_PRELOADER_PRELOADER_H_
+
+#include <amba.h>
+#include <string>
+#include <vector>
+
+#include "core/common/base.h"
+#include "core/common/ahbmaster.h"
+#include "core/common/clkdevice.h"
+
+/// Writes raw binary or YUV files into memory at time 0 with debug
+/// transfers, which take no simulated time and reach every slave on the
+/// bus (AHBMem, SRAM and SDRAM behind the MCtrl). Software finds its images
+/// in place instead of copying them at boot.
+///
+/// The files are given as a comma separated list of
+/// file@address[:row_bytes:stride]. With a row length the file is placed
+/// row by row, stride bytes apart, e.g. into a window of a larger frame.
+/// A list that cannot be parsed or a file that cannot be loaded stops the
+/// simulation, software would run on missing data otherwise.
+class Preloader : public AHBMaster<>, public CLKDevice {
+  public:
+    SC_HAS_PROCESS(Preloader);
+
+    /// Notified one delta after the files are loaded, hold the processors
+    /// in reset until then
+    sc_core::sc_event loaded;
+
+    Preloader(ModuleName name,
+      uint32_t hindex,
+      const std::string &files,
+      AbstractionLayer ambaLayer = amba::amba_LT);
+
+    /// Bytes written so far
+    uint64_t bytes() const { return m_bytes; }
+
+    sc_core::sc_time get_clock() { return clock_cycle; }
+
+  private:
+    struct Entry {
+      std::string file;
+      uint32_t addr;
+      uint32_t row;
+      uint32_t stride;
+    };
+
+    /// Parse the list of files, false on syntax errors
+    bool parse(const std::string &files);
+
+    /// Write one file, false if it cannot be read or is not covered by a slave
+    bool load(const Entry &entry);
+
+    void preload();
+
+    std::vector<Entry> m_entries;
+    uint64_t m_bytes;
+    /// The list of files could not be parsed
+    bool m_invalid;
+};
+
+#endif  // MODELS_PRELOADER_PRELOADER_H_
+/// @}
@@ -0,0 +1,96 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup processprofiler
+/// @{
+/// @file processprofiler.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/processprofiler/processprofiler.h"
+#include "core/common/verbose.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+bool ProcessProfiler::s_enabled = false;
+uint64_t ProcessProfiler::s_start_ns = 0;
+uint64_t ProcessProfiler::s_resumed_ns = 0;
+ProcessProfile *ProcessProfiler::s_running = NULL;
+std::map<const sc_core::sc_object *, ProcessProfile> ProcessProfiler::s_profiles;
+
+ProcessProfile *ProcessProfiler::current_profile() {
+  if (!s_enabled) {
+    return NULL;
+  }
+  return &s_profiles[sc_core::sc_get_current_process_handle().get_process_object()];
+}
+
+typedef std::pair<std::string, ProcessProfile> NamedProfile;
+
+static bool by_host_time(const NamedProfile &a, const NamedProfile &b) {
+  return a.second.host_ns > b.second.host_ns;
+}
+
+static std::string profile_line(const NamedProfile &p, double total_ms) {
+  const ProcessProfile &s = p.second;
+  double ms = s.host_ns / 1e6;
+  std::ostringstream line;
+  line << std::left << std::setw(40) << p.first << std::right
+       << std::setw(12) << s.activations << std::setw(10) << s.deltas
+       << std::fixed << std::setprecision(3) << std::setw(12) << ms
+       << std::setw(10) << (s.activations ? s.host_ns / 1e3 / s.activations : 0.0)
+       << std::setprecision(1) << std::setw(7) << (total_ms > 0.0 ? 100.0 * ms / total_ms : 0.0) << "%";
+  return line.str();
+}
+
+void ProcessProfiler::report(unsigned int top) {
+  if (!s_enabled) {
+    return;
+  }
+  uint64_t total_ns = now_ns() - s_start_ns;
+  double total_ms = total_ns / 1e6;
+  std::vector<NamedProfile> processes;
+  std::map<std::string, ProcessProfile> modules;
+  uint64_t profiled_ns = 0;
+  for (std::map<const sc_core::sc_object *, ProcessProfile>::iterator it = s_profiles.begin();
+       it != s_profiles.end(); ++it) {
+    const sc_core::sc_object *process = it->first;
+    const ProcessProfile &s = it->second;
+    processes.push_back(NamedProfile(process->name(), s));
+    ProcessProfile &m = modules[process->get_parent_object() ? process->get_parent_object()->name() : ""];
+    m.activations += s.activations;
+    m.deltas += s.deltas;
+    m.host_ns += s.host_ns;
+    profiled_ns += s.host_ns;
+  }
+  std::sort(processes.begin(), processes.end(), by_host_time);
+  std::vector<NamedProfile> per_module(modules.begin(), modules.end());
+  std::sort(per_module.begin(), per_module.end(), by_host_time);
+
+  const char *header = "                                         activations    deltas     host ms   us/act   share";
+  v::info << "ProcessProfiler" << "Top " << top << " of " << processes.size() << " processes, "
+          << sc_core::sc_delta_count() << " delta cycles, " << total_ms << " ms host time" << v::endl;
+  v::info << "ProcessProfiler" << header << v::endl;
+  for (size_t i = 0; i < processes.size() && i < top; i++) {
+    v::info << "ProcessProfiler" << profile_line(processes[i], total_ms) << v::endl;
+  }
+  v::info << "ProcessProfiler" << "Per module" << v::endl;
+  v::info << "ProcessProfiler" << header << v::endl;
+  for (size_t i = 0; i < per_module.size(); i++) {
+    v::info << "ProcessProfiler" << profile_line(per_module[i], total_ms) << v::endl;
+  }
+  // Everything that is not inside an instrumented process: the scheduler,
+  // uninstrumented processes and the elaboration before enable().
+  ProcessProfile rest;
+  rest.host_ns = total_ns - std::min(profiled_ns, total_ns);
+  v::info << "ProcessProfiler" << profile_line(NamedProfile("(kernel and other processes)", rest), total_ms) << v::endl;
+}
+
+/// @}
@@ -0,0 +1,121 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup processprofiler
+/// @{
+/// @file processprofiler.h
+/// Activation counts and host time per SystemC process.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_PROCESSPROFILER_PROCESSPROFILER_H_
+#define MODELS_PROCESSPROFILER_PROCESSPROFILER_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <map>
+
+#include "core/common/systemc.h"
+
+/// Profile the enclosing SC_METHOD or SC_THREAD. Place it first in the
+/// process function. Threads suspend through ProcessProfiler::wait so the
+/// time they are suspended is not charged to them and every resume counts
+/// as an activation.
+#define PROFILE_PROCESS() ProcessProfiler::Scope process_profiler_scope_
+
+/// Counters of one process
+struct ProcessProfile {
+  ProcessProfile() : activations(0), deltas(0), last_delta(~0ull), host_ns(0) {}
+
+  uint64_t activations;
+  /// Number of distinct delta cycles the process ran in
+  uint64_t deltas;
+  uint64_t last_delta;
+  uint64_t host_ns;
+};
+
+/// Collects the profiles of all instrumented processes. The profiler is
+/// disabled by default, all hooks return immediately then.
+///
+/// SystemC runs one process at a time, so the profiler keeps the profile
+/// of the running process and charges the host time since its activation
+/// when it returns (methods) or suspends (threads).
+class ProcessProfiler {
+  public:
+    /// RAII activation of the calling process
+    class Scope {
+      public:
+        Scope() { ProcessProfiler::resume(ProcessProfiler::current_profile()); }
+        ~Scope() { ProcessProfiler::suspend(ProcessProfiler::s_running); }
+    };
+
+    static void enable() { s_enabled = true; s_start_ns = now_ns(); }
+    static bool enabled() { return s_enabled; }
+
+    /// Suspend the calling thread through sc_core::wait, uncharged.
+    template<class T>
+    static void wait(const T &arg) {
+      ProcessProfile *profile = current_profile();
+      suspend(profile);
+      sc_core::wait(arg);
+      resume(profile);
+    }
+
+    template<class T1, class T2>
+    static void wait(const T1 &arg1, const T2 &arg2) {
+      ProcessProfile *profile = current_profile();
+      suspend(profile);
+      sc_core::wait(arg1, arg2);
+      resume(profile);
+    }
+
+    /// Print the top processes by host time and the totals per module.
+    static void report(unsigned int top);
+
+  private:
+    /// Profile of the calling process, created on first use
+    static ProcessProfile *current_profile();
+
+    static void resume(ProcessProfile *profile) {
+      s_running = NULL;
+      if (!profile) {
+        return;
+      }
+      uint64_t delta = sc_core::sc_delta_count();
+      profile->activations++;
+      if (profile->last_delta != delta) {
+        profile->last_delta = delta;
+        profile->deltas++;
+      }
+      s_running = profile;
+      s_resumed_ns = now_ns();
+    }
+
+    /// Charge the host time since the last activation. If another process
+    /// was activated meanwhile, the caller was suspended by a plain wait
+    /// and the time is dropped rather than charged to the wrong process.
+    static void suspend(ProcessProfile *profile) {
+      if (profile && profile == s_running) {
+        profile->host_ns += now_ns() - s_resumed_ns;
+        s_running = NULL;
+      }
+    }
+
+    static uint64_t now_ns() {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+    }
+
+    static bool s_enabled;
+    static uint64_t s_start_ns;
+    static uint64_t s_resumed_ns;
+    static ProcessProfile *s_running;
+    static std::map<const sc_core::sc_object *, ProcessProfile> s_profiles;
+};
+
+#endif  // MODELS_PROCESSPROFILER_PROCESSPROFILER_H_
+/// @}
@@ -0,0 +1,133 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup runcontrol
+/// @{
+/// @file runcontrol.cpp
+///
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#include "models/runcontrol/runcontrol.h"
+#include "core/common/verbose.h"
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <fstream>
+
+static double runcontrol_wall() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static double runcontrol_cpu(long *peak_rss_kb = NULL) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  if (peak_rss_kb) {
+    *peak_rss_kb = usage.ru_maxrss;  // kilobytes on Linux
+  }
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+}
+
+RunControl::RunControl(sc_core::sc_module_name name,
+  uint32_t max_frames,
+  sc_core::sc_time max_time) :
+  sc_core::sc_module(name),
+  m_max_frames(max_frames),
+  m_max_time(max_time),
+  m_frames(0),
+  m_wall_start(0.0), m_wall(0.0),
+  m_cpu_start(0.0), m_cpu(0.0),
+  m_peak_rss_kb(0) {
+  SC_METHOD(count_frame);
+  sensitive << frameIn;
+  dont_initialize();
+
+  SC_THREAD(time_limit);
+}
+
+void RunControl::end_of_elaboration() {
+  if (m_max_frames && !frameIn.size()) {
+    v::warn << name() << "Frame limit set but no frame signal bound" << v::endl;
+  }
+}
+
+void RunControl::count_frame() {
+  m_frames++;
+  if (m_max_frames && m_frames == m_max_frames) {
+    v::info << name() << "Stopping after " << m_frames << " frames" << v::endl;
+    sc_core::sc_stop();
+  }
+}
+
+void RunControl::time_limit() {
+  if (m_max_time == sc_core::SC_ZERO_TIME) {
+    return;
+  }
+  wait(m_max_time);
+  v::info << name() << "Stopping after " << m_max_time << v::endl;
+  sc_core::sc_stop();
+}
+
+void RunControl::start() {
+  m_wall_start = runcontrol_wall();
+  m_cpu_start = runcontrol_cpu();
+}
+
+void RunControl::stop() {
+  m_wall = runcontrol_wall() - m_wall_start;
+  m_cpu = runcontrol_cpu(&m_peak_rss_kb) - m_cpu_start;
+}
+
+void RunControl::write_summary(const std::string &file, const std::string &platform) {
+  double sim = sc_core::sc_time_stamp().to_seconds();
+  double ratio = m_wall > 0.0 ? sim / m_wall : 0.0;
+  double fps = m_wall > 0.0 ? m_frames / m_wall : 0.0;
+
+  v::info << "Summary" << "Wall time:      " << m_wall << " s" << v::endl;
+  v::info << "Summary" << "CPU time:       " << m_cpu << " s" << v::endl;
+  v::info << "Summary" << "Simulated time: " << sim << " s" << v::endl;
+  v::info << "Summary" << "Speed ratio:    " << ratio << v::endl;
+  v::info << "Summary" << "Frames:         " << m_frames << " (" << fps << " per host second)" << v::endl;
+  v::info << "Summary" << "Peak RSS:       " << m_peak_rss_kb << " kB" << v::endl;
+
+  if (file.empty()) {
+    return;
+  }
+  bool csv = file.size() > 4 && file.compare(file.size() - 4, 4, ".csv") == 0;
+  bool header = false;
+  if (csv) {
+    std::ifstream existing(file.c_str());
+    header = !existing || existing.peek() == std::ifstream::traits_type::eof();
+  }
+  std::ofstream out(file.c_str(), csv ? std::ios::app : std::ios::trunc);
+  if (!out) {
+    v::error << name() << "Cannot write summary to " << file << v::endl;
+    return;
+  }
+  out.precision(9);
+  if (csv) {
+    if (header) {
+      out << "platform,wall_s,cpu_s,sim_s,speed_ratio,frames,frames_per_host_s,peak_rss_kb" << std::endl;
+    }
+    out << platform << "," << m_wall << "," << m_cpu << "," << sim << "," << ratio << ","
+        << m_frames << "," << fps << "," << m_peak_rss_kb << std::endl;
+  } else {
+    out << "{" << std::endl
+        << "  \"platform\": \"" << platform << "\"," << std::endl
+        << "  \"wall_s\": " << m_wall << "," << std::endl
+        << "  \"cpu_s\": " << m_cpu << "," << std::endl
+        << "  \"sim_s\": " << sim << "," << std::endl
+        << "  \"speed_ratio\": " << ratio << "," << std::endl
+        << "  \"frames\": " << m_frames << "," << std::endl
+        << "  \"frames_per_host_s\": " << fps << "," << std::endl
+        << "  \"peak_rss_kb\": " << m_peak_rss_kb << std::endl
+        << "}" << std::endl;
+  }
+}
+
+/// @}
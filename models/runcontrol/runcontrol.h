@@ -0,0 +1,67 @@
+// vim : set fileencoding=utf-8 expandtab noai ts=4 sw=4 :
+/// @addtogroup runcontrol
+/// @{
+/// @file runcontrol.h
+/// Bounded simulation runs and machine readable run statistics.
+///
+/// @date 2013-2015
+/// @copyright All rights reserved.
+///            Any reproduction, use, distribution or disclosure of this
+///            program, without the express, prior written consent of the
+///            authors is strictly prohibited.
+/// @author Bastian Farkas
+///
+#ifndef MODELS_RUNCONTROL_RUNCONTROL_H_
+#define MODELS_RUNCONTROL_RUNCONTROL_H_
+
+#include <string>
+
+#include "core/common/systemc.h"
+
+/// Stops the simulation after a number of frames or an amount of simulated
+/// time and summarizes the run for batch throughput tracking.
+///
+/// Frames are counted as toggles of frameIn. The platform calls start()
+/// right before and stop() right after sc_start().
+class RunControl : public sc_core::sc_module {
+  public:
+    SC_HAS_PROCESS(RunControl);
+
+    /// Frame signal of the last pipeline stage, may stay unbound
+    sc_core::sc_port<sc_core::sc_signal_in_if<bool>, 1, sc_core::SC_ZERO_OR_MORE_BOUND> frameIn;
+
+    /// A limit of 0 frames or SC_ZERO_TIME disables that limit.
+    RunControl(sc_core::sc_module_name name,
+      uint32_t max_frames,
+      sc_core::sc_time max_time);
+
+    /// Take the host time and resource usage at the start of the run
+    void start();
+
+    /// Take the host time and resource usage at the end of the run
+    void stop();
+
+    /// Print the summary and write it to file (CSV if the name ends in
+    /// .csv, JSON otherwise). CSV files get one line appended per run.
+    void write_summary(const std::string &file, const std::string &platform);
+
+    uint32_t frames() const { return m_frames; }
+
+  private:
+    void end_of_elaboration();
+    void count_frame();
+    void time_limit();
+
+    uint32_t m_max_frames;
+    sc_core::sc_time m_max_time;
+    uint32_t m_frames;
+
+    double m_wall_start;
+    double m_wall;
+    double m_cpu_start;
+    double m_cpu;
+    long m_peak_rss_kb;
+};
+
+#endif  // MODELS_RUNCONTROL_RUNCONTROL_H_
+/// @}
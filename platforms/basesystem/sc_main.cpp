@@ -41,8 +41,17 @@
 #ifdef HAVE_AHBCAMERA
 #include "cuselab/models/ahbcamera/ahbcamera.h"
 #endif
+#include "cuselab/models/ahbfilecamera/ahbfilecamera.h"
 #include "cuselab/models/ahbgrayframer/ahbgrayframer.h"
+#include "cuselab/models/runcontrol/runcontrol.h"
+#include "cuselab/models/preloader/preloader.h"
+#include "cuselab/models/ahbmonitor/ahbmonitor.h"
+#include "cuselab/models/processprofiler/processprofiler.h"
+#include "cuselab/models/platformbuilder/platformbuilder.h"
+#include "cuselab/models/ahbscaler/ahbscaler.h"
 #include "cuselab/models/ahbframetrigger/ahbframetrigger.h"
+#include "cuselab/models/ahbdemosoftware/ahbdemosoftware.h"
+#include "cuselab/models/ahbstatistics/ahbstatistics.h"
 
 using namespace std;
 using namespace sc_core;
@@ -75,12 +84,23 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_system_clock("clk", 10.0, p_system);
     gs::gs_param<std::string> p_system_osemu("osemu", "", p_system);
     gs::gs_param<std::string> p_system_log("log", "", p_system);
+    gs::gs_param<unsigned int> p_system_frames("frames", 0u, p_system);
+    gs::gs_param<unsigned int> p_system_time("time", 0u, p_system);
+    // Temporal decoupling of the video masters in us, 0 syncs after every 2D transfer
+    gs::gs_param<unsigned int> p_system_quantum("quantum", 0u, p_system);
+    tlm::tlm_global_quantum::instance().set(sc_core::sc_time(p_system_quantum, SC_US));
+    // JSON description of the memories and the video pipeline, empty keeps the built-in topology
+    gs::gs_param<std::string> p_system_platform("platform", "", p_system);
+    bool builtin = ((std::string)p_system_platform).empty();
 
     gs::gs_param_array p_report("report", p_conf);
     gs::gs_param<bool> p_report_timing("timing", true, p_report);
     gs::gs_param<bool> p_report_power("power", true, p_report);
+    gs::gs_param<std::string> p_report_summary("summary", "", p_report);
+    gs::gs_param<unsigned int> p_report_profile("profile", 0u, p_report);  // top n processes, 0 disables
+    gs::gs_param<std::string> p_report_latency("latency", "", p_report);  // per frame latency CSV of the display
    
-    sc_signal<bool> cameraFrameSignal,gray0FrameSignal;
+    sc_signal<bool> cameraFrameSignal,gray0FrameSignal,scalerFrameSignal,displayFrameSignal,demoFrameSignal,statisticsFrameSignal;
     sc_signal<char> keyCodeSignal;
     
     uint32_t videoWidth = 320;
@@ -132,6 +152,25 @@ int sc_main(int argc, char** argv) {
     // Set clock
     ahbctrl.set_clk(p_system_clock, SC_NS);
 
+    // AHBMonitor
+    // ==========
+    // Optional per master bandwidth and latency accounting.
+    // Masters are bound to ahbctrl through a tap when enabled or tracing.
+    gs::gs_param_array p_ahbmonitor("ahbmonitor", p_conf);
+    gs::gs_param<bool> p_ahbmonitor_en("en", false, p_ahbmonitor);
+    gs::gs_param<unsigned int> p_ahbmonitor_period("period", 0u, p_ahbmonitor);
+    gs::gs_param<std::string> p_ahbmonitor_trace("trace", "", p_ahbmonitor);
+    AHBMonitor *ahbmonitor = NULL;
+    if(p_ahbmonitor_en || !((std::string)p_ahbmonitor_trace).empty()) {
+      ahbmonitor = new AHBMonitor("ahbmonitor",
+        sc_core::sc_time(p_ahbmonitor_period, SC_MS),  // report period, 0 reports at the end only
+        ambaLayer
+      );
+      if(!((std::string)p_ahbmonitor_trace).empty()) {
+        ahbmonitor->trace(p_ahbmonitor_trace);  // binary transaction trace, see ahbtrace
+      }
+    }
+
     // AHBSlave - APBCtrl
     // ==================
 
@@ -154,6 +193,19 @@ int sc_main(int argc, char** argv) {
     ahbctrl.ahbOUT(apbctrl.ahb);
     apbctrl.set_clk(p_system_clock, SC_NS);
 
+    // PlatformBuilder
+    // ===============
+    // Replaces the memory and video model blocks below when system.platform is set
+    PlatformBuilder *builder = NULL;
+    if(!builtin) {
+      builder = new PlatformBuilder(ahbctrl, apbctrl, ahbmonitor, p_system_clock, ambaLayer, p_report_power);
+      if(!builder->build(p_system_platform)) {
+        return 1;
+      }
+    }
+    // Frame signal of the last pipeline stage
+    sc_signal<bool> &frameSignal = builtin ? gray0FrameSignal : builder->signal(builder->frames());
+
     // AHBSlave - AHBMem
     // =================
     gs::gs_param_array p_ahbmem("ahbmem", p_conf);
@@ -165,7 +217,7 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_ahbmem_waitstates("waitstates", 0u, p_ahbmem);
     gs::gs_param<std::string> p_ahbmem_elf("elf", "", p_ahbmem);
 
-    if(p_ahbmem_en) {
+    if(builtin && p_ahbmem_en) {
 
       AHBMem *ahbmem = new AHBMem("ahbmem",
                                   p_ahbmem_addr,
@@ -189,18 +241,32 @@ int sc_main(int argc, char** argv) {
     gs::gs_param_array p_ahbframetrigger("ahbframetrigger", p_conf);
     gs::gs_param<bool> p_ahbframetrigger_en("en", true, p_ahbframetrigger);
     gs::gs_param<unsigned int> p_ahbframetrigger_index("index", 1, p_ahbframetrigger);
-    gs::gs_param<unsigned int> p_ahbframetrigger_interval("interval", 1, p_ahbframetrigger);
-    if(p_ahbframetrigger_en) {
-        AHBFrameTrigger *ahbframetrigger = new AHBFrameTrigger("ahbframetrigger",
+    gs::gs_param<unsigned int> p_ahbframetrigger_interval("interval", 40, p_ahbframetrigger);
+    gs::gs_param<std::string> p_ahbframetrigger_stimulus("stimulus", "", p_ahbframetrigger);
+    gs::gs_param<unsigned int> p_ahbframetrigger_inflight("inflight", 0u, p_ahbframetrigger);
+    gs::gs_param<std::string> p_ahbframetrigger_stages("stages", "camera,gray0,display", p_ahbframetrigger);
+    AHBFrameTrigger *ahbframetrigger = NULL;
+    if(builtin && p_ahbframetrigger_en) {
+        ahbframetrigger = new AHBFrameTrigger("ahbframetrigger",
           p_ahbframetrigger_index,
           sc_core::sc_time(p_ahbframetrigger_interval, SC_MS),
           p_report_power,
-          ambaLayer
+          ambaLayer,
+          p_ahbframetrigger_stimulus
       );
 
       // Connect sensor to bus
-      ahbframetrigger->ahb(ahbctrl.ahbIN);
+      AHBMonitor::connect(ahbmonitor, *ahbframetrigger, ahbctrl.ahbIN);
       ahbframetrigger->set_clk(p_system_clock, SC_NS);
+      // Frame signals the stimulus can wait for
+      ahbframetrigger->watch("camera", cameraFrameSignal);
+      ahbframetrigger->watch("gray0", gray0FrameSignal);
+      ahbframetrigger->watch("scaler", scalerFrameSignal);
+      ahbframetrigger->watch("display", displayFrameSignal);
+      ahbframetrigger->watch("demo", demoFrameSignal);
+      ahbframetrigger->watch("statistics", statisticsFrameSignal);
+      // inflight > 0 kicks the camera as soon as a frame leaves the last stage
+      ahbframetrigger->closed_loop(p_ahbframetrigger_inflight, p_ahbframetrigger_stages);
     }
 
 #ifdef HAVE_AHBDISPLAY
@@ -213,7 +279,7 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_ahbdisplay_paddr("paddr", 0x500, p_ahbdisplay);
     gs::gs_param<unsigned int> p_ahbdisplay_pmask("pmask", 0xFFF, p_ahbdisplay);
     AHBDisplay *ahbdisplay;
-    if(p_ahbdisplay_en) {
+    if(builtin && p_ahbdisplay_en) {
       ahbdisplay = new AHBDisplay("ahbdisplay",
         p_ahbdisplay_index,  // ahb index
         p_ahbdisplay_pindex,  // apb index
@@ -224,13 +290,55 @@ int sc_main(int argc, char** argv) {
       );
 
       // Connecting APB Slave
-      ahbdisplay->ahb(ahbctrl.ahbIN);
+      AHBMonitor::connect(ahbmonitor, *ahbdisplay, ahbctrl.ahbIN);
       apbctrl.apb(ahbdisplay->apb);
       ahbdisplay->set_clk(p_system_clock,SC_NS);
       ahbdisplay->triggerIn(gray0FrameSignal);
+      ahbdisplay->triggerOut(displayFrameSignal);
       ahbdisplay->keyboardOut(keyCodeSignal);
+      if(!((std::string)p_report_latency).empty()) {
+        ahbdisplay->latency_csv(p_report_latency);
+      }
     }
 #endif
+    // AHBFileCamera - AHBMaster
+    // ==================
+    // Streams raw YUV 4:2:2 or Y4M frames from a file instead of AHBCamera,
+    // used whenever a video is given
+    gs::gs_param_array p_ahbfilecamera("ahbfilecamera", p_conf);
+    gs::gs_param<std::string> p_ahbfilecamera_video("video", "", p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_hindex("hindex", 3, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_pindex("pindex", 5, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_paddr("paddr", 0x501, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_pmask("pmask", 0xFFF, p_ahbfilecamera);
+    gs::gs_param<bool> p_ahbfilecamera_loop("loop", true, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_decimate("decimate", 1, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_width("width", 320, p_ahbfilecamera);  // raw files only
+    gs::gs_param<unsigned int> p_ahbfilecamera_height("height", 240, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_prefetch("prefetch", 4, p_ahbfilecamera);
+    bool filecamera = !((std::string)p_ahbfilecamera_video).empty();
+    if(builtin && filecamera) {
+      AHBFileCamera *ahbfilecamera = new AHBFileCamera("ahbfilecamera",
+        p_ahbfilecamera_hindex,  // ahb index
+        p_ahbfilecamera_pindex,  // apb index
+        p_ahbfilecamera_paddr,   // apb addr
+        p_ahbfilecamera_pmask,   // apb mask
+        frameWidth, frameHeight,
+        ((std::string)p_ahbfilecamera_video).c_str(),
+        ambaLayer,
+        p_ahbfilecamera_loop,
+        p_ahbfilecamera_decimate,
+        p_ahbfilecamera_width, p_ahbfilecamera_height,
+        p_ahbfilecamera_prefetch
+      );
+
+      // Connecting APB Slave
+      AHBMonitor::connect(ahbmonitor, *ahbfilecamera, ahbctrl.ahbIN);
+      apbctrl.apb(ahbfilecamera->apb);
+      ahbfilecamera->set_clk(p_system_clock,SC_NS);
+      // Connecting FrameTrigger Port
+      ahbfilecamera->triggerOut(cameraFrameSignal);
+    }
 #ifdef HAVE_AHBCAMERA
     // AHBCamera - AHBMaster
     // ==================
@@ -241,7 +349,7 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_ahbcamera_paddr("paddr", 0x501, p_ahbcamera);
     gs::gs_param<unsigned int> p_ahbcamera_pmask("pmask", 0xFFF, p_ahbcamera);
     gs::gs_param<std::string> p_ahbcamera_video("video", "bigbuckbunny_small_short.m2v", p_ahbcamera);
-    if(p_ahbcamera_en) {
+    if(builtin && p_ahbcamera_en && !filecamera) {
       AHBCamera *ahbcamera = new AHBCamera("ahbcamera",
         p_ahbcamera_hindex,  // ahb index
         p_ahbcamera_pindex,  // apb index
@@ -253,7 +361,7 @@ int sc_main(int argc, char** argv) {
       );
 
       // Connecting APB Slave
-      ahbcamera->ahb(ahbctrl.ahbIN);
+      AHBMonitor::connect(ahbmonitor, *ahbcamera, ahbctrl.ahbIN);
       apbctrl.apb(ahbcamera->apb);
       ahbcamera->set_clk(p_system_clock,SC_NS);
       // Connecting FrameTrigger Port
@@ -269,7 +377,7 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_ahbgrayframer0_pindex("pindex", 6, p_ahbgrayframer0);
     gs::gs_param<unsigned int> p_ahbgrayframer0_paddr("paddr", 0x502, p_ahbgrayframer0);
     gs::gs_param<unsigned int> p_ahbgrayframer0_pmask("pmask", 0xFFF, p_ahbgrayframer0);
-    if(p_ahbgrayframer0_en) {
+    if(builtin && p_ahbgrayframer0_en) {
       AHBGrayframer *ahbgrayframer0 = new AHBGrayframer("ahbgrayframer0",
         p_ahbgrayframer0_hindex,  // ahb index
         p_ahbgrayframer0_pindex,  // apb index
@@ -284,11 +392,124 @@ int sc_main(int argc, char** argv) {
       );
 
       // Connecting APB Slave
-      ahbgrayframer0->ahb(ahbctrl.ahbIN);
+      AHBMonitor::connect(ahbmonitor, *ahbgrayframer0, ahbctrl.ahbIN);
       apbctrl.apb(ahbgrayframer0->apb);
       ahbgrayframer0->set_clk(p_system_clock,SC_NS);
       ahbgrayframer0->triggerIn(cameraFrameSignal);
       ahbgrayframer0->triggerOut(gray0FrameSignal);
+      if(ahbframetrigger) {
+        // frames are stamped when the camera is kicked
+        sr_signal::connect(ahbframetrigger->frameOut, ahbgrayframer0->stampIn);
+      }
+#ifdef HAVE_AHBDISPLAY
+      if(builtin && p_ahbdisplay_en) {
+        // the display takes the frame descriptors, the toggle stays for the frame counting
+        sr_signal::connect(ahbgrayframer0->frameOut, ahbdisplay->frameIn);
+      }
+#endif
+    }
+
+    // AHBScaler - AHBMaster
+    // ==================
+    gs::gs_param_array p_ahbscaler("ahbscaler", p_conf);
+    gs::gs_param<bool> p_ahbscaler_en("en", false, p_ahbscaler);
+    gs::gs_param<unsigned int> p_ahbscaler_hindex("hindex", 5, p_ahbscaler);
+    gs::gs_param<unsigned int> p_ahbscaler_pindex("pindex", 7, p_ahbscaler);
+    gs::gs_param<unsigned int> p_ahbscaler_paddr("paddr", 0x503, p_ahbscaler);
+    gs::gs_param<unsigned int> p_ahbscaler_pmask("pmask", 0xFFF, p_ahbscaler);
+    gs::gs_param<bool> p_ahbscaler_bilinear("bilinear", true, p_ahbscaler);
+    if(builtin && p_ahbscaler_en) {
+      AHBScaler *ahbscaler = new AHBScaler("ahbscaler",
+        p_ahbscaler_hindex,  // ahb index
+        p_ahbscaler_pindex,  // apb index
+        p_ahbscaler_paddr,   // apb addr
+        p_ahbscaler_pmask,   // apb mask
+        0,0,
+        videoWidth*3/4,frameHeight/4,
+        frameWidth-videoWidth,frameHeight-frameHeight/3,
+        videoWidth,frameHeight/3,
+        frameWidth,
+        p_ahbscaler_bilinear,
+        ambaLayer
+      );
+
+      // Connecting APB Slave
+      AHBMonitor::connect(ahbmonitor, *ahbscaler, ahbctrl.ahbIN);
+      apbctrl.apb(ahbscaler->apb);
+      ahbscaler->set_clk(p_system_clock,SC_NS);
+      ahbscaler->triggerIn(cameraFrameSignal);
+      ahbscaler->triggerOut(scalerFrameSignal);
+    }
+
+    // AHBStatistics - AHBMaster
+    // ==================
+    // Luma histogram of the gray picture, counts once software enables it
+    gs::gs_param_array p_ahbstatistics("ahbstatistics", p_conf);
+    gs::gs_param<bool> p_ahbstatistics_en("en", false, p_ahbstatistics);
+    gs::gs_param<unsigned int> p_ahbstatistics_hindex("hindex", 8, p_ahbstatistics);
+    gs::gs_param<unsigned int> p_ahbstatistics_pindex("pindex", 12, p_ahbstatistics);
+    gs::gs_param<unsigned int> p_ahbstatistics_paddr("paddr", 0x507, p_ahbstatistics);
+    gs::gs_param<unsigned int> p_ahbstatistics_pmask("pmask", 0xFFF, p_ahbstatistics);
+    if(builtin && p_ahbstatistics_en) {
+      AHBStatistics *ahbstatistics = new AHBStatistics("ahbstatistics",
+        p_ahbstatistics_hindex,  // ahb index
+        p_ahbstatistics_pindex,  // apb index
+        p_ahbstatistics_paddr,   // apb addr
+        p_ahbstatistics_pmask,   // apb mask
+        videoWidth,0,
+        videoWidth,frameHeight/3,
+        frameWidth,
+        ambaLayer
+      );
+
+      // Connecting APB Slave
+      AHBMonitor::connect(ahbmonitor, *ahbstatistics, ahbctrl.ahbIN);
+      apbctrl.apb(ahbstatistics->apb);
+      ahbstatistics->set_clk(p_system_clock,SC_NS);
+      ahbstatistics->triggerIn(gray0FrameSignal);
+      ahbstatistics->triggerOut(statisticsFrameSignal);
+    }
+
+    // AHBDemoSoftware - AHBMaster
+    // ==================
+    // Zooms a window of the gray picture and draws its histogram on every
+    // grayframer frame, the window follows the keys of the display
+    gs::gs_param_array p_ahbdemosoftware("ahbdemosoftware", p_conf);
+    gs::gs_param<bool> p_ahbdemosoftware_en("en", false, p_ahbdemosoftware);
+    gs::gs_param<unsigned int> p_ahbdemosoftware_hindex("hindex", 6, p_ahbdemosoftware);
+    if(builtin && p_ahbdemosoftware_en) {
+      AHBDemoSoftware *ahbdemosoftware = new AHBDemoSoftware("ahbdemosoftware",
+        p_ahbdemosoftware_hindex,  // ahb index
+        p_report_power,
+        frameWidth, frameHeight,
+        ambaLayer
+      );
+
+      // Connecting AHB Master
+      AHBMonitor::connect(ahbmonitor, *ahbdemosoftware, ahbctrl.ahbIN);
+      ahbdemosoftware->set_clk(p_system_clock,SC_NS);
+      ahbdemosoftware->keyboardIn(keyCodeSignal);
+      ahbdemosoftware->triggerIn(gray0FrameSignal);
+      ahbdemosoftware->triggerOut(demoFrameSignal);
+    }
+
+    // Preloader - AHBMaster
+    // ==================
+    // Writes files into the memories at time 0, e.g. a test image for the
+    // grayframer: files = "image.yuv@0xA0000000:640:1920"
+    gs::gs_param_array p_preload("preload", p_conf);
+    gs::gs_param<std::string> p_preload_files("files", "", p_preload);
+    gs::gs_param<unsigned int> p_preload_hindex("hindex", 9, p_preload);
+    if(!((std::string)p_preload_files).empty()) {
+      Preloader *preloader = new Preloader("preloader",
+        p_preload_hindex,  // ahb index
+        p_preload_files,
+        ambaLayer
+      );
+
+      // Connecting AHB Master
+      AHBMonitor::connect(ahbmonitor, *preloader, ahbctrl.ahbIN);
+      preloader->set_clk(p_system_clock, SC_NS);
     }
 
     // disable Info messages
@@ -296,17 +517,28 @@ int sc_main(int argc, char** argv) {
 
     (void) signal(SIGINT, stopSimFunction);
     (void) signal(SIGTERM, stopSimFunction);
+    // Bounded runs: stop after system.frames frames or system.time ms simulated time
+    RunControl runcontrol("runcontrol", p_system_frames, sc_core::sc_time(p_system_time, SC_MS));
+    runcontrol.frameIn(frameSignal);
+
     cstart = cend = clock();
     cstart = clock();
+    if(p_report_profile) {
+      ProcessProfiler::enable();
+    }
+    runcontrol.start();
     //mtrace();
 
     sc_core::sc_start();
     //muntrace();
     cend = clock();
+    runcontrol.stop();
+    ProcessProfiler::report(p_report_profile);
 
     v::info << "Summary" << "Start: " << dec << cstart << v::endl;
     v::info << "Summary" << "End:   " << dec << cend << v::endl;
     v::info << "Summary" << "Delta: " << dec << setprecision(4) << ((double)(cend - cstart) / (double)CLOCKS_PER_SEC * 1000) << "ms" << v::endl;
+    runcontrol.write_summary(p_report_summary, "basesystem");
 
     std::cout << "End of sc_main" << std::endl << std::flush;
     return 0;
@@ -24,6 +24,7 @@
 #include "core/common/amba.h"
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <cstring>
 #include <cstdlib>
 #include <stdexcept>
@@ -50,12 +51,33 @@
 #ifdef HAVE_AHBCAMERA
 #include "cuselab/models/ahbcamera/ahbcamera.h"
 #endif
+#include "cuselab/models/ahbfilecamera/ahbfilecamera.h"
 #include "cuselab/models/ahbgrayframer/ahbgrayframer.h"
+#include "cuselab/models/runcontrol/runcontrol.h"
+#include "cuselab/models/ahbmonitor/ahbmonitor.h"
+#include "cuselab/models/processprofiler/processprofiler.h"
+#include "cuselab/models/platformbuilder/platformbuilder.h"
 #include "cuselab/models/apbkeyboard/apbkeyboard.h"
+#include "cuselab/models/ahbzoomer/ahbzoomer.h"
+#include "cuselab/models/apbvideodetail/apbvideodetail.h"
+#include "cuselab/models/apbbuffermanager/apbbuffermanager.h"
+#include "cuselab/models/ahbstatistics/ahbstatistics.h"
+#include "cuselab/models/ahbdma/ahbdma.h"
+#include "cuselab/models/checkpoint/checkpoint.h"
+#include "cuselab/models/preloader/preloader.h"
+#include "cuselab/models/ahbframebuffer/ahbframebuffer.h"
+#include "cuselab/models/lazystorage/lazystorage.h"
 
 using namespace std;
 using namespace sc_core;
 
+// True if two AHB areas (address and mask in MB as for the AHBCtrl) overlap
+static bool ahb_overlap(uint32_t addr1, uint32_t mask1, uint32_t addr2, uint32_t mask2) {
+  uint32_t start1 = addr1 & mask1, end1 = start1 + (~mask1 & 0xFFF) + 1;
+  uint32_t start2 = addr2 & mask2, end2 = start2 + (~mask2 & 0xFFF) + 1;
+  return start1 < end2 && start2 < end1;
+}
+
 void stopSimFunction(int sig) {
   v::warn << "main" << "Simulation interrupted by user" << std::endl;
   sc_core::sc_stop();
@@ -64,16 +86,30 @@ void stopSimFunction(int sig) {
 
 class irqmp_rst_stimuli : sc_core::sc_module {
   public:
+    SC_HAS_PROCESS(irqmp_rst_stimuli);
     sr_signal::signal_out<bool, Irqmp> irqmp_rst;
-    irqmp_rst_stimuli(sc_core::sc_module_name mn) : 
+    // With hold the reset is released only after the event, e.g. a checkpoint restore
+    irqmp_rst_stimuli(sc_core::sc_module_name mn, sc_core::sc_event *hold = NULL) : 
         sc_core::sc_module(mn), 
-        irqmp_rst("rst") {
-
+        irqmp_rst("rst"),
+        m_hold(hold) {
+      if(m_hold) {
+        SC_THREAD(release);
+      }
     }
     void start_of_simulation() {
+      if(!m_hold) {
+        irqmp_rst.write(0);
+        irqmp_rst.write(1);
+      }
+    }
+    void release() {
+      wait(*m_hold);
       irqmp_rst.write(0);
       irqmp_rst.write(1);
     }
+  private:
+    sc_core::sc_event *m_hold;
 };
 
 int sc_main(int argc, char** argv) {
@@ -86,6 +122,7 @@ int sc_main(int argc, char** argv) {
     
     SR_INCLUDE_MODULE(ArrayStorage);
     SR_INCLUDE_MODULE(MapStorage);
+    SR_INCLUDE_MODULE(LazyStorage);
     SR_INCLUDE_MODULE(ReportIO);
     SR_INCLUDE_MODULE(TcpIO);
 
@@ -134,12 +171,23 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_system_clock("clk", 10.0, p_system);
     gs::gs_param<std::string> p_system_osemu("osemu", "", p_system);
     gs::gs_param<std::string> p_system_log("log", "", p_system);
+    gs::gs_param<unsigned int> p_system_frames("frames", 0u, p_system);
+    gs::gs_param<unsigned int> p_system_time("time", 0u, p_system);
+    // Temporal decoupling of the video masters in us, 0 syncs after every 2D transfer
+    gs::gs_param<unsigned int> p_system_quantum("quantum", 0u, p_system);
+    tlm::tlm_global_quantum::instance().set(sc_core::sc_time(p_system_quantum, SC_US));
+    // JSON description of the memories and the video pipeline, empty keeps the built-in topology
+    gs::gs_param<std::string> p_system_platform("platform", "", p_system);
+    bool builtin = ((std::string)p_system_platform).empty();
 
     gs::gs_param_array p_report("report", p_conf);
     gs::gs_param<bool> p_report_timing("timing", true, p_report);
     gs::gs_param<bool> p_report_power("power", true, p_report);
+    gs::gs_param<std::string> p_report_summary("summary", "", p_report);
+    gs::gs_param<unsigned int> p_report_profile("profile", 0u, p_report);  // top n processes, 0 disables
+    gs::gs_param<std::string> p_report_latency("latency", "", p_report);  // per frame latency CSV of the display
    
-    sc_signal<bool> cameraFrameSignal,grayFrameSignal;
+    sc_signal<bool> cameraFrameSignal,grayFrameSignal,zoomFrameSignal,displayFrameSignal,statisticsFrameSignal;
     sc_signal<char> keyCodeSignal;
      
     uint32_t videoWidth = 320;
@@ -191,6 +239,25 @@ int sc_main(int argc, char** argv) {
     // Set clock
     ahbctrl.set_clk(p_system_clock, SC_NS);
 
+    // AHBMonitor
+    // ==========
+    // Optional per master bandwidth and latency accounting.
+    // Masters are bound to ahbctrl through a tap when enabled or tracing.
+    gs::gs_param_array p_ahbmonitor("ahbmonitor", p_conf);
+    gs::gs_param<bool> p_ahbmonitor_en("en", false, p_ahbmonitor);
+    gs::gs_param<unsigned int> p_ahbmonitor_period("period", 0u, p_ahbmonitor);
+    gs::gs_param<std::string> p_ahbmonitor_trace("trace", "", p_ahbmonitor);
+    AHBMonitor *ahbmonitor = NULL;
+    if(p_ahbmonitor_en || !((std::string)p_ahbmonitor_trace).empty()) {
+      ahbmonitor = new AHBMonitor("ahbmonitor",
+        sc_core::sc_time(p_ahbmonitor_period, SC_MS),  // report period, 0 reports at the end only
+        ambaLayer
+      );
+      if(!((std::string)p_ahbmonitor_trace).empty()) {
+        ahbmonitor->trace(p_ahbmonitor_trace);  // binary transaction trace, see ahbtrace
+      }
+    }
+
     // AHBSlave - APBCtrl
     // ==================
 
@@ -271,6 +338,12 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_mctrl_ram_sdram_bsize("bsize", 256, p_mctrl_ram_sdram);
     gs::gs_param<unsigned int> p_mctrl_ram_sdram_width("width", 32, p_mctrl_ram_sdram);
     gs::gs_param<unsigned int> p_mctrl_ram_sdram_cols("cols", 16, p_mctrl_ram_sdram);
+    // Storage of the memories: ArrayStorage, MapStorage or LazyStorage,
+    // which commits pages on first use and reports the touched memory
+    gs::gs_param<std::string> p_mctrl_prom_storage("storage", "ArrayStorage", p_mctrl_prom);
+    gs::gs_param<std::string> p_mctrl_io_storage("storage", "MapStorage", p_mctrl_io);
+    gs::gs_param<std::string> p_mctrl_ram_sram_storage("storage", "MapStorage", p_mctrl_ram_sram);
+    gs::gs_param<std::string> p_mctrl_ram_sdram_storage("storage", "ArrayStorage", p_mctrl_ram_sdram);
     gs::gs_param<unsigned int> p_mctrl_index("index", 0u, p_mctrl);
     gs::gs_param<bool> p_mctrl_ram8("ram8", true, p_mctrl);
     gs::gs_param<bool> p_mctrl_ram16("ram16", true, p_mctrl);
@@ -278,6 +351,28 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<bool> p_mctrl_sepbus("sepbus", false, p_mctrl);
     gs::gs_param<unsigned int> p_mctrl_sdbits("sdbits", 32, p_mctrl);
     gs::gs_param<unsigned int> p_mctrl_mobile("mobile", 0u, p_mctrl);
+    // AHBFrameBuffer - AHBSlave
+    // ==================
+    // Contiguous DMI memory for the video region instead of the MapStorage
+    // SRAM. The RAM area of the MCtrl is narrowed to leave it out.
+    gs::gs_param_array p_framebuffer("framebuffer", p_conf);
+    gs::gs_param<bool> p_framebuffer_en("en", false, p_framebuffer);
+    gs::gs_param<unsigned int> p_framebuffer_addr("addr", 0x500, p_framebuffer);
+    gs::gs_param<unsigned int> p_framebuffer_mask("mask", 0xFF0, p_framebuffer);
+    gs::gs_param<unsigned int> p_framebuffer_index("index", 3, p_framebuffer);
+    gs::gs_param<bool> p_framebuffer_cacheable("cacheable", true, p_framebuffer);
+    gs::gs_param<unsigned int> p_framebuffer_waitstates("waitstates", 0u, p_framebuffer);
+    gs::gs_param<bool> p_framebuffer_hugepages("hugepages", false, p_framebuffer);
+    uint32_t ramMask = p_mctrl_ram_mask;
+    while(p_framebuffer_en && ramMask != 0xFFF &&
+          ahb_overlap(p_mctrl_ram_addr, ramMask, p_framebuffer_addr, p_framebuffer_mask)) {
+      ramMask = (ramMask >> 1) | 0x800;
+    }
+    if(ramMask != p_mctrl_ram_mask) {
+      v::info << "main" << "RAM area of the MCtrl narrowed to mask " << v::uint32 << ramMask
+              << " for the frame buffer" << v::endl;
+    }
+
     Mctrl mctrl( "mctrl",
         p_mctrl_prom_asel,
         p_mctrl_ram_asel,
@@ -286,7 +381,7 @@ int sc_main(int argc, char** argv) {
         p_mctrl_io_addr,
         p_mctrl_io_mask,
         p_mctrl_ram_addr,
-        p_mctrl_ram_mask,
+        ramMask,
         p_mctrl_apb_addr,
         p_mctrl_apb_mask,
         p_mctrl_ram_wprot,
@@ -320,7 +415,7 @@ int sc_main(int argc, char** argv) {
                      p_mctrl_prom_bsize * 1024 * 1024,
                      p_mctrl_prom_width,
                      0,
-                     "ArrayStorage",
+                     (std::string)p_mctrl_prom_storage,
                      p_report_power
     );
 
@@ -335,7 +430,7 @@ int sc_main(int argc, char** argv) {
                p_mctrl_prom_bsize * 1024 * 1024,
                p_mctrl_prom_width,
                0,
-               "MapStorage",
+               (std::string)p_mctrl_io_storage,
                p_report_power
     );
 
@@ -353,7 +448,7 @@ int sc_main(int argc, char** argv) {
                  p_mctrl_ram_sram_bsize * 1024 * 1024,
                  p_mctrl_ram_sram_width,
                  0,
-                 "MapStorage",
+                 (std::string)p_mctrl_ram_sram_storage,
                  p_report_power
     );
 
@@ -371,7 +466,7 @@ int sc_main(int argc, char** argv) {
                        p_mctrl_ram_sdram_bsize * 1024 * 1024,
                        p_mctrl_ram_sdram_width,
                        p_mctrl_ram_sdram_cols,
-                       "ArrayStorage",
+                       (std::string)p_mctrl_ram_sdram_storage,
                        p_report_power
     );
 
@@ -382,11 +477,52 @@ int sc_main(int argc, char** argv) {
     // ELF loader from leon (Trap-Gen)
     gs::gs_param<std::string> p_mctrl_ram_sdram_elf("elf", "", p_mctrl_ram_sdram);
 
+    // The narrowed RAM area unmaps the SRAM above it and the SDRAM, which
+    // starts asel bits above the RAM address
+    if(ramMask != p_mctrl_ram_mask) {
+      uint64_t ramStart = static_cast<uint64_t>(p_mctrl_ram_addr & ramMask) << 20;
+      uint64_t ramEnd = ramStart + (static_cast<uint64_t>((~ramMask & 0xFFF) + 1) << 20);
+      uint64_t sramSize = static_cast<uint64_t>(p_mctrl_ram_sram_banks) * p_mctrl_ram_sram_bsize << 20;
+      uint64_t sdramSize = static_cast<uint64_t>(p_mctrl_ram_sdram_banks) * p_mctrl_ram_sdram_bsize << 20;
+      uint64_t sdramStart = ramStart + (static_cast<uint64_t>(1) << p_mctrl_ram_asel);
+      uint64_t sramEnd = std::min(ramStart + sramSize, sdramStart);
+      uint64_t sdramEnd = sdramStart + sdramSize;
+      if(sramEnd > ramEnd) {
+        v::warn << "main" << "SRAM from " << v::uint32 << static_cast<uint32_t>(ramEnd)
+                << " to " << v::uint32 << static_cast<uint32_t>(sramEnd - 1)
+                << " is not mapped with the frame buffer" << v::endl;
+      }
+      if(p_mctrl_sden && sdramEnd > sdramStart && sdramEnd > ramEnd) {
+        uint64_t lostStart = std::max(sdramStart, ramEnd);
+        if(!((std::string)p_mctrl_ram_sdram_elf).empty()) {
+          v::error << "main" << "conf.mctrl.ram.sdram.elf is loaded to SDRAM from " << v::uint32
+                   << static_cast<uint32_t>(lostStart) << " on, which is not mapped with the frame buffer" << v::endl;
+          return 1;
+        }
+        v::warn << "main" << "SDRAM from " << v::uint32 << static_cast<uint32_t>(lostStart)
+                << " to " << v::uint32 << static_cast<uint32_t>(sdramEnd - 1)
+                << " is not mapped with the frame buffer" << v::endl;
+      }
+    }
+
 
     //leon3.ENTRY_POINT   = 0;
     //leon3.PROGRAM_LIMIT = 0;
     //leon3.PROGRAM_START = 0;
 
+    // PlatformBuilder
+    // ===============
+    // Replaces the memory and video model blocks below when system.platform is set
+    PlatformBuilder *builder = NULL;
+    if(!builtin) {
+      builder = new PlatformBuilder(ahbctrl, apbctrl, ahbmonitor, p_system_clock, ambaLayer, p_report_power, &irqmp);
+      if(!builder->build(p_system_platform)) {
+        return 1;
+      }
+    }
+    // Frame signal of the last pipeline stage
+    sc_signal<bool> &frameSignal = builtin ? grayFrameSignal : builder->signal(builder->frames());
+
     // AHBSlave - AHBMem
     // =================
     gs::gs_param_array p_ahbmem("ahbmem", p_conf);
@@ -398,7 +534,7 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_ahbmem_waitstates("waitstates", 0u, p_ahbmem);
     gs::gs_param<std::string> p_ahbmem_elf("elf", "", p_ahbmem);
 
-    if(p_ahbmem_en) {
+    if(builtin && p_ahbmem_en) {
 
       AHBMem *ahbmem = new AHBMem("ahbmem",
                                   p_ahbmem_addr,
@@ -416,6 +552,23 @@ int sc_main(int argc, char** argv) {
       ahbmem->set_clk(p_system_clock, SC_NS);
     }
 
+    AHBFrameBuffer *framebuffer = NULL;
+    if(p_framebuffer_en) {
+      framebuffer = new AHBFrameBuffer("framebuffer",
+                                       p_framebuffer_addr,
+                                       p_framebuffer_mask,
+                                       ambaLayer,
+                                       p_framebuffer_index,
+                                       p_framebuffer_cacheable,
+                                       p_framebuffer_waitstates,
+                                       p_framebuffer_hugepages
+      );
+
+      // Connect to ahbctrl and clock
+      ahbctrl.ahbOUT(framebuffer->ahb);
+      framebuffer->set_clk(p_system_clock, SC_NS);
+    }
+
     // CREATE LEON3 Processor
     // ===================================================
     // Always enabled.
@@ -461,6 +614,7 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<int> p_gdb_port("port", 1500, p_gdb);
     gs::gs_param<int> p_gdb_proc("proc", 0, p_gdb);
     Leon3 *first_leon = NULL;
+    std::vector<Leon3 *> leons;
     for(uint32_t i=0; i< p_system_ncpu; i++) {
       // AHBMaster - MMU_CACHE
       // =====================
@@ -501,9 +655,14 @@ int sc_main(int argc, char** argv) {
       if(!first_leon) {
         first_leon = leon3;
       }
+      leons.push_back(leon3);
 
       // Connecting AHB Master
-      leon3->ahb(ahbctrl.ahbIN);
+      if(ahbmonitor) {
+        ahbmonitor->attach(leon3->ahb, ahbctrl.ahbIN, leon3->name(), p_mmu_cache_index + i, 0x01, 0x003);
+      } else {
+        leon3->ahb(ahbctrl.ahbIN);
+      }
       // Set clock
       leon3->set_clk(p_system_clock, SC_NS);
       connect(leon3->snoop, ahbctrl.snoop);
@@ -580,8 +739,8 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_ahbdisplay_pindex("pindex", 5, p_ahbdisplay);
     gs::gs_param<unsigned int> p_ahbdisplay_paddr("paddr", 0x500, p_ahbdisplay);
     gs::gs_param<unsigned int> p_ahbdisplay_pmask("pmask", 0xFFF, p_ahbdisplay);
-    AHBDisplay *ahbdisplay;
-    if(p_ahbdisplay_en) {
+    AHBDisplay *ahbdisplay = NULL;
+    if(builtin && p_ahbdisplay_en) {
       ahbdisplay = new AHBDisplay("ahbdisplay",
         p_ahbdisplay_index,  // ahb index
         p_ahbdisplay_pindex,  // apb index
@@ -592,13 +751,56 @@ int sc_main(int argc, char** argv) {
       );
 
       // Connecting APB Slave
-      ahbdisplay->ahb(ahbctrl.ahbIN);
+      AHBMonitor::connect(ahbmonitor, *ahbdisplay, ahbctrl.ahbIN);
       apbctrl.apb(ahbdisplay->apb);
       ahbdisplay->set_clk(p_system_clock,SC_NS);
       ahbdisplay->triggerIn(grayFrameSignal);
+      ahbdisplay->triggerOut(displayFrameSignal);
       ahbdisplay->keyboardOut(keyCodeSignal);
+      if(!((std::string)p_report_latency).empty()) {
+        ahbdisplay->latency_csv(p_report_latency);
+      }
     }
 #endif
+    // AHBFileCamera - AHBMaster
+    // ==================
+    // Streams raw YUV 4:2:2 or Y4M frames from a file instead of AHBCamera,
+    // used whenever a video is given
+    gs::gs_param_array p_ahbfilecamera("ahbfilecamera", p_conf);
+    gs::gs_param<std::string> p_ahbfilecamera_video("video", "", p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_hindex("hindex", 4, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_pindex("pindex", 6, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_paddr("paddr", 0x501, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_pmask("pmask", 0xFFF, p_ahbfilecamera);
+    gs::gs_param<bool> p_ahbfilecamera_loop("loop", true, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_decimate("decimate", 1, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_width("width", 320, p_ahbfilecamera);  // raw files only
+    gs::gs_param<unsigned int> p_ahbfilecamera_height("height", 240, p_ahbfilecamera);
+    gs::gs_param<unsigned int> p_ahbfilecamera_prefetch("prefetch", 4, p_ahbfilecamera);
+    bool filecamera = !((std::string)p_ahbfilecamera_video).empty();
+    AHBFileCamera *ahbfilecamera = NULL;
+    if(builtin && filecamera) {
+      ahbfilecamera = new AHBFileCamera("ahbfilecamera",
+        p_ahbfilecamera_hindex,  // ahb index
+        p_ahbfilecamera_pindex,  // apb index
+        p_ahbfilecamera_paddr,   // apb addr
+        p_ahbfilecamera_pmask,   // apb mask
+        frameWidth, frameHeight,
+        ((std::string)p_ahbfilecamera_video).c_str(),
+        ambaLayer,
+        p_ahbfilecamera_loop,
+        p_ahbfilecamera_decimate,
+        p_ahbfilecamera_width, p_ahbfilecamera_height,
+        p_ahbfilecamera_prefetch
+      );
+
+      // Connecting APB Slave
+      AHBMonitor::connect(ahbmonitor, *ahbfilecamera, ahbctrl.ahbIN);
+      apbctrl.apb(ahbfilecamera->apb);
+      ahbfilecamera->set_clk(p_system_clock,SC_NS);
+      // Connecting FrameTrigger Port
+      ahbfilecamera->triggerOut(cameraFrameSignal);
+    }
 #ifdef HAVE_AHBCAMERA
     // AHBCamera - AHBMaster
     // ==================
@@ -609,7 +811,7 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_ahbcamera_paddr("paddr", 0x501, p_ahbcamera);
     gs::gs_param<unsigned int> p_ahbcamera_pmask("pmask", 0xFFF, p_ahbcamera);
     gs::gs_param<std::string> p_ahbcamera_video("video", "bigbuckbunny_small_short.m2v", p_ahbcamera);
-    if(p_ahbcamera_en) {
+    if(builtin && p_ahbcamera_en && !filecamera) {
       AHBCamera *ahbcamera = new AHBCamera("ahbcamera",
         p_ahbcamera_hindex,  // ahb index
         p_ahbcamera_pindex,  // apb index
@@ -621,7 +823,7 @@ int sc_main(int argc, char** argv) {
       );
 
       // Connecting APB Slave
-      ahbcamera->ahb(ahbctrl.ahbIN);
+      AHBMonitor::connect(ahbmonitor, *ahbcamera, ahbctrl.ahbIN);
       apbctrl.apb(ahbcamera->apb);
       ahbcamera->set_clk(p_system_clock,SC_NS);
       // Connecting FrameTrigger Port
@@ -637,7 +839,7 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_ahbgrayframer0_pindex("pindex", 7, p_ahbgrayframer0);
     gs::gs_param<unsigned int> p_ahbgrayframer0_paddr("paddr", 0x502, p_ahbgrayframer0);
     gs::gs_param<unsigned int> p_ahbgrayframer0_pmask("pmask", 0xFFF, p_ahbgrayframer0);
-    if(p_ahbgrayframer0_en) {
+    if(builtin && p_ahbgrayframer0_en) {
       AHBGrayframer *ahbgrayframer0 = new AHBGrayframer("ahbgrayframer0",
         p_ahbgrayframer0_hindex,  // ahb index
         p_ahbgrayframer0_pindex,  // apb index
@@ -652,11 +854,17 @@ int sc_main(int argc, char** argv) {
       );
 
       // Connecting APB Slave
-      ahbgrayframer0->ahb(ahbctrl.ahbIN);
+      AHBMonitor::connect(ahbmonitor, *ahbgrayframer0, ahbctrl.ahbIN);
       apbctrl.apb(ahbgrayframer0->apb);
       ahbgrayframer0->set_clk(p_system_clock,SC_NS);
       ahbgrayframer0->triggerIn(cameraFrameSignal);
       ahbgrayframer0->triggerOut(grayFrameSignal);
+#ifdef HAVE_AHBDISPLAY
+      if(builtin && p_ahbdisplay_en) {
+        // the display takes the frame descriptors, the toggle stays for the frame counting
+        sr_signal::connect(ahbgrayframer0->frameOut, ahbdisplay->frameIn);
+      }
+#endif
     }
 
     // APBKeyboard - APBSlave
@@ -666,21 +874,265 @@ int sc_main(int argc, char** argv) {
     gs::gs_param<unsigned int> p_apbkeyboard_pindex("pindex", 8, p_apbkeyboard);
     gs::gs_param<unsigned int> p_apbkeyboard_paddr("paddr", 0x503, p_apbkeyboard);
     gs::gs_param<unsigned int> p_apbkeyboard_pmask("pmask", 0xFFF, p_apbkeyboard);
-    gs::gs_param<unsigned int> p_apbkeyboard_pirq("pirq", 0u, p_apbkeyboard);
-    if(p_apbkeyboard_en) {
+    gs::gs_param<unsigned int> p_apbkeyboard_pirq("pirq", 12, p_apbkeyboard);
+    gs::gs_param<unsigned int> p_apbkeyboard_depth("depth", 16, p_apbkeyboard);
+    if(builtin && p_apbkeyboard_en) {
       APBKeyboard *apbkeyboard = new APBKeyboard("apbkeyboard",
         p_apbkeyboard_pindex,  // apb index
         p_apbkeyboard_paddr,   // apb addr
         p_apbkeyboard_pmask,   // apb mask
-        p_apbkeyboard_pirq   // apb irq
+        p_apbkeyboard_pirq,    // apb irq
+        p_apbkeyboard_depth    // key events
       );
 
       // Connecting APB Slave
       apbctrl.apb(apbkeyboard->apb);
       apbkeyboard->keyboardIn(keyCodeSignal);
+      sr_signal::connect(irqmp.irq_in, apbkeyboard->irq, p_apbkeyboard_pirq);
+    }
+
+    // AHBZoomer - AHBMaster
+    // ==================
+    gs::gs_param_array p_ahbzoomer("ahbzoomer", p_conf);
+    gs::gs_param<bool> p_ahbzoomer_en("en", true, p_ahbzoomer);
+    gs::gs_param<unsigned int> p_ahbzoomer_hindex("hindex", 6, p_ahbzoomer);
+    gs::gs_param<unsigned int> p_ahbzoomer_pindex("pindex", 9, p_ahbzoomer);
+    gs::gs_param<unsigned int> p_ahbzoomer_paddr("paddr", 0x504, p_ahbzoomer);
+    gs::gs_param<unsigned int> p_ahbzoomer_pmask("pmask", 0xFFF, p_ahbzoomer);
+    if(builtin && p_ahbzoomer_en) {
+      AHBZoomer *ahbzoomer = new AHBZoomer("ahbzoomer",
+        p_ahbzoomer_hindex,  // ahb index
+        p_ahbzoomer_pindex,  // apb index
+        p_ahbzoomer_paddr,   // apb addr
+        p_ahbzoomer_pmask,   // apb mask
+        frameWidth,
+        ambaLayer
+      );
+
+      // Connecting APB Slave
+      AHBMonitor::connect(ahbmonitor, *ahbzoomer, ahbctrl.ahbIN);
+      apbctrl.apb(ahbzoomer->apb);
+      ahbzoomer->set_clk(p_system_clock,SC_NS);
+      ahbzoomer->triggerIn(grayFrameSignal);
+      ahbzoomer->triggerOut(zoomFrameSignal);
     }
 
-    irqmp_rst_stimuli stimuli("platform_stimuli");
+    // AHBStatistics - AHBMaster
+    // ==================
+    // Luma histogram of the gray picture, counts once software enables it
+    gs::gs_param_array p_ahbstatistics("ahbstatistics", p_conf);
+    gs::gs_param<bool> p_ahbstatistics_en("en", false, p_ahbstatistics);
+    gs::gs_param<unsigned int> p_ahbstatistics_hindex("hindex", 8, p_ahbstatistics);
+    gs::gs_param<unsigned int> p_ahbstatistics_pindex("pindex", 12, p_ahbstatistics);
+    gs::gs_param<unsigned int> p_ahbstatistics_paddr("paddr", 0x507, p_ahbstatistics);
+    gs::gs_param<unsigned int> p_ahbstatistics_pmask("pmask", 0xFFF, p_ahbstatistics);
+    if(builtin && p_ahbstatistics_en) {
+      AHBStatistics *ahbstatistics = new AHBStatistics("ahbstatistics",
+        p_ahbstatistics_hindex,  // ahb index
+        p_ahbstatistics_pindex,  // apb index
+        p_ahbstatistics_paddr,   // apb addr
+        p_ahbstatistics_pmask,   // apb mask
+        videoWidth,0,
+        videoWidth,frameHeight/2,
+        frameWidth,
+        ambaLayer
+      );
+
+      // Connecting APB Slave
+      AHBMonitor::connect(ahbmonitor, *ahbstatistics, ahbctrl.ahbIN);
+      apbctrl.apb(ahbstatistics->apb);
+      ahbstatistics->set_clk(p_system_clock,SC_NS);
+      ahbstatistics->triggerIn(grayFrameSignal);
+      ahbstatistics->triggerOut(statisticsFrameSignal);
+    }
+
+    // APBVideoDetail - APBSlave
+    // ==================
+    // Runs the video masters with fast transfers and models them in detail
+    // from detail_at ms or frame detail_frame on, for detail_frames frames.
+    // The LEON3 and the memories keep the layer of conf.system.at
+    gs::gs_param_array p_apbvideodetail("apbvideodetail", p_conf);
+    gs::gs_param<bool> p_apbvideodetail_en("en", false, p_apbvideodetail);
+    gs::gs_param<unsigned int> p_apbvideodetail_pindex("pindex", 10, p_apbvideodetail);
+    gs::gs_param<unsigned int> p_apbvideodetail_paddr("paddr", 0x505, p_apbvideodetail);
+    gs::gs_param<unsigned int> p_apbvideodetail_pmask("pmask", 0xFFF, p_apbvideodetail);
+    gs::gs_param<unsigned int> p_apbvideodetail_detail_at("detail_at", 0u, p_apbvideodetail);
+    gs::gs_param<unsigned int> p_apbvideodetail_detail_frame("detail_frame", 0u, p_apbvideodetail);
+    gs::gs_param<unsigned int> p_apbvideodetail_detail_frames("detail_frames", 0u, p_apbvideodetail);
+    if(p_apbvideodetail_en) {
+      APBVideoDetail *apbvideodetail = new APBVideoDetail("apbvideodetail",
+        p_apbvideodetail_pindex,  // apb index
+        p_apbvideodetail_paddr,   // apb addr
+        p_apbvideodetail_pmask,   // apb mask
+        sc_core::sc_time(p_apbvideodetail_detail_at, SC_MS),
+        p_apbvideodetail_detail_frame,
+        p_apbvideodetail_detail_frames
+      );
+
+      // Connecting APB Slave
+      apbctrl.apb(apbvideodetail->apb);
+      apbvideodetail->frameIn(frameSignal);
+    }
+
+    // APBBufferManager - APBSlave
+    // ==================
+    // Pool of count frame buffers of size bytes from base on, handed between
+    // producers and consumers through free and full queues. The file camera
+    // fills the buffers and the display shows them instead of sharing the
+    // video memory.
+    gs::gs_param_array p_apbbuffermanager("apbbuffermanager", p_conf);
+    gs::gs_param<bool> p_apbbuffermanager_en("en", false, p_apbbuffermanager);
+    gs::gs_param<unsigned int> p_apbbuffermanager_pindex("pindex", 13, p_apbbuffermanager);
+    gs::gs_param<unsigned int> p_apbbuffermanager_paddr("paddr", 0x509, p_apbbuffermanager);
+    gs::gs_param<unsigned int> p_apbbuffermanager_pmask("pmask", 0xFFF, p_apbbuffermanager);
+    gs::gs_param<unsigned int> p_apbbuffermanager_pirq("pirq", 10, p_apbbuffermanager);
+    gs::gs_param<unsigned int> p_apbbuffermanager_base("base", 0x50100000, p_apbbuffermanager);
+    gs::gs_param<unsigned int> p_apbbuffermanager_size("size", 0x96000, p_apbbuffermanager);
+    gs::gs_param<unsigned int> p_apbbuffermanager_count("count", 4, p_apbbuffermanager);
+    if(p_apbbuffermanager_en) {
+      APBBufferManager *apbbuffermanager = new APBBufferManager("apbbuffermanager",
+        p_apbbuffermanager_pindex,  // apb index
+        p_apbbuffermanager_paddr,   // apb addr
+        p_apbbuffermanager_pmask,   // apb mask
+        p_apbbuffermanager_pirq,    // apb irq
+        p_apbbuffermanager_base,
+        p_apbbuffermanager_size,
+        p_apbbuffermanager_count
+      );
+
+      // Connecting APB Slave
+      apbctrl.apb(apbbuffermanager->apb);
+      sr_signal::connect(irqmp.irq_in, apbbuffermanager->irq, p_apbbuffermanager_pirq);
+      if(ahbfilecamera) {
+        ahbfilecamera->set_buffers(apbbuffermanager);
+      }
+#ifdef HAVE_AHBDISPLAY
+      if(ahbdisplay) {
+        ahbdisplay->set_buffers(apbbuffermanager);
+      }
+#endif
+    }
+
+    // AHBDMA - AHBMaster
+    // ==================
+    // Copies and fills memory for software along chains of descriptors
+    gs::gs_param_array p_ahbdma("ahbdma", p_conf);
+    gs::gs_param<bool> p_ahbdma_en("en", true, p_ahbdma);
+    gs::gs_param<unsigned int> p_ahbdma_hindex("hindex", 10, p_ahbdma);
+    gs::gs_param<unsigned int> p_ahbdma_pindex("pindex", 14, p_ahbdma);
+    gs::gs_param<unsigned int> p_ahbdma_paddr("paddr", 0x50A, p_ahbdma);
+    gs::gs_param<unsigned int> p_ahbdma_pmask("pmask", 0xFFF, p_ahbdma);
+    gs::gs_param<unsigned int> p_ahbdma_pirq("pirq", 11, p_ahbdma);
+    if(p_ahbdma_en) {
+      AHBDMA *ahbdma = new AHBDMA("ahbdma",
+        p_ahbdma_hindex,  // ahb index
+        p_ahbdma_pindex,  // apb index
+        p_ahbdma_paddr,   // apb addr
+        p_ahbdma_pmask,   // apb mask
+        p_ahbdma_pirq,    // apb irq
+        ambaLayer
+      );
+
+      // Connecting AHB Master and APB Slave
+      AHBMonitor::connect(ahbmonitor, *ahbdma, ahbctrl.ahbIN);
+      apbctrl.apb(ahbdma->apb);
+      ahbdma->set_clk(p_system_clock,SC_NS);
+      sr_signal::connect(irqmp.irq_in, ahbdma->irq, p_ahbdma_pirq);
+    }
+
+    // Checkpoint - AHBMaster
+    // ==================
+    // Saves memories, the cuselab registers and the processor state at
+    // save_at ms or on request of software and restores them at start
+    gs::gs_param_array p_checkpoint("checkpoint", p_conf);
+    gs::gs_param<std::string> p_checkpoint_save("save", "", p_checkpoint);
+    gs::gs_param<std::string> p_checkpoint_restore("restore", "", p_checkpoint);
+    gs::gs_param<unsigned int> p_checkpoint_save_at("save_at", 0u, p_checkpoint);
+    gs::gs_param<unsigned int> p_checkpoint_hindex("hindex", 7, p_checkpoint);
+    gs::gs_param<unsigned int> p_checkpoint_pindex("pindex", 11, p_checkpoint);
+    gs::gs_param<unsigned int> p_checkpoint_paddr("paddr", 0x506, p_checkpoint);
+    gs::gs_param<unsigned int> p_checkpoint_pmask("pmask", 0xFFF, p_checkpoint);
+    Checkpoint *checkpoint = NULL;
+    if(!((std::string)p_checkpoint_save).empty() || !((std::string)p_checkpoint_restore).empty()) {
+      checkpoint = new Checkpoint("checkpoint",
+        p_checkpoint_hindex,  // ahb index
+        p_checkpoint_pindex,  // apb index
+        p_checkpoint_paddr,   // apb addr
+        p_checkpoint_pmask,   // apb mask
+        p_checkpoint_save,
+        p_checkpoint_restore,
+        sc_core::sc_time(p_checkpoint_save_at, SC_MS),
+        ambaLayer
+      );
+
+      // Connecting AHB Master and APB Slave
+      AHBMonitor::connect(ahbmonitor, *checkpoint, ahbctrl.ahbIN);
+      apbctrl.apb(checkpoint->apb);
+      checkpoint->set_clk(p_system_clock, SC_NS);
+
+      uint32_t apbbase = (uint32_t)p_apbctrl_haddr << 20;
+      uint32_t rambase = (uint32_t)p_mctrl_ram_addr << 20;
+      uint32_t ramsize = ((~ramMask & 0xFFF) + 1) << 20;
+      checkpoint->add_memory("rom", (uint32_t)p_mctrl_prom_addr << 20,
+        ((uint32_t)p_mctrl_prom_banks * (uint32_t)p_mctrl_prom_bsize) << 20);
+      checkpoint->add_memory("sram", rambase,
+        std::min(((uint32_t)p_mctrl_ram_sram_banks * (uint32_t)p_mctrl_ram_sram_bsize) << 20, ramsize));
+      if((1u << (uint32_t)p_mctrl_ram_asel) < ramsize) {
+        checkpoint->add_memory("sdram", rambase + (1u << (uint32_t)p_mctrl_ram_asel),
+          ((uint32_t)p_mctrl_ram_sdram_banks * (uint32_t)p_mctrl_ram_sdram_bsize) << 20);
+      }
+      if(framebuffer) {
+        checkpoint->add_memory("framebuffer", framebuffer->base(), framebuffer->size());
+      }
+      if(builtin && p_ahbmem_en) {
+        checkpoint->add_memory("ahbmem", (uint32_t)p_ahbmem_addr << 20, ((~(uint32_t)p_ahbmem_mask & 0xFFF) + 1) << 20);
+      }
+      // the LUT index and data registers of the grayframer auto-increment and are left out
+#ifdef HAVE_AHBDISPLAY
+      if(builtin && p_ahbdisplay_en) {
+        checkpoint->add_registers("ahbdisplay", apbbase + ((uint32_t)p_ahbdisplay_paddr << 8), 0x10);
+      }
+#endif
+      if(builtin && p_ahbgrayframer0_en) {
+        checkpoint->add_registers("ahbgrayframer0", apbbase + ((uint32_t)p_ahbgrayframer0_paddr << 8), 0x18);
+      }
+      if(builtin && p_ahbzoomer_en) {
+        checkpoint->add_registers("ahbzoomer", apbbase + ((uint32_t)p_ahbzoomer_paddr << 8), 0x1C);
+      }
+      for(uint32_t i = 0; i < leons.size(); i++) {
+        checkpoint->add_state(checkpoint_abi(leons[i]->name(), leons[i]->cpu.getInterface()));
+      }
+    }
+
+    // Preloader - AHBMaster
+    // ==================
+    // Writes files into the memories at time 0, e.g. the image softcam
+    // would copy at boot: files = "bunny.yuv@0x50000000:640:1280"
+    gs::gs_param_array p_preload("preload", p_conf);
+    gs::gs_param<std::string> p_preload_files("files", "", p_preload);
+    gs::gs_param<unsigned int> p_preload_hindex("hindex", 9, p_preload);
+    Preloader *preloader = NULL;
+    // a restored checkpoint holds the memories already
+    if(!((std::string)p_preload_files).empty() && ((std::string)p_checkpoint_restore).empty()) {
+      preloader = new Preloader("preloader",
+        p_preload_hindex,  // ahb index
+        p_preload_files,
+        ambaLayer
+      );
+
+      // Connecting AHB Master
+      AHBMonitor::connect(ahbmonitor, *preloader, ahbctrl.ahbIN);
+      preloader->set_clk(p_system_clock, SC_NS);
+    }
+
+    // the processors start after the restore or the preload
+    sc_core::sc_event *hold = NULL;
+    if(checkpoint && !((std::string)p_checkpoint_restore).empty()) {
+      hold = &checkpoint->restored;
+    } else if(preloader) {
+      hold = &preloader->loaded;
+    }
+    irqmp_rst_stimuli stimuli("platform_stimuli", hold);
     connect(stimuli.irqmp_rst, irqmp.rst);
     // disable Info messages
     sc_report_handler::set_actions(SC_INFO, SC_DO_NOTHING);
@@ -689,8 +1141,16 @@ int sc_main(int argc, char** argv) {
     (void) signal(SIGINT, stopSimFunction);
     (void) signal(SIGTERM, stopSimFunction);
 #endif
+    // Bounded runs: stop after system.frames frames or system.time ms simulated time
+    RunControl runcontrol("runcontrol", p_system_frames, sc_core::sc_time(p_system_time, SC_MS));
+    runcontrol.frameIn(frameSignal);
+
     cstart = cend = clock();
     cstart = clock();
+    if(p_report_profile) {
+      ProcessProfiler::enable();
+    }
+    runcontrol.start();
     //mtrace();
 #ifdef HAVE_USI
     usi_start();
@@ -699,10 +1159,13 @@ int sc_main(int argc, char** argv) {
 #endif
     //muntrace();
     cend = clock();
+    runcontrol.stop();
+    ProcessProfiler::report(p_report_profile);
 
     v::info << "Summary" << "Start: " << dec << cstart << v::endl;
     v::info << "Summary" << "End:   " << dec << cend << v::endl;
     v::info << "Summary" << "Delta: " << dec << setprecision(4) << ((double)(cend - cstart) / (double)CLOCKS_PER_SEC * 1000) << "ms" << v::endl;
+    runcontrol.write_summary(p_report_summary, "leon3softwaredemo");
 
     std::cout << "End of sc_main" << std::endl << std::flush;
     return 0;
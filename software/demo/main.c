@@ -30,6 +30,9 @@ __attribute__((packed)) struct grayframer_regs_t {
   volatile uint32_t in_pos;
   volatile uint32_t out_pos;
   volatile uint32_t size;
+  volatile uint32_t lut_ctrl;
+  volatile uint32_t lut_index;
+  volatile uint32_t lut_data;
 };
 
 typedef struct keyboard_regs_t keyboard_regs;
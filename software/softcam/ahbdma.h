@@ -0,0 +1,131 @@
+/* Driver of the AHBDMA engine, see models/ahbdma/ahbdma.md
+ *
+ * Include after the uint8_t and uint32_t types are defined. Build a
+ * chain with ahbdma_copy, ahbdma_copy2d and ahbdma_fill, link its
+ * descriptors with ahbdma_link and hand the first one to ahbdma_start.
+ * ahbdma_wait blocks until the chain is done. Descriptors must stay
+ * untouched until then. The engine can be left out of the platform
+ * (conf.ahbdma.en), check ahbdma_present before using it.
+ */
+#ifndef AHBDMA_H
+#define AHBDMA_H
+
+typedef struct ahbdma_regs_t ahbdma_regs;
+__attribute__((packed)) struct ahbdma_regs_t {
+  volatile uint32_t ctrl;
+  volatile uint32_t desc;
+  volatile uint32_t status;
+  volatile uint32_t current;
+};
+
+typedef struct ahbdma_desc_t ahbdma_desc;
+__attribute__((aligned(32))) struct ahbdma_desc_t {
+  volatile uint32_t next;
+  volatile uint32_t ctrl;
+  volatile uint32_t src;
+  volatile uint32_t dst;
+  volatile uint32_t width;
+  volatile uint32_t height;
+  volatile uint32_t src_stride;
+  volatile uint32_t dst_stride;
+};
+
+#define AHBDMA_CTRL_START  0x1
+#define AHBDMA_CTRL_IRQ    0x2
+#define AHBDMA_CTRL_BUSY   0x4
+
+#define AHBDMA_STATUS_DONE  0x1
+#define AHBDMA_STATUS_ERROR 0x2
+
+#define AHBDMA_COPY        0x0
+#define AHBDMA_COPY2D      0x1
+#define AHBDMA_FILL        0x2
+#define AHBDMA_DESC_IRQ    0x4
+#define AHBDMA_DESC_DONE   0x80000000
+
+/* plug and play identification of the engine */
+#define AHBDMA_VENDOR      0x03
+#define AHBDMA_DEVICE      0x00F
+
+static volatile ahbdma_regs *dma = (ahbdma_regs *)0x80050A00;
+
+/* nonzero if the engine is in the APB plug and play records */
+static inline int ahbdma_present(void) {
+  volatile uint32_t *pnp = (uint32_t *)0x800FF000;
+  int i;
+  for (i = 0; i < 16; i++) {
+    if ((pnp[i * 2] >> 12) == ((AHBDMA_VENDOR << 12) | AHBDMA_DEVICE)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* copy length bytes */
+static inline ahbdma_desc *ahbdma_copy(ahbdma_desc *d, volatile void *dst, const volatile void *src, uint32_t length) {
+  d->next = 0;
+  d->ctrl = AHBDMA_COPY;
+  d->src = (uint32_t)src;
+  d->dst = (uint32_t)dst;
+  d->width = length;
+  d->height = 1;
+  d->src_stride = length;
+  d->dst_stride = length;
+  return d;
+}
+
+/* copy height rows of width bytes between buffers with the given strides */
+static inline ahbdma_desc *ahbdma_copy2d(ahbdma_desc *d, volatile void *dst, uint32_t dst_stride,
+    const volatile void *src, uint32_t src_stride, uint32_t width, uint32_t height) {
+  d->next = 0;
+  d->ctrl = AHBDMA_COPY2D;
+  d->src = (uint32_t)src;
+  d->dst = (uint32_t)dst;
+  d->width = width;
+  d->height = height;
+  d->src_stride = src_stride;
+  d->dst_stride = dst_stride;
+  return d;
+}
+
+/* fill height rows of width bytes with the 32 bit pattern, as stored big endian */
+static inline ahbdma_desc *ahbdma_fill(ahbdma_desc *d, volatile void *dst, uint32_t dst_stride,
+    uint32_t pattern, uint32_t width, uint32_t height) {
+  d->next = 0;
+  d->ctrl = AHBDMA_FILL;
+  d->src = pattern;
+  d->dst = (uint32_t)dst;
+  d->width = width;
+  d->height = height;
+  d->src_stride = 0;
+  d->dst_stride = dst_stride;
+  return d;
+}
+
+/* run next after d */
+static inline void ahbdma_link(ahbdma_desc *d, ahbdma_desc *next) {
+  d->next = (uint32_t)next;
+}
+
+/* start the chain, with irq the engine interrupts when it is done */
+static inline void ahbdma_start(ahbdma_desc *first, int irq) {
+  dma->status = AHBDMA_STATUS_DONE | AHBDMA_STATUS_ERROR;
+  dma->desc = (uint32_t)first;
+  dma->ctrl = AHBDMA_CTRL_START | (irq ? AHBDMA_CTRL_IRQ : 0);
+}
+
+/* nonzero while a chain runs */
+static inline int ahbdma_busy(void) {
+  return dma->ctrl & AHBDMA_CTRL_BUSY;
+}
+
+/* wait for the chain, returns nonzero on an invalid descriptor. The data
+ * cache is flushed, it may hold lines the engine has written since. */
+static inline int ahbdma_wait(void) {
+  while (ahbdma_busy()) {
+  }
+  __asm__ volatile ("sta %%g0, [%%g0] 0x11" ::: "memory");
+  return dma->status & AHBDMA_STATUS_ERROR;
+}
+
+#endif
@@ -1,13 +1,17 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#ifndef PRELOADED
 #include "bunny.h"
+#endif
 
 typedef unsigned char uint8_t;
 typedef unsigned int uint16_t;
 typedef unsigned int uint32_t;
 typedef unsigned int uint64_t;
 
+#include "ahbdma.h"
+
 typedef struct display_regs_t display_regs;
 __attribute__((packed)) struct display_regs_t {
   volatile uint32_t ctrl;
@@ -23,11 +27,29 @@ __attribute__((packed)) struct grayframer_regs_t {
   volatile uint32_t in_pos;
   volatile uint32_t out_pos;
   volatile uint32_t size;
+  volatile uint32_t lut_ctrl;
+  volatile uint32_t lut_index;
+  volatile uint32_t lut_data;
+};
+
+typedef struct zoomer_regs_t zoomer_regs;
+__attribute__((packed)) struct zoomer_regs_t {
+  volatile uint32_t ctrl;
+  volatile uint8_t *addr;
+  volatile uint32_t src_pos;
+  volatile uint32_t src_size;
+  volatile uint32_t dst_pos;
+  volatile uint32_t factor;
+  volatile uint32_t stride;
 };
 
 typedef struct keyboard_regs_t keyboard_regs;
 __attribute__((packed)) struct keyboard_regs_t {
   volatile uint32_t data;
+  volatile uint32_t ctrl;
+  volatile uint32_t status;
+  volatile uint32_t count;
+  volatile uint32_t event;
 };
 
 const uint32_t width = 320;
@@ -36,16 +58,50 @@ volatile uint8_t *videomem = (uint8_t *)0x50000000;
 volatile display_regs *vid = (display_regs *)0x80050000;
 volatile grayframer_regs *gf = (grayframer_regs *)0x80050200;
 volatile keyboard_regs *kb = (keyboard_regs *)0x80050300;
+volatile uint32_t *irqmp_mask = (uint32_t *)0x80000240;
+const int kb_irq = 12;
+volatile zoomer_regs *zm = (zoomer_regs *)0x80050400;
+#ifdef CHECKPOINT
+volatile uint32_t *checkpoint = (uint32_t *)0x80050600;
+#endif
+
+extern void *catch_interrupt(void func(), int irq);
 
+// key held down, maintained from the key events of the keyboard interrupt
+volatile uint32_t key = 0;
+
+void keyboard_irq(int irq) {
+  uint32_t event;
+  while ((event = kb->event)) {
+    if (event & 0x100) {
+      if ((event & 0xFF) == key) key = 0;
+    } else {
+      key = event & 0xFF;
+    }
+  }
+}
+
+ahbdma_desc load_desc;
+
+// the rows are copied by the dma engine, by the cpu if the platform has none
 void loadimage(uint8_t *image, volatile uint8_t *address, uint32_t xpos, uint32_t ypos, uint32_t video_width, uint32_t video_height, uint32_t frame_width, uint32_t frame_height) {
     int i;
-    for(i=0;i<video_height;i++) {
-        memcpy(
-                (void *)&address[(ypos*video_width*2)+xpos+(i*video_width*4)],
-                (void *)image+(i*video_width*2),
-                video_width*2
-                );
+    if (!ahbdma_present()) {
+        for(i=0;i<video_height;i++) {
+            memcpy(
+                    (void *)&address[(ypos*video_width*2)+xpos+(i*video_width*4)],
+                    (void *)image+(i*video_width*2),
+                    video_width*2
+                    );
+        }
+        return;
     }
+    ahbdma_copy2d(&load_desc,
+            &address[(ypos*video_width*2)+xpos], video_width*4,
+            image, video_width*2,
+            video_width*2, video_height);
+    ahbdma_start(&load_desc, 0);
+    if (ahbdma_wait()) printf("sw dma failed\n");
 }
 
 int main(int argc, char *argv[]) {
@@ -61,10 +117,46 @@ int main(int argc, char *argv[]) {
   gf->size = (width*2 << 16) | height*2;
   gf->ctrl |= 0x3;
 
+  // zoom a quarter of the gray picture into the lower left corner,
+  // the zoomer runs on every grayframer frame without further cpu work
+  zm->addr = videomem;
+  zm->src_pos = (width << 16) | 0;
+  zm->src_size = (width/2 << 16) | height/2;
+  zm->dst_pos = (0 << 16) | height;
+  zm->factor = 2;
+  zm->stride = width*4;
+  zm->ctrl = 0x1;
+
+#ifndef PRELOADED
   loadimage(bunny_orig_png,videomem,0,0,width,height,width*2,height*2);
+#endif
+#ifdef CHECKPOINT
+  // flush the register windows to the stack and request a checkpoint,
+  // a restored run continues right here
+  __asm__ volatile ("ta 3" ::: "memory");
+  *checkpoint = 1;
+#endif
+
+  // the keyboard interrupts on key events, the loop does not poll it
+  catch_interrupt(keyboard_irq, kb_irq);
+  *irqmp_mask |= 1 << kb_irq;
+  kb->ctrl = 0x3;
 
+  uint32_t zx = 0, zy = 0, shown = 0;
   while(1) {
-    if (kb->data) printf("sw got key: %d\n",kb->data);
+    uint32_t held = key;
+    if (held != shown) {
+      if (held) printf("sw got key: %d\n",held);
+      shown = held;
+    }
+    switch (held) {
+      case 'r': if (zx < width/2) zx += 2; break;
+      case 'l': if (zx > 0) zx -= 2; break;
+      case 'u': if (zy > 0) zy -= 2; break;
+      case 'd': if (zy < height/2) zy += 2; break;
+      default: break;
+    }
+    zm->src_pos = ((width + zx) << 16) | zy;
     vid->ctrl |= 0x2;
     gf->ctrl |= 0x2;
 